@@ -444,6 +444,16 @@ void CL_DemoCompleted(void)
 	CL_NextDemo();
 }
 
+// reads the message stream of either a .dm or a .dmz demo
+static int CL_ReadDemo(void* buffer, const int len)
+{
+	if (clc.demoArchive.file)
+	{
+		return Demo_ReadArchive(&clc.demoArchive, buffer, len);
+	}
+	return FS_Read(buffer, len, clc.demofile);
+}
+
 /*
 =================
 CL_ReadDemoMessage
@@ -462,7 +472,7 @@ void CL_ReadDemoMessage(void)
 	}
 
 	// get the sequence number
-	int r = FS_Read(&s, 4, clc.demofile);
+	int r = CL_ReadDemo(&s, 4);
 	if (r != 4)
 	{
 		CL_DemoCompleted();
@@ -474,7 +484,7 @@ void CL_ReadDemoMessage(void)
 	MSG_Init(&buf, bufData, sizeof bufData);
 
 	// get the length
-	r = FS_Read(&buf.cursize, 4, clc.demofile);
+	r = CL_ReadDemo(&buf.cursize, 4);
 	if (r != 4)
 	{
 		CL_DemoCompleted();
@@ -490,7 +500,7 @@ void CL_ReadDemoMessage(void)
 	{
 		Com_Error(ERR_DROP, "CL_ReadDemoMessage: demoMsglen > MAX_MSGLEN");
 	}
-	r = FS_Read(buf.data, buf.cursize, clc.demofile);
+	r = CL_ReadDemo(buf.data, buf.cursize);
 	if (r != buf.cursize)
 	{
 		Com_Printf("Demo file was truncated.\n");
@@ -512,10 +522,12 @@ static void CL_CompleteDemoName(char* args, const int argNum)
 {
 	if (argNum == 2)
 	{
-		char demoExt[16];
+		char demoExt[16], archiveExt[16];
 
 		Com_sprintf(demoExt, sizeof demoExt, ".dm_%d", PROTOCOL_VERSION);
-		Field_CompleteFilename("demos", demoExt, qtrue, qtrue);
+		Com_sprintf(archiveExt, sizeof archiveExt, ".dmz_%d", PROTOCOL_VERSION);
+		const char* exts[] = { demoExt, archiveExt };
+		Field_CompleteFilenames("demos", exts, ARRAY_LEN(exts), qtrue, qtrue);
 	}
 }
 
@@ -523,17 +535,18 @@ static void CL_CompleteDemoName(char* args, const int argNum)
 ====================
 CL_PlayDemo_f
 
-demo <demoname>
+demo <demoname> [seconds]
 
+A .dmz demo can start at its last keyframe before the given time
 ====================
 */
 void CL_PlayDemo_f(void)
 {
-	char name[MAX_OSPATH], extension[32];
+	char name[MAX_OSPATH], extension[32], archiveExtension[32];
 
-	if (Cmd_Argc() != 2)
+	if (Cmd_Argc() != 2 && Cmd_Argc() != 3)
 	{
-		Com_Printf("demo <demoname>\n");
+		Com_Printf("demo <demoname> [seconds]\n");
 		return;
 	}
 
@@ -547,17 +560,26 @@ void CL_PlayDemo_f(void)
 	CL_Disconnect(qtrue);
 
 	Com_sprintf(extension, sizeof extension, ".dm_%d", PROTOCOL_VERSION);
+	Com_sprintf(archiveExtension, sizeof archiveExtension, ".dmz_%d", PROTOCOL_VERSION);
 
-	if (!Q_stricmp(arg + strlen(arg) - strlen(extension), extension))
+	long length;
+	if (!Q_stricmp(arg + strlen(arg) - strlen(extension), extension)
+		|| !Q_stricmp(arg + strlen(arg) - strlen(archiveExtension), archiveExtension))
 	{
 		Com_sprintf(name, sizeof name, "demos/%s", arg);
+		length = FS_FOpenFileRead(name, &clc.demofile, qtrue);
 	}
 	else
 	{
-		Com_sprintf(name, sizeof name, "demos/%s.dm_%d", arg, PROTOCOL_VERSION);
+		Com_sprintf(name, sizeof name, "demos/%s%s", arg, extension);
+		length = FS_FOpenFileRead(name, &clc.demofile, qtrue);
+		if (!clc.demofile)
+		{
+			Com_sprintf(name, sizeof name, "demos/%s%s", arg, archiveExtension);
+			length = FS_FOpenFileRead(name, &clc.demofile, qtrue);
+		}
 	}
 
-	FS_FOpenFileRead(name, &clc.demofile, qtrue);
 	if (!clc.demofile)
 	{
 		if (!Q_stricmp(arg, "(null)"))
@@ -568,6 +590,18 @@ void CL_PlayDemo_f(void)
 	}
 	Q_strncpyz(clc.demoName, Cmd_Argv(1), sizeof clc.demoName);
 
+	if (Demo_OpenArchive(&clc.demoArchive, clc.demofile, length) && Cmd_Argc() == 3)
+	{
+		if (!Demo_SeekArchive(&clc.demoArchive, atoi(Cmd_Argv(2)) * 1000))
+		{
+			Com_Printf("%s has no keyframe index, playing from the start.\n", name);
+		}
+	}
+	else if (Cmd_Argc() == 3)
+	{
+		Com_Printf("Only .dmz demos can start at a given time.\n");
+	}
+
 	Con_Close();
 
 	cls.state = CA_CONNECTED;
@@ -837,6 +871,7 @@ void CL_Disconnect(const qboolean showMainMenu)
 
 	if (clc.demofile)
 	{
+		Demo_CloseArchive(&clc.demoArchive);
 		FS_FCloseFile(clc.demofile);
 		clc.demofile = 0;
 	}
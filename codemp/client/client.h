@@ -228,6 +228,7 @@ using clientConnection_t = struct clientConnection_s
 	qboolean demowaiting; // don't record until a non-delta message is received
 	qboolean firstDemoFrameSkipped;
 	fileHandle_t demofile;
+	demoArchive_t demoArchive; // when playing a .dmz demofile
 
 	int timeDemoFrames; // counter of rendered frames
 	int timeDemoStart; // cls.realtime before first frame
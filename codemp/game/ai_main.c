@@ -2057,17 +2057,22 @@ qboolean carrying_cap_objective(const bot_state_t* bs)
 	return qfalse;
 }
 
+//trying to capture something.  Fairly random paths to mix up the defending team.
+static qboolean route_is_randomized(const bot_state_t* bs)
+{
+	return bs->currentTactic == BOTORDER_OBJECTIVE
+		&& bs->objectiveType == OT_CAPTURE
+		&& !carrying_cap_objective(bs);
+}
+
 float route_randomize(const bot_state_t* bs, const float dest_dist)
 {
 	//this function randomizes the h value (distance to target location) to make the
 	//bots take a random path instead of always taking the shortest route.
 	//This should vary based on situation to prevent the bots from taking weird routes
 	//for inapproprate situations.
-	if (bs->currentTactic == BOTORDER_OBJECTIVE
-		&& bs->objectiveType == OT_CAPTURE
-		&& !carrying_cap_objective(bs))
+	if (route_is_randomized(bs))
 	{
-		//trying to capture something.  Fairly random paths to mix up the defending team.
 		return dest_dist * rand_float(.5, 1.5);
 	}
 
@@ -2400,6 +2405,90 @@ void copy_route(bot_route_t routesource, bot_route_t routedest)
 	}
 }
 
+//can this bot step onto wp_num from parent, the same checks add_open_list makes
+static qboolean route_step_allowed(const bot_state_t* bs, const int wp_num, const int parent, const int badwp)
+{
+	if (wp_num == badwp && parent != -1)
+	{
+		return qfalse;
+	}
+
+	if (gWPArray[wp_num]->flags & WPFLAG_REDONLY
+		&& g_entities[bs->client].client->sess.sessionTeam != TEAM_RED)
+	{
+		//red only wp, can't use
+		return qfalse;
+	}
+
+	if (gWPArray[wp_num]->flags & WPFLAG_BLUEONLY
+		&& g_entities[bs->client].client->sess.sessionTeam != TEAM_BLUE)
+	{
+		//blue only wp, can't use
+		return qfalse;
+	}
+
+	if (parent != -1 && gWPArray[wp_num]->flags & WPFLAG_JUMP)
+	{
+		if (force_jump_needed(gWPArray[parent]->origin, gWPArray[wp_num]->origin) > bs->cur_ps.fd.forcePowerLevel[
+			FP_LEVITATION])
+		{
+			//can't make this jump with our level of Force Jump
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+#define ROUTE_TABLE_UNUSABLE	-2
+
+//read the route off the waypoint route table. The table's route is the shortest one over
+//every link, so if this bot can take each step of it, it's the shortest one for this bot too.
+//Returns the route length, -1 if there is no route at all and ROUTE_TABLE_UNUSABLE if
+//the bot has to search for one.
+static float table_pathto_wp(const bot_state_t* bs, const int start, const int end, const int badwp,
+	bot_route_t route)
+{
+	static bot_route_t path;
+	float dist = 0;
+	int num = 0;
+	int wp = start;
+
+	if (!wp_route_table_ready() || route_is_randomized(bs))
+	{
+		return ROUTE_TABLE_UNUSABLE;
+	}
+
+	if (wp_route_next(start, end) == -1)
+	{
+		return -1;
+	}
+
+	if (!route_step_allowed(bs, start, -1, badwp))
+	{
+		return ROUTE_TABLE_UNUSABLE;
+	}
+
+	path[num++] = start;
+	while (wp != end)
+	{
+		const int next = wp_route_next(wp, end);
+
+		if (next == -1 || num >= MAX_WPARRAY_SIZE || !route_step_allowed(bs, next, wp, badwp))
+		{
+			return ROUTE_TABLE_UNUSABLE;
+		}
+
+		dist += wp_route_link_cost(wp, next);
+		path[num++] = next;
+		wp = next;
+	}
+
+	clear_route(route);
+	memcpy(route, path, num * sizeof path[0]);
+	return dist;
+}
+
 //Find the ideal (shortest) route between the start wp and the end wp
 //badwp is for situations where you need to recalc a path when you dynamically discover
 //that a wp is bad (door locked, blocked, etc).
@@ -2423,6 +2512,20 @@ float find_ideal_pathto_wp(bot_state_t* bs, const int start, const int end, cons
 		return 0;
 	}
 
+	const float table_dist = table_pathto_wp(bs, start, end, badwp, route);
+	if (table_dist != ROUTE_TABLE_UNUSABLE)
+	{
+		if (table_dist >= 0)
+		{
+			bs->PathFindDebounce = level.time;
+			return table_dist;
+		}
+
+		//no route for anyone
+		bs->PathFindDebounce = level.time + 3000; //try again in 3 seconds.
+		return -1;
+	}
+
 	//reset node lists
 	for (i = 0; i < MAX_WPARRAY_SIZE; i++)
 	{
@@ -2520,13 +2623,97 @@ END A* Pathfinding Code
 =========================
 */
 
+#define NEAREST_WP_BATCH	8 //visibility traces sent to the server at a time
+
+typedef struct nearestWPCandidate_s
+{
+	float dist;
+	int index;
+} nearestWPCandidate_t;
+
+static int QDECL compare_nearest_wp_candidates(const void* a, const void* b)
+{
+	const nearestWPCandidate_t* ca = (const nearestWPCandidate_t*)a;
+	const nearestWPCandidate_t* cb = (const nearestWPCandidate_t*)b;
+
+	if (ca->dist != cb->dist)
+	{
+		return ca->dist < cb->dist ? -1 : 1;
+	}
+	return ca->index - cb->index;
+}
+
+//closest candidate in the pvs with a clear hull trace from org, checking closest first a batch at a time
+static int nearest_visible_candidate(vec3_t org, nearestWPCandidate_t* candidates, const int num_candidates,
+	const int ignore)
+{
+	traceRequest_t requests[NEAREST_WP_BATCH];
+	trace_t results[NEAREST_WP_BATCH];
+	int batch[NEAREST_WP_BATCH];
+	int next = 0;
+
+	qsort(candidates, num_candidates, sizeof candidates[0], compare_nearest_wp_candidates);
+
+	memset(requests, 0, sizeof requests);
+
+	while (next < num_candidates)
+	{
+		int count = 0;
+		int i;
+
+		//the pvs check is only done on candidates that get this far
+		while (count < NEAREST_WP_BATCH && next < num_candidates)
+		{
+			const int index = candidates[next++].index;
+
+			if (RMG.integer || bot_pvs_check(org, gWPArray[index]->origin))
+			{
+				batch[count++] = index;
+			}
+		}
+
+		if (!count)
+		{
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			traceRequest_t* request = &requests[i];
+
+			VectorCopy(org, request->start);
+			VectorCopy(gWPArray[batch[i]]->origin, request->end);
+			if (!RMG.integer)
+			{
+				VectorSet(request->mins, -15, -15, -1);
+				VectorSet(request->maxs, 15, 15, 1);
+			}
+			request->pass_entity_num = ignore;
+			request->contentmask = MASK_SOLID;
+		}
+
+		trap->TraceBatch(requests, results, count);
+
+		for (i = 0; i < count; i++)
+		{
+			if (results[i].fraction == 1 && !results[i].startsolid && !results[i].allsolid)
+			{
+				return batch[i];
+			}
+		}
+	}
+
+	return -1;
+}
+
 //get the index to the nearest visible waypoint in the global trail
 int get_nearest_visible_wp(vec3_t org, const int ignore)
 {
+	static nearestWPCandidate_t candidates[MAX_WPARRAY_SIZE];
+	static int nearby[MAX_WPARRAY_SIZE];
 	float bestdist;
-	vec3_t mins, maxs;
+	int num_candidates = 0;
 
-	int i = 0;
 	if (RMG.integer)
 	{
 		bestdist = 300;
@@ -2536,35 +2723,25 @@ int get_nearest_visible_wp(vec3_t org, const int ignore)
 		bestdist = 800; //99999;
 		//don't trace over 800 units away to avoid GIANT HORRIBLE SPEED HITS ^_^
 	}
-	int bestindex = -1;
 
-	mins[0] = -15;
-	mins[1] = -15;
-	mins[2] = -1;
-	maxs[0] = 15;
-	maxs[1] = 15;
-	maxs[2] = 1;
+	const int num_nearby = wp_grid_collect(org, bestdist, nearby);
 
-	while (i < gWPNum)
+	for (int n = 0; n < num_nearby; n++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse)
-		{
-			vec3_t a;
-			VectorSubtract(org, gWPArray[i]->origin, a);
-			const float flLen = VectorLength(a);
+		const int i = nearby[n];
+		vec3_t a;
+		VectorSubtract(org, gWPArray[i]->origin, a);
+		const float flLen = VectorLength(a);
 
-			if (flLen < bestdist && (RMG.integer || bot_pvs_check(org, gWPArray[i]->origin)) && org_visible_box(
-				org, mins, maxs, gWPArray[i]->origin, ignore))
-			{
-				bestdist = flLen;
-				bestindex = i;
-			}
+		if (flLen < bestdist)
+		{
+			candidates[num_candidates].dist = flLen;
+			candidates[num_candidates].index = i;
+			num_candidates++;
 		}
-
-		i++;
 	}
 
-	return bestindex;
+	return nearest_visible_candidate(org, candidates, num_candidates, ignore);
 }
 
 //visually scanning in the given direction.
@@ -2587,8 +2764,10 @@ void bot_be_still(bot_state_t* bs)
 //just like GetNearestVisibleWP except with a bad waypoint input
 int get_nearest_visible_wpsje(const bot_state_t* bs, vec3_t org, const int ignore, const int badwp)
 {
+	static nearestWPCandidate_t candidates[MAX_WPARRAY_SIZE];
+	static int nearby[MAX_WPARRAY_SIZE];
 	float bestdist;
-	vec3_t mins, maxs;
+	int num_candidates = 0;
 
 	if (RMG.integer)
 	{
@@ -2599,62 +2778,60 @@ int get_nearest_visible_wpsje(const bot_state_t* bs, vec3_t org, const int ignor
 		bestdist = 800; //99999;
 		//don't trace over 800 units away to avoid GIANT HORRIBLE SPEED HITS ^_^
 	}
-	int bestindex = -1;
 
-	mins[0] = -15;
-	mins[1] = -15;
-	mins[2] = -1;
-	maxs[0] = 15;
-	maxs[1] = 15;
-	maxs[2] = 1;
+	const int* avoided;
+	const int num_nearby = wp_grid_collect(org, bestdist, nearby);
+	const int num_avoided = wp_grid_avoided(&avoided);
 
-	for (int i = 0; i < gWPNum; i++)
+	//the boost below sets the distance of the avoided waypoints rather than adding to it,
+	//so they're candidates wherever they are and come from their own list
+	for (int n = 0; n < num_nearby + num_avoided; n++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse && i != badwp)
-		{
-			vec3_t a;
-			if (bs)
-			{
-				//check to make sure that this bot's team can use this waypoint
-				if (gWPArray[i]->flags & WPFLAG_REDONLY
-					&& g_entities[bs->client].client->sess.sessionTeam != TEAM_RED)
-				{
-					//red only wp, can't use
-					continue;
-				}
+		const int i = n < num_nearby ? nearby[n] : avoided[n - num_nearby];
+		vec3_t a;
 
-				if (gWPArray[i]->flags & WPFLAG_BLUEONLY
-					&& g_entities[bs->client].client->sess.sessionTeam != TEAM_BLUE)
-				{
-					//blue only wp, can't use
-					continue;
-				}
-			}
-
-			VectorSubtract(org, gWPArray[i]->origin, a);
-			float fl_len = VectorLength(a);
+		if (i == badwp || (n < num_nearby && gWPArray[i]->flags & WPFLAG_AVOID_MASK))
+		{
+			continue;
+		}
 
-			if (gWPArray[i]->flags & WPFLAG_WAITFORFUNC
-				|| gWPArray[i]->flags & WPFLAG_NOMOVEFUNC
-				|| gWPArray[i]->flags & WPFLAG_DESTROY_FUNCBREAK
-				|| gWPArray[i]->flags & WPFLAG_FORCEPUSH
-				|| gWPArray[i]->flags & WPFLAG_FORCEPULL)
+		if (bs)
+		{
+			//check to make sure that this bot's team can use this waypoint
+			if (gWPArray[i]->flags & WPFLAG_REDONLY
+				&& g_entities[bs->client].client->sess.sessionTeam != TEAM_RED)
 			{
-				//boost the distance for these waypoints so that we will try to avoid using them
-				//if at all possible
-				fl_len = +500;
+				//red only wp, can't use
+				continue;
 			}
 
-			if (fl_len < bestdist && (RMG.integer || bot_pvs_check(org, gWPArray[i]->origin)) && org_visible_box(
-				org, mins, maxs, gWPArray[i]->origin, ignore))
+			if (gWPArray[i]->flags & WPFLAG_BLUEONLY
+				&& g_entities[bs->client].client->sess.sessionTeam != TEAM_BLUE)
 			{
-				bestdist = fl_len;
-				bestindex = i;
+				//blue only wp, can't use
+				continue;
 			}
 		}
+
+		VectorSubtract(org, gWPArray[i]->origin, a);
+		float fl_len = VectorLength(a);
+
+		if (gWPArray[i]->flags & WPFLAG_AVOID_MASK)
+		{
+			//boost the distance for these waypoints so that we will try to avoid using them
+			//if at all possible
+			fl_len = +500;
+		}
+
+		if (fl_len < bestdist)
+		{
+			candidates[num_candidates].dist = fl_len;
+			candidates[num_candidates].index = i;
+			num_candidates++;
+		}
 	}
 
-	return bestindex;
+	return nearest_visible_candidate(org, candidates, num_candidates, ignore);
 }
 
 //just like GetNearestVisibleWP except without visiblity checks
@@ -65,6 +65,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define WPFLAG_FORCEPULL			0x10000000 //force pull all the active func_doors in the
 //area before moving to this waypoint.
 
+//bots would rather not path through these, their distance is boosted
+#define WPFLAG_AVOID_MASK			(WPFLAG_WAITFORFUNC|WPFLAG_NOMOVEFUNC|WPFLAG_DESTROY_FUNCBREAK|WPFLAG_FORCEPUSH|WPFLAG_FORCEPULL)
+
 #define LEVELFLAG_NOPOINTPREDICTION			1 //don't take waypoint beyond current into account when adjusting path view angles
 
 #define LEVELFLAG_IGNOREINFALLBACK			2 //ignore enemies when in a fallback navigation routine
@@ -489,6 +492,13 @@ void BotWaypointRender(void);
 int org_visible_box(vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore);
 int bot_is_a_chicken_wuss(bot_state_t* bs);
 int get_nearest_visible_wp(vec3_t org, int ignore);
+void wp_grid_invalidate(void);
+int wp_grid_collect(const vec3_t org, float radius, int* indexes);
+int wp_grid_avoided(const int** indexes);
+void wp_route_invalidate(void);
+qboolean wp_route_table_ready(void);
+int wp_route_next(int from, int to);
+float wp_route_link_cost(int from, int to);
 int get_best_idle_goal(bot_state_t* bs);
 
 char* ConcatArgs(int start);
@@ -42,6 +42,198 @@ int nodenum; //so we can connect broken trails
 
 int gLevelFlags = 0;
 
+/*
+=========================
+Waypoint grid
+
+Uniform grid over the in-use waypoints so the nearest waypoint searches only
+look at the cells around the point instead of the whole trail. Waypoints are
+sorted by cell, cell c's run is indexes[cells[c]] .. indexes[cells[c + 1] - 1].
+=========================
+*/
+
+#define WPGRID_CELL_SIZE	256
+#define WPGRID_MAX_CELLS	65536
+
+typedef struct wpGrid_s
+{
+	qboolean valid;
+	int numWaypoints; //gWPNum when built
+	vec3_t origin;
+	int cellSize;
+	int dims[3];
+	int cells[WPGRID_MAX_CELLS + 1];
+	int indexes[MAX_WPARRAY_SIZE];
+	int numAvoided;
+	int avoided[MAX_WPARRAY_SIZE]; //waypoints with WPFLAG_AVOID_MASK set
+} wpGrid_t;
+
+static wpGrid_t wp_grid;
+
+static int wp_grid_cell_coord(const float value, const int axis)
+{
+	return (int)floorf((value - wp_grid.origin[axis]) / wp_grid.cellSize);
+}
+
+static void wp_grid_build(void)
+{
+	static int cellOf[MAX_WPARRAY_SIZE];
+	vec3_t mins, maxs;
+	int numCells, i;
+	int num_inuse = 0;
+
+	wp_grid.valid = qtrue;
+	wp_grid.numWaypoints = gWPNum;
+	wp_grid.numAvoided = 0;
+	VectorSet(mins, Q3_INFINITE, Q3_INFINITE, Q3_INFINITE);
+	VectorSet(maxs, -Q3_INFINITE, -Q3_INFINITE, -Q3_INFINITE);
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (gWPArray[i] && gWPArray[i]->inuse)
+		{
+			AddPointToBounds(gWPArray[i]->origin, mins, maxs);
+			num_inuse++;
+
+			if (gWPArray[i]->flags & WPFLAG_AVOID_MASK)
+			{
+				wp_grid.avoided[wp_grid.numAvoided++] = i;
+			}
+		}
+	}
+
+	if (!num_inuse)
+	{
+		VectorClear(wp_grid.origin);
+		wp_grid.cellSize = WPGRID_CELL_SIZE;
+		wp_grid.dims[0] = wp_grid.dims[1] = wp_grid.dims[2] = 0;
+		wp_grid.cells[0] = 0;
+		return;
+	}
+
+	//grow the cells until the whole trail fits in the table
+	VectorCopy(mins, wp_grid.origin);
+	wp_grid.cellSize = WPGRID_CELL_SIZE;
+	for (;;)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			wp_grid.dims[i] = (int)((maxs[i] - mins[i]) / wp_grid.cellSize) + 1;
+		}
+
+		numCells = wp_grid.dims[0] * wp_grid.dims[1] * wp_grid.dims[2];
+		if (numCells <= WPGRID_MAX_CELLS)
+		{
+			break;
+		}
+		wp_grid.cellSize *= 2;
+	}
+
+	//counting sort by cell, so each cell's waypoints stay in index order
+	memset(wp_grid.cells, 0, sizeof(wp_grid.cells[0]) * (numCells + 1));
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (gWPArray[i] && gWPArray[i]->inuse)
+		{
+			const float* org = gWPArray[i]->origin;
+			const int x = Com_Clampi(0, wp_grid.dims[0] - 1, wp_grid_cell_coord(org[0], 0));
+			const int y = Com_Clampi(0, wp_grid.dims[1] - 1, wp_grid_cell_coord(org[1], 1));
+			const int z = Com_Clampi(0, wp_grid.dims[2] - 1, wp_grid_cell_coord(org[2], 2));
+
+			cellOf[i] = (z * wp_grid.dims[1] + y) * wp_grid.dims[0] + x;
+			wp_grid.cells[cellOf[i] + 1]++;
+		}
+	}
+
+	for (i = 0; i < numCells; i++)
+	{
+		wp_grid.cells[i + 1] += wp_grid.cells[i];
+	}
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (gWPArray[i] && gWPArray[i]->inuse)
+		{
+			//cells[c] walks forward to cells[c + 1] here and is put back below
+			wp_grid.indexes[wp_grid.cells[cellOf[i]]++] = i;
+		}
+	}
+
+	for (i = numCells; i > 0; i--)
+	{
+		wp_grid.cells[i] = wp_grid.cells[i - 1];
+	}
+	wp_grid.cells[0] = 0;
+}
+
+//the trail changed, rebuild the grid on the next search
+void wp_grid_invalidate(void)
+{
+	wp_grid.valid = qfalse;
+}
+
+//in-use waypoints in the grid cells touching the box of the given radius around org,
+//a superset of the ones within radius. Returns the number written to indexes.
+int wp_grid_collect(const vec3_t org, const float radius, int* indexes)
+{
+	int lo[3], hi[3];
+	int count = 0;
+
+	if (!wp_grid.valid || wp_grid.numWaypoints != gWPNum)
+	{
+		wp_grid_build();
+	}
+
+	if (!wp_grid.dims[0])
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		lo[i] = wp_grid_cell_coord(org[i] - radius, i);
+		hi[i] = wp_grid_cell_coord(org[i] + radius, i);
+
+		if (hi[i] < 0 || lo[i] >= wp_grid.dims[i])
+		{
+			return 0;
+		}
+		lo[i] = Com_Clampi(0, wp_grid.dims[i] - 1, lo[i]);
+		hi[i] = Com_Clampi(0, wp_grid.dims[i] - 1, hi[i]);
+	}
+
+	for (int z = lo[2]; z <= hi[2]; z++)
+	{
+		for (int y = lo[1]; y <= hi[1]; y++)
+		{
+			const int row = (z * wp_grid.dims[1] + y) * wp_grid.dims[0];
+			const int first = wp_grid.cells[row + lo[0]];
+			const int last = wp_grid.cells[row + hi[0] + 1];
+
+			//the cells along x are contiguous, so the whole row is one run
+			for (int n = first; n < last; n++)
+			{
+				indexes[count++] = wp_grid.indexes[n];
+			}
+		}
+	}
+
+	return count;
+}
+
+//in-use waypoints with any of WPFLAG_AVOID_MASK set, wherever they are
+int wp_grid_avoided(const int** indexes)
+{
+	if (!wp_grid.valid || wp_grid.numWaypoints != gWPNum)
+	{
+		wp_grid_build();
+	}
+
+	*indexes = wp_grid.avoided;
+	return wp_grid.numAvoided;
+}
+
 static char* GetFlagStr(const int flags)
 {
 	char* flagstr = B_TempAlloc(128);
@@ -1833,7 +2025,7 @@ static int GetNearestVisibleWPToItem(vec3_t org, const int ignore)
 {
 	vec3_t mins, maxs;
 
-	int i = 0;
+	static int nearby[MAX_WPARRAY_SIZE];
 	float bestdist = 64; //has to be less than 64 units to the item or it isn't safe enough
 	int bestindex = -1;
 
@@ -1844,25 +2036,27 @@ static int GetNearestVisibleWPToItem(vec3_t org, const int ignore)
 	maxs[1] = 15;
 	maxs[2] = 0;
 
-	while (i < gWPNum)
+	const int num_nearby = wp_grid_collect(org, bestdist, nearby);
+
+	for (int n = 0; n < num_nearby; n++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse &&
-			gWPArray[i]->origin[2] - 15 < org[2] &&
+		const int i = nearby[n];
+
+		if (gWPArray[i]->origin[2] - 15 < org[2] &&
 			gWPArray[i]->origin[2] + 15 > org[2])
 		{
 			vec3_t a;
 			VectorSubtract(org, gWPArray[i]->origin, a);
 			const float fl_len = VectorLength(a);
 
-			if (fl_len < bestdist && trap->InPVS(org, gWPArray[i]->origin) && org_visible_box(
-				org, mins, maxs, gWPArray[i]->origin, ignore))
+			//the grid isn't in index order, ties go to the lower index as the old scan had it
+			if ((fl_len < bestdist || (fl_len == bestdist && i < bestindex)) && trap->InPVS(org, gWPArray[i]->origin)
+				&& org_visible_box(org, mins, maxs, gWPArray[i]->origin, ignore))
 			{
 				bestdist = fl_len;
 				bestindex = i;
 			}
 		}
-
-		i++;
 	}
 
 	return bestindex;
@@ -3295,6 +3489,396 @@ static void BeginAutoPathRoutine(void)
 	RemoveWP(); //remove the dummy point at the end of the trail
 }
 
+/*
+=========================
+Waypoint route table
+
+Next hop from every waypoint to every other along the shortest route over the
+links find_ideal_pathto_wp follows, so a bot's route can be read off instead
+of searched for. The per-bot restrictions (team only waypoints, force jump
+level, the bad waypoint) aren't in the table, the bot checks them as it walks
+the route. Built once per trail and kept in botroutes/<map>.wnr next to the
+.wnt, keyed by a checksum of the trail.
+=========================
+*/
+
+#define WPROUTE_IDENT			INT_ID('W','N','R','T')
+#define WPROUTE_VERSION			1
+#define WPROUTE_MAX_WAYPOINTS	2048 //the table is this squared, past it bots search as before
+#define WPROUTE_NONE			0xFFFF
+
+typedef struct wpRouteHeader_s
+{
+	int ident;
+	int version;
+	int numWaypoints;
+	unsigned int trailChecksum;
+	unsigned int tableChecksum;
+} wpRouteHeader_t;
+
+typedef struct wpRouteHeap_s
+{
+	float dist;
+	int wp;
+} wpRouteHeap_t;
+
+static qboolean wp_route_ready = qfalse;
+static int wp_route_size; //waypoints the table was built for
+static unsigned short* wp_route_next_hops; //[from * wp_route_size + to]
+
+static unsigned int wp_route_checksum(unsigned int hash, const void* data, const int len)
+{
+	const byte* bytes = (const byte*)data;
+
+	//FNV-1a
+	for (int i = 0; i < len; i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//everything the links depend on
+static unsigned int wp_route_trail_checksum(void)
+{
+	unsigned int hash = 2166136261u;
+
+	hash = wp_route_checksum(hash, &gWPNum, sizeof gWPNum);
+
+	for (int i = 0; i < gWPNum; i++)
+	{
+		const int inuse = gWPArray[i] && gWPArray[i]->inuse;
+
+		hash = wp_route_checksum(hash, &inuse, sizeof inuse);
+		if (inuse)
+		{
+			const wpobject_t* wp = gWPArray[i];
+			const int oneway = wp->flags & (WPFLAG_ONEWAY_FWD | WPFLAG_ONEWAY_BACK);
+
+			hash = wp_route_checksum(hash, wp->origin, sizeof wp->origin);
+			hash = wp_route_checksum(hash, &oneway, sizeof oneway);
+			hash = wp_route_checksum(hash, &wp->disttonext, sizeof wp->disttonext);
+			hash = wp_route_checksum(hash, &wp->neighbornum, sizeof wp->neighbornum);
+			for (int n = 0; n < wp->neighbornum; n++)
+			{
+				hash = wp_route_checksum(hash, &wp->neighbors[n].num, sizeof wp->neighbors[n].num);
+			}
+		}
+	}
+
+	return hash;
+}
+
+//cost of stepping from one waypoint to another the way add_open_list scores it, -1 if
+//find_ideal_pathto_wp wouldn't take that step
+float wp_route_link_cost(const int from, const int to)
+{
+	if (from < 0 || from >= gWPNum || to < 0 || to >= gWPNum
+		|| !gWPArray[from] || !gWPArray[from]->inuse || !gWPArray[to] || !gWPArray[to]->inuse)
+	{
+		return -1;
+	}
+
+	if (to == from + 1)
+	{
+		return gWPArray[to]->flags & WPFLAG_ONEWAY_BACK ? -1 : gWPArray[from]->disttonext;
+	}
+
+	if (to == from - 1)
+	{
+		return gWPArray[to]->flags & WPFLAG_ONEWAY_FWD ? -1 : gWPArray[to]->disttonext;
+	}
+
+	//don't go through oneways on neighbor moves
+	if (gWPArray[to]->flags & (WPFLAG_ONEWAY_FWD | WPFLAG_ONEWAY_BACK))
+	{
+		return -1;
+	}
+	return Distance(gWPArray[from]->origin, gWPArray[to]->origin);
+}
+
+//the waypoints find_ideal_pathto_wp looks at next from this one
+static int wp_route_links(const int from, int* links)
+{
+	int num = 0;
+
+	//the sequential steps are only tried when the trail segment isn't too long
+	if (from + 1 < gWPNum && gWPArray[from]->disttonext < 1000)
+	{
+		links[num++] = from + 1;
+	}
+	if (from > 0 && gWPArray[from - 1] && gWPArray[from - 1]->disttonext < 1000)
+	{
+		links[num++] = from - 1;
+	}
+
+	for (int n = 0; n < gWPArray[from]->neighbornum; n++)
+	{
+		links[num++] = gWPArray[from]->neighbors[n].num;
+	}
+
+	return num;
+}
+
+static void wp_route_heap_push(wpRouteHeap_t* heap, int* count, const float dist, const int wp)
+{
+	int i = (*count)++;
+
+	while (i > 0 && heap[(i - 1) / 2].dist > dist)
+	{
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i].dist = dist;
+	heap[i].wp = wp;
+}
+
+static wpRouteHeap_t wp_route_heap_pop(wpRouteHeap_t* heap, int* count)
+{
+	const wpRouteHeap_t top = heap[0];
+	const wpRouteHeap_t last = heap[--*count];
+	int i = 0;
+
+	for (;;)
+	{
+		int child = i * 2 + 1;
+
+		if (child >= *count)
+		{
+			break;
+		}
+		if (child + 1 < *count && heap[child + 1].dist < heap[child].dist)
+		{
+			child++;
+		}
+		if (heap[child].dist >= last.dist)
+		{
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+
+	return top;
+}
+
+//a dijkstra flood from every waypoint, carrying along the first step each route took
+static void wp_route_build(void)
+{
+	const int size = wp_route_size;
+	const int maxLinks = size * (MAX_NEIGHBOR_SIZE + 2);
+	int* linkStart;
+	int* linkTo;
+	float* linkCost;
+	float* dist;
+	wpRouteHeap_t* heap;
+	int numLinks = 0;
+	int links[MAX_NEIGHBOR_SIZE + 2];
+
+	trap->TrueMalloc((void**)&linkStart, sizeof(int) * (size + 1));
+	trap->TrueMalloc((void**)&linkTo, sizeof(int) * maxLinks);
+	trap->TrueMalloc((void**)&linkCost, sizeof(float) * maxLinks);
+	trap->TrueMalloc((void**)&dist, sizeof(float) * size);
+	trap->TrueMalloc((void**)&heap, sizeof(wpRouteHeap_t) * (maxLinks + 1));
+
+	for (int from = 0; from < size; from++)
+	{
+		linkStart[from] = numLinks;
+		if (!gWPArray[from] || !gWPArray[from]->inuse)
+		{
+			continue;
+		}
+
+		const int num = wp_route_links(from, links);
+		for (int n = 0; n < num; n++)
+		{
+			const float cost = wp_route_link_cost(from, links[n]);
+
+			if (cost >= 0)
+			{
+				linkTo[numLinks] = links[n];
+				linkCost[numLinks] = cost;
+				numLinks++;
+			}
+		}
+	}
+	linkStart[size] = numLinks;
+
+	for (int start = 0; start < size; start++)
+	{
+		unsigned short* next = &wp_route_next_hops[start * size];
+		int count = 0;
+
+		for (int i = 0; i < size; i++)
+		{
+			next[i] = WPROUTE_NONE;
+			dist[i] = -1;
+		}
+
+		if (!gWPArray[start] || !gWPArray[start]->inuse)
+		{
+			continue;
+		}
+
+		dist[start] = 0;
+		next[start] = start;
+		wp_route_heap_push(heap, &count, 0, start);
+
+		while (count)
+		{
+			const wpRouteHeap_t top = wp_route_heap_pop(heap, &count);
+
+			if (top.dist > dist[top.wp])
+			{
+				//already reached a shorter way
+				continue;
+			}
+
+			for (int l = linkStart[top.wp]; l < linkStart[top.wp + 1]; l++)
+			{
+				const int to = linkTo[l];
+				const float to_dist = top.dist + linkCost[l];
+
+				if (dist[to] < 0 || to_dist < dist[to])
+				{
+					dist[to] = to_dist;
+					next[to] = top.wp == start ? to : next[top.wp];
+					wp_route_heap_push(heap, &count, to_dist, to);
+				}
+			}
+		}
+	}
+
+	trap->TrueFree((void**)&heap);
+	trap->TrueFree((void**)&dist);
+	trap->TrueFree((void**)&linkCost);
+	trap->TrueFree((void**)&linkTo);
+	trap->TrueFree((void**)&linkStart);
+}
+
+static qboolean wp_route_load(const char* path, const unsigned int trailChecksum)
+{
+	fileHandle_t f;
+	wpRouteHeader_t header;
+	const int tableSize = wp_route_size * wp_route_size * (int)sizeof(unsigned short);
+
+	const int len = trap->FS_Open(path, &f, FS_READ);
+	if (!f)
+	{
+		return qfalse;
+	}
+
+	if (len != (int)sizeof header + tableSize)
+	{
+		trap->FS_Close(f);
+		return qfalse;
+	}
+
+	trap->FS_Read(&header, sizeof header, f);
+	if (header.ident != (int)WPROUTE_IDENT || header.version != WPROUTE_VERSION
+		|| header.numWaypoints != wp_route_size || header.trailChecksum != trailChecksum)
+	{
+		trap->FS_Close(f);
+		return qfalse;
+	}
+
+	trap->FS_Read(wp_route_next_hops, tableSize, f);
+	trap->FS_Close(f);
+
+	return wp_route_checksum(2166136261u, wp_route_next_hops, tableSize) == header.tableChecksum;
+}
+
+static void wp_route_save(const char* path, const unsigned int trailChecksum)
+{
+	fileHandle_t f;
+	wpRouteHeader_t header;
+	const int tableSize = wp_route_size * wp_route_size * (int)sizeof(unsigned short);
+
+	trap->FS_Open(path, &f, FS_WRITE);
+	if (!f)
+	{
+		trap->Print(S_COLOR_YELLOW "Warning: Could not open %s to write the route table\n", path);
+		return;
+	}
+
+	header.ident = (int)WPROUTE_IDENT;
+	header.version = WPROUTE_VERSION;
+	header.numWaypoints = wp_route_size;
+	header.trailChecksum = trailChecksum;
+	header.tableChecksum = wp_route_checksum(2166136261u, wp_route_next_hops, tableSize);
+
+	trap->FS_Write(&header, sizeof header, f);
+	trap->FS_Write(wp_route_next_hops, tableSize, f);
+	trap->FS_Close(f);
+}
+
+//load the route table for this trail, or build it and save it for next time
+static void wp_route_setup(const char* mapname, const qboolean save)
+{
+	wp_route_free();
+
+	if (gWPNum < 2 || gWPNum > WPROUTE_MAX_WAYPOINTS)
+	{
+		return;
+	}
+
+	const char* path = va("botroutes/%s.wnr", mapname);
+	const unsigned int trailChecksum = wp_route_trail_checksum();
+
+	wp_route_size = gWPNum;
+	trap->TrueMalloc((void**)&wp_route_next_hops, wp_route_size * wp_route_size * sizeof(unsigned short));
+
+	if (!wp_route_load(path, trailChecksum))
+	{
+		const int start = trap->Milliseconds();
+
+		wp_route_build();
+		trap->Print("Built the bot route table for %i waypoints in %i msec\n", wp_route_size,
+			trap->Milliseconds() - start);
+
+		if (save)
+		{
+			wp_route_save(path, trailChecksum);
+		}
+	}
+
+	wp_route_ready = qtrue;
+}
+
+void wp_route_free(void)
+{
+	wp_route_ready = qfalse;
+
+	if (wp_route_next_hops)
+	{
+		trap->TrueFree((void**)&wp_route_next_hops);
+	}
+}
+
+//the trail changed, routes are searched for until the next level load
+void wp_route_invalidate(void)
+{
+	wp_route_ready = qfalse;
+}
+
+qboolean wp_route_table_ready(void)
+{
+	return wp_route_ready;
+}
+
+//the waypoint after from on the shortest route to to, -1 if there's no route
+int wp_route_next(const int from, const int to)
+{
+	if (!wp_route_ready || from < 0 || from >= wp_route_size || to < 0 || to >= wp_route_size)
+	{
+		return -1;
+	}
+
+	const int next = wp_route_next_hops[from * wp_route_size + to];
+	return next == WPROUTE_NONE ? -1 : next;
+}
+
 extern vmCvar_t bot_normgpath;
 
 void LoadPath_ThisLevel(void)
@@ -3304,6 +3888,8 @@ void LoadPath_ThisLevel(void)
 
 	trap->Cvar_Register(&mapname, "mapname", "", CVAR_SERVERINFO | CVAR_ROM);
 
+	wp_grid_invalidate();
+
 	if (RMG.integer)
 	{
 		//If RMG, generate the path on-the-fly
@@ -3343,6 +3929,11 @@ void LoadPath_ThisLevel(void)
 		gBotEdit = 0;
 	}
 
+	wp_grid_build();
+
+	//random maps get a new trail every time, don't keep their tables
+	wp_route_setup(mapname.string, !RMG.integer);
+
 	//set the flag entities
 	while (i < level.num_entities)
 	{
@@ -3467,6 +4058,10 @@ int AcceptBotCommand(const char* cmd, const gentity_t* pl)
 		return 0;
 	}
 
+	//most of these edit the trail
+	wp_grid_invalidate();
+	wp_route_invalidate();
+
 	if (Q_stricmp(cmd, "bot_wp_Cmdlist") == 0) //lists all the bot waypoint commands.
 	{
 		trap->Print(
@@ -1881,6 +1881,9 @@ int in_field_of_vision(vec3_t viewangles, float fov, vec3_t angles);
 void B_InitAlloc(void);
 void B_CleanupAlloc(void);
 
+// ai_wpnav.c
+void wp_route_free(void);
+
 //bot settings
 typedef struct bot_settings_s
 {
@@ -411,10 +411,9 @@ void G_InitGame(int levelTime, int randomSeed, int restart)
 	G_CacheMapname(&mapname);
 	trap->Cvar_Register(&ckSum, "sv_mapChecksum", "", CVAR_ROM);
 
-	// navCalculatePaths	= ( trap->Nav_Load( mapname.string, ckSum.integer ) == qfalse );
-	// commented line above. Was taking a lot of time to load some maps, example mp/duel7 and mp/siege_desert in FFA Mode
-	// now it will always force calculating paths
-	navCalculatePaths = qtrue;
+	// the .nav file carries the precomputed routes, so loading it skips CalculatePaths
+	// (it used to be skipped here because the routes were read one int at a time)
+	navCalculatePaths = (trap->Nav_Load(mapname.string, ckSum.integer) == qfalse);
 
 	// getting mapname
 	Q_strncpyz(sje_mapname, Info_ValueForKey(serverinfo, "mapname"), sizeof sje_mapname);
@@ -1682,6 +1681,7 @@ void G_ShutdownGame(const int restart)
 	}
 
 	B_CleanupAlloc(); //clean up all allocations made with B_Alloc
+	wp_route_free();
 }
 
 /*
@@ -401,6 +401,20 @@ typedef struct T_G_ICARUS_GETSETIDFORSTRING_s {
 	char string[2048];
 } T_G_ICARUS_GETSETIDFORSTRING;
 
+// a TraceBatch runs at most this many traces, results past it are left alone
+#define MAX_TRACE_BATCH 1024
+
+// one trace of a TraceBatch, the same arguments Trace takes
+typedef struct traceRequest_s {
+	vec3_t start, end;
+	vec3_t mins, maxs; // zero for a point trace
+	int pass_entity_num;
+	int contentmask;
+	int capsule;
+	int traceFlags;
+	int useLod;
+} traceRequest_t;
+
 typedef enum gameImportLegacy_e {
 	G_PRINT,
 	G_ERROR,
@@ -737,7 +751,8 @@ typedef enum gameImportLegacy_e {
 	G_CM_REGISTER_TERRAIN,
 	G_RMG_INIT,
 	G_BOT_UPDATEWAYPOINTS,
-	G_BOT_CALCULATEPATHS
+	G_BOT_CALCULATEPATHS,
+	G_TRACEBATCH
 } gameImportLegacy_t;
 
 typedef enum gameExportLegacy_e {
@@ -1122,6 +1137,9 @@ typedef struct gameImport_s {
 	void		(*G2API_CleanEntAttachments)			();
 	qboolean(*G2API_OverrideServer)					(void* serverInstance);
 	void		(*G2API_GetSurfaceName)					(void* ghoul2, int surfNumber, int model_index, char* fillBuf);
+
+	// independent traces in one call, results[i] answers requests[i]
+	void		(*TraceBatch)							(const traceRequest_t* requests, trace_t* results, int count);
 } gameImport_t;
 
 typedef struct gameExport_s {
@@ -192,6 +192,11 @@ void trap_Trace(trace_t* results, const vec3_t start, const vec3_t mins, const v
 	Q_syscall(G_TRACE, results, start, mins, maxs, end, pass_entity_num, contentmask, 0, 10);
 }
 
+void trap_TraceBatch(const traceRequest_t* requests, trace_t* results, const int count)
+{
+	Q_syscall(G_TRACEBATCH, requests, results, count);
+}
+
 void trap_G2Trace(trace_t* results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end,
 	const int pass_entity_num, const int contentmask, const int g2TraceType, const int traceLod)
 {
@@ -1779,6 +1784,7 @@ static void TranslateSyscalls(void)
 	trap->EntitiesInBox = trap_EntitiesInBox;
 	trap->EntityContact = SVSyscall_EntityContact;
 	trap->Trace = SVSyscall_Trace;
+	trap->TraceBatch = trap_TraceBatch;
 	trap->GetConfigstring = trap_GetConfigstring;
 	trap->GetEntityToken = trap_GetEntityToken;
 	trap->GetServerinfo = trap_GetServerinfo;
@@ -43,6 +43,7 @@ CBlockMember::CBlockMember(void)
 	m_id = -1;
 	m_size = -1;
 	m_data = nullptr;
+	m_shared = false;
 }
 
 CBlockMember::~CBlockMember(void)
@@ -60,13 +61,29 @@ void CBlockMember::Free(void)
 {
 	if (m_data != nullptr)
 	{
-		ICARUS_Free(m_data);
-		m_data = nullptr;
+		ReleaseData();
 
 		m_id = m_size = -1;
 	}
 }
 
+/*
+-------------------------
+ReleaseData
+-------------------------
+*/
+
+void CBlockMember::ReleaseData(void)
+{
+	if (m_data != nullptr && !m_shared)
+	{
+		ICARUS_Free(m_data);
+	}
+
+	m_data = nullptr;
+	m_shared = false;
+}
+
 /*
 -------------------------
 GetInfo
@@ -98,14 +115,23 @@ void CBlockMember::SetData(vector_t data)
 
 void CBlockMember::SetData(const void* data, const int size)
 {
-	if (m_data)
-		ICARUS_Free(m_data);
+	ReleaseData();
 
 	m_data = ICARUS_Malloc(size);
 	memcpy(m_data, data, size);
 	m_size = size;
 }
 
+void CBlockMember::SetSharedData(const int id, const int size, const void* data)
+{
+	ReleaseData();
+
+	m_id = id;
+	m_size = size;
+	m_data = const_cast<void*>(data);
+	m_shared = true;
+}
+
 //	Member I/O functions
 
 /*
@@ -391,6 +417,168 @@ CBlock* CBlock::Duplicate(void)
 	return newblock;
 }
 
+/*
+===================================================================================================
+
+  CBlockScript
+
+===================================================================================================
+*/
+
+static constexpr int BLOCK_SCRIPT_ALIGN = 8;
+
+static int BlockScript_Align(const int size)
+{
+	return (size + BLOCK_SCRIPT_ALIGN - 1) & ~(BLOCK_SCRIPT_ALIGN - 1);
+}
+
+/*
+-------------------------
+Compile
+
+Decodes the buffer the way CBlockStream::ReadBlock and CBlockMember::ReadMember would,
+counting everything on the first pass and filling in the script on the second. The
+second pass walks the same bytes, so only the first one can fail
+-------------------------
+*/
+
+CBlockScript* CBlockScript::Compile(const char* buffer, const long size)
+{
+	constexpr int headerSize = IBI_HEADER_ID_LENGTH + sizeof(float);
+	constexpr int blockHeaderSize = sizeof(int) * 2 + sizeof(char);
+	constexpr int memberHeaderSize = sizeof(int) * 2;
+	float version;
+
+	if (size < headerSize || memcmp(buffer, IBI_HEADER_ID, IBI_HEADER_ID_LENGTH))
+		return nullptr;
+
+	memcpy(&version, buffer + IBI_HEADER_ID_LENGTH, sizeof version);
+	if (version != IBI_VERSION)
+		return nullptr;
+
+	CBlockScript* script = nullptr;
+	char* data = nullptr;
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int numBlocks = 0;
+		int numMembers = 0;
+		int dataSize = 0;
+		long pos = headerSize;
+
+		while (pos < size)
+		{
+			int blockID, blockMembers;
+
+			if (pos + blockHeaderSize > size)
+				return nullptr;
+
+			memcpy(&blockID, buffer + pos, sizeof blockID);
+			memcpy(&blockMembers, buffer + pos + sizeof(int), sizeof blockMembers);
+
+			if (blockMembers < 0)
+				return nullptr;
+
+			if (script)
+			{
+				blockRecord_t& block = script->m_blocks[numBlocks];
+
+				block.id = blockID;
+				block.numMembers = blockMembers;
+				block.firstMember = numMembers;
+				block.flags = static_cast<unsigned char>(buffer[pos + sizeof(int) * 2]);
+			}
+
+			pos += blockHeaderSize;
+			numBlocks++;
+
+			while (blockMembers-- > 0)
+			{
+				int memberID, memberSize;
+
+				if (pos + memberHeaderSize > size)
+					return nullptr;
+
+				memcpy(&memberID, buffer + pos, sizeof memberID);
+				memcpy(&memberSize, buffer + pos + sizeof(int), sizeof memberSize);
+				memberID = LittleLong(memberID);
+				memberSize = LittleLong(memberSize);
+				pos += memberHeaderSize;
+
+				//random starts out as Q3_INFINITE so it's only rolled the first time a wait checks it
+				const bool random = memberID == ID_RANDOM;
+				if (random)
+					memberSize = sizeof(float);
+
+				if (memberSize < 0 || pos + memberSize > size)
+					return nullptr;
+
+				if (script)
+				{
+					memberRecord_t& member = script->m_members[numMembers];
+					char* memberData = data + dataSize;
+
+					if (random)
+					{
+						constexpr float infinite = Q3_INFINITE;
+						memcpy(memberData, &infinite, sizeof infinite);
+					}
+					else
+					{
+						memcpy(memberData, buffer + pos, memberSize);
+#ifdef Q3_BIG_ENDIAN
+						// only TK_INT, TK_VECTOR and TK_FLOAT has to be swapped, but just in case
+						if (memberSize == 4 && memberID != TK_STRING && memberID != TK_IDENTIFIER && memberID != TK_CHAR)
+							*(int*)memberData = LittleLong(*(int*)memberData);
+#endif
+					}
+
+					member.id = memberID;
+					member.size = memberSize;
+					member.data = memberData;
+				}
+
+				pos += memberSize;
+				numMembers++;
+				dataSize += BlockScript_Align(memberSize);
+			}
+		}
+
+		if (script)
+			break;
+
+		//everything in one allocation, the records first and the member data after them
+		const int blocksOffset = BlockScript_Align(sizeof(CBlockScript));
+		const int membersOffset = blocksOffset + BlockScript_Align(numBlocks * sizeof(blockRecord_t));
+		const int dataOffset = membersOffset + BlockScript_Align(numMembers * sizeof(memberRecord_t));
+		const auto arena = static_cast<char*>(ICARUS_Malloc(dataOffset + dataSize));
+
+		script = new(arena) CBlockScript;
+		script->m_numBlocks = numBlocks;
+		script->m_numMembers = numMembers;
+		script->m_blocks = reinterpret_cast<blockRecord_t*>(arena + blocksOffset);
+		script->m_members = reinterpret_cast<memberRecord_t*>(arena + membersOffset);
+		data = arena + dataOffset;
+	}
+
+	return script;
+}
+
+/*
+-------------------------
+Delete
+-------------------------
+*/
+
+void CBlockScript::Delete(CBlockScript* script)
+{
+	if (script)
+	{
+		script->~CBlockScript();
+		ICARUS_Free(script);
+	}
+}
+
 /*
 ===================================================================================================
 
@@ -403,6 +591,8 @@ CBlockStream::CBlockStream(void) : m_fileSize(0), m_fileHandle(nullptr), m_fileN
 {
 	m_stream = nullptr;
 	m_streamPos = 0;
+	m_script = nullptr;
+	m_blockNum = 0;
 }
 
 CBlockStream::~CBlockStream(void)
@@ -491,6 +681,8 @@ int CBlockStream::Free(void)
 
 	m_stream = nullptr;
 	m_streamPos = 0;
+	m_script = nullptr;
+	m_blockNum = 0;
 
 	return true;
 }
@@ -534,6 +726,8 @@ int CBlockStream::Init(void)
 
 	m_stream = nullptr;
 	m_streamPos = 0;
+	m_script = nullptr;
+	m_blockNum = 0;
 
 	return true;
 }
@@ -575,6 +769,9 @@ BlockAvailable
 
 int CBlockStream::BlockAvailable(void) const
 {
+	if (m_script)
+		return m_blockNum < m_script->GetNumBlocks();
+
 	if (m_streamPos >= m_fileSize)
 		return false;
 
@@ -592,6 +789,26 @@ int CBlockStream::ReadBlock(CBlock* get)
 	if (!BlockAvailable())
 		return false;
 
+	if (m_script)
+	{
+		const CBlockScript::blockRecord_t* block = m_script->GetBlock(m_blockNum++);
+
+		get->Create(block->id);
+		get->SetFlags(block->flags);
+		get->ReserveMembers(block->numMembers);
+
+		for (int i = 0; i < block->numMembers; i++)
+		{
+			const CBlockScript::memberRecord_t* member = m_script->GetMember(block->firstMember + i);
+			const auto bMember = new CBlockMember;
+
+			bMember->SetSharedData(member->id, member->size, member->data);
+			get->AddMember(bMember);
+		}
+
+		return true;
+	}
+
 	const int b_id = GetInteger();
 	int numMembers = GetInteger();
 	const unsigned char flags = static_cast<unsigned char>(GetChar());
@@ -653,4 +870,19 @@ int CBlockStream::Open(char* buffer, const long size)
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+/*
+-------------------------
+Open
+-------------------------
+*/
+
+int CBlockStream::Open(const CBlockScript* script)
+{
+	Init();
+
+	m_script = script;
+
+	return true;
+}
@@ -42,16 +42,14 @@ int ICARUS_entFilter = -1;
 
 /*
 =============
-ICARUS_GetScript
+ICARUS_FindScript
 
 gets the named script from the cache or disk if not already loaded
 =============
 */
 
-int ICARUS_GetScript(const char* name, char** buf)
+static pscript_t* ICARUS_FindScript(const char* name)
 {
-	//Make sure the caller is valid
-
 	//Attempt to retrieve a precached script
 	auto ei = ICARUS_BufferList.find(name);
 
@@ -59,7 +57,7 @@ int ICARUS_GetScript(const char* name, char** buf)
 	if (ei == ICARUS_BufferList.end())
 	{
 		if (ICARUS_RegisterScript(name) == false)
-			return 0;
+			return nullptr;
 
 		//Script is now inserted, retrieve it and pass through
 		ei = ICARUS_BufferList.find(name);
@@ -68,12 +66,58 @@ int ICARUS_GetScript(const char* name, char** buf)
 		{
 			//NOTENOTE: This is an internal error in STL if this happens...
 			assert(0);
-			return 0;
+			return nullptr;
 		}
 	}
 
-	*buf = (*ei).second->buffer;
-	return (*ei).second->length;
+	return (*ei).second;
+}
+
+/*
+=============
+ICARUS_GetScript
+
+gets the named script's buffer
+=============
+*/
+
+int ICARUS_GetScript(const char* name, char** buf)
+{
+	const pscript_t* pscript = ICARUS_FindScript(name);
+
+	if (pscript == nullptr)
+		return 0;
+
+	*buf = pscript->buffer;
+	return pscript->length;
+}
+
+/*
+=============
+ICARUS_GetCompiledScript
+
+gets the named script's parsed blocks, parsing it the first time it's run
+=============
+*/
+
+const CBlockScript* ICARUS_GetCompiledScript(const char* name)
+{
+	pscript_t* pscript = ICARUS_FindScript(name);
+
+	if (pscript == nullptr)
+		return nullptr;
+
+	if (pscript->compiled == nullptr)
+	{
+		pscript->compiled = CBlockScript::Compile(pscript->buffer, pscript->length);
+
+		if (pscript->compiled == nullptr)
+		{
+			Q3_DebugPrint(WL_ERROR, "'%s' : invalid stream\n", name);
+		}
+	}
+
+	return pscript->compiled;
 }
 
 /*
@@ -85,8 +129,7 @@ Runs the script by the given name
 */
 int ICARUS_RunScript(const sharedEntity_t* ent, const char* name)
 {
-	char* buf;
-	int len;
+	const CBlockScript* script;
 
 	//Make sure the caller is valid
 	if (gSequencers[ent->s.number] == nullptr)
@@ -128,17 +171,17 @@ int ICARUS_RunScript(const sharedEntity_t* ent, const char* name)
 		strcpy(namex, name);
 	}
 
-	len = ICARUS_GetScript(namex, &buf);
+	script = ICARUS_GetCompiledScript(namex);
 #else
-	len = ICARUS_GetScript(name, &buf);
+	script = ICARUS_GetCompiledScript(name);
 #endif
-	if (len == 0)
+	if (script == nullptr)
 	{
 		return false;
 	}
 
 	//Attempt to run the script
-	if S_FAILED(gSequencers[ent->s.number]->Run(buf, len))
+	if S_FAILED(gSequencers[ent->s.number]->Run(script))
 		return false;
 
 	if (ICARUS_entFilter == -1 || ICARUS_entFilter == ent->s.number)
@@ -204,6 +247,7 @@ void ICARUS_Shutdown(void)
 	{
 		//gi.Free( (*ei).second->buffer );
 		ICARUS_Free((*ei).second->buffer);
+		CBlockScript::Delete((*ei).second->compiled);
 		delete (*ei).second;
 	}
 
@@ -398,6 +442,7 @@ bool ICARUS_RegisterScript(const char* name, qboolean bCalledDuringInterrogate /
 	pscript->buffer = static_cast<char*>(ICARUS_Malloc(length)); //gi.Malloc(length, TAG_ICARUS, qfalse);
 	memcpy(pscript->buffer, buffer, length);
 	pscript->length = length;
+	pscript->compiled = nullptr;
 
 	FS_FreeFile(buffer);
 
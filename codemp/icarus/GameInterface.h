@@ -29,6 +29,7 @@ using pscript_t = struct pscript_s
 {
 	char* buffer;
 	long length;
+	CBlockScript* compiled; //parsed on first run, shared by everything running it
 };
 
 using entlist_t = std::map<std::string, int>;
@@ -39,6 +40,7 @@ extern interface_export_t interface_export;
 
 extern void Interface_Init(interface_export_t* pe);
 extern int ICARUS_RunScript(const sharedEntity_t* ent, const char* name);
+extern const CBlockScript* ICARUS_GetCompiledScript(const char* name);
 extern bool ICARUS_RegisterScript(const char* name, qboolean bCalledDuringInterrogate = qfalse);
 extern ICARUS_Instance* iICARUS;
 extern bufferlist_t ICARUS_BufferList;
@@ -67,6 +67,19 @@ static int Q3_ReadScript(const char* name, void** buf)
 	//get a (hopefully) cached file
 }
 
+/*
+============
+Q3_LoadScript
+  Description	: Gets the parsed form of a script, from the script directory
+  Return type	: static const CBlockScript *
+  Argument		: const char *name
+============
+*/
+static const CBlockScript* Q3_LoadScript(const char* name)
+{
+	return ICARUS_GetCompiledScript(va("%s/%s", Q3_SCRIPT_DIR, name));
+}
+
 /*
 ============
 Q3_CenterPrint
@@ -891,6 +904,7 @@ void Interface_Init(interface_export_t* pe)
 
 	//General
 	pe->I_LoadFile = Q3_ReadScript;
+	pe->I_LoadScript = Q3_LoadScript;
 	pe->I_CenterPrint = Q3_CenterPrint;
 	pe->I_DPrintf = Q3_DebugPrint;
 	pe->I_GetEntityByName = Q3_GetEntityByName;
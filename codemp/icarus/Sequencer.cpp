@@ -315,19 +315,15 @@ Run
 Runs a script
 ========================
 */
-int CSequencer::Run(char* buffer, const long size)
+int CSequencer::Run(const CBlockScript* script)
 {
 	Recall();
 
 	//Create a new stream
 	bstream_t* blockStream = AddStream();
 
-	//Open the stream as an IBI stream
-	if (!blockStream->stream->Open(buffer, size))
-	{
-		m_ie->I_DPrintf(WL_ERROR, "invalid stream");
-		return SEQ_FAILED;
-	}
+	//Read the stream from the already parsed script
+	blockStream->stream->Open(script);
 
 	CSequence* sequence = AddSequence(nullptr, m_curSequence, SQ_COMMON);
 
@@ -351,16 +347,15 @@ Parses a user triggered run command
 
 int CSequencer::ParseRun(CBlock* block)
 {
-	char* buffer = nullptr;
 	char newname[MAX_STRING_SIZE];
 
 	//Get the name and format it
 	COM_StripExtension(static_cast<char*>(block->GetMemberData(0)), newname, sizeof newname);
 
-	//Get the file from the game engine
-	const int buffer_size = m_ie->I_LoadFile(newname, reinterpret_cast<void**>(&buffer));
+	//Get the parsed script from the game engine
+	const CBlockScript* script = m_ie->I_LoadScript(newname);
 
-	if (buffer_size <= 0)
+	if (script == nullptr)
 	{
 		m_ie->I_DPrintf(WL_ERROR, "'%s' : could not open file\n", static_cast<char*>(block->GetMemberData(0)));
 		delete block;
@@ -371,14 +366,8 @@ int CSequencer::ParseRun(CBlock* block)
 	//Create a new stream for this file
 	bstream_t* new_stream = AddStream();
 
-	//Begin streaming the file
-	if (!new_stream->stream->Open(buffer, buffer_size))
-	{
-		m_ie->I_DPrintf(WL_ERROR, "invalid stream");
-		delete block;
-		block = nullptr;
-		return SEQ_FAILED;
-	}
+	//Begin streaming the script
+	new_stream->stream->Open(script);
 
 	//Create a new sequence
 	CSequence* new_sequence = AddSequence(m_curSequence, m_curSequence, SQ_RUN | SQ_PENDING);
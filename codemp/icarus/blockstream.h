@@ -90,13 +90,13 @@ public:
 
 	CBlockMember* Duplicate(void) const;
 
+	//Points the member at data owned by a compiled script instead of copying it
+	void SetSharedData(int id, int size, const void* data);
+
 	template <class T>
 	void WriteData(T& data)
 	{
-		if (m_data)
-		{
-			ICARUS_Free(m_data);
-		}
+		ReleaseData();
 
 		m_data = ICARUS_Malloc(sizeof(T));
 		*static_cast<T*>(m_data) = data;
@@ -106,10 +106,7 @@ public:
 	template <class T>
 	void WriteDataPointer(const T* data, const int num)
 	{
-		if (m_data)
-		{
-			ICARUS_Free(m_data);
-		}
+		ReleaseData();
 
 		m_data = ICARUS_Malloc(num * sizeof(T));
 		memcpy(m_data, data, num * sizeof(T));
@@ -117,9 +114,12 @@ public:
 	}
 
 protected:
+	void ReleaseData(void);
+
 	int m_id; //ID of the value contained in data
 	int m_size; //Size of the data member variable
 	void* m_data; //Data for this member
+	bool m_shared; //m_data belongs to a CBlockScript, it's replaced rather than written or freed
 };
 
 //CBlock
@@ -148,6 +148,7 @@ public:
 	//Member push / pop functions
 
 	int AddMember(CBlockMember*);
+	void ReserveMembers(const int num) { m_members.reserve(num); }
 	CBlockMember* GetMember(int member_num) const;
 
 	void* GetMemberData(int member_num) const;
@@ -170,6 +171,47 @@ protected:
 	unsigned char m_flags;
 };
 
+// CBlockScript
+
+// The parsed form of an .IBI buffer: every block's header and members decoded once
+// and laid out in a single allocation. Streams opened on it hand out blocks whose
+// members point at the script's data, so running a script doesn't reparse it or
+// copy its data; the blocks themselves are still each sequencer's own.
+
+class CBlockScript
+{
+public:
+	using blockRecord_t = struct blockRecord_s
+	{
+		int id;
+		int numMembers;
+		int firstMember;
+		unsigned char flags;
+	};
+
+	using memberRecord_t = struct memberRecord_s
+	{
+		int id;
+		int size;
+		const void* data;
+	};
+
+	static CBlockScript* Compile(const char* buffer, long size);
+	static void Delete(CBlockScript* script);
+
+	int GetNumBlocks(void) const { return m_numBlocks; }
+	const blockRecord_t* GetBlock(const int block_num) const { return &m_blocks[block_num]; }
+	const memberRecord_t* GetMember(const int member_num) const { return &m_members[member_num]; }
+
+protected:
+	CBlockScript(void) = default;
+
+	int m_numBlocks;
+	int m_numMembers;
+	blockRecord_t* m_blocks;
+	memberRecord_t* m_members;
+};
+
 // CBlockStream
 
 class CBlockStream
@@ -191,6 +233,7 @@ public:
 	int ReadBlock(CBlock*); //Read the block in
 
 	int Open(char*, long); //Open a stream for reading / writing
+	int Open(const CBlockScript* script); //Open a stream on an already parsed script
 
 protected:
 	unsigned GetUnsignedInteger(void);
@@ -206,4 +249,7 @@ protected:
 
 	char* m_stream; //Stream of data to be parsed
 	int m_streamPos;
+
+	const CBlockScript* m_script; //Parsed script being read instead of m_stream
+	int m_blockNum;
 };
@@ -28,11 +28,13 @@ using vec3_t = float[3];
 
 class CSequencer;
 class CTaskManager;
+class CBlockScript;
 
 using interface_export_t = struct interface_export_s
 {
 	//General
 	int (*I_LoadFile)(const char* name, void** buf);
+	const CBlockScript* (*I_LoadScript)(const char* name); //parsed form of the script, cached by name
 	void (*I_CenterPrint)(const char* format, ...);
 	void (*I_DPrintf)(int, const char*, ...);
 	sharedEntity_t* (*I_GetEntityByName)(const char* name);
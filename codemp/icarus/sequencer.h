@@ -92,7 +92,7 @@ public:
 	static CSequencer* Create(void);
 	int Free(void);
 
-	int Run(char* buffer, long size);
+	int Run(const CBlockScript* script);
 	int Callback(CTaskManager* task_manager, CBlock* block, int returnCode);
 
 	ICARUS_Instance* GetOwner(void) const { return m_owner; }
@@ -25,6 +25,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "cm_local.h"
 #include "qcommon/qfiles.h"
 
+#include <algorithm>
+
 #ifdef BSPC
 
 #include "../bspc/l_qfiles.h"
@@ -43,18 +45,16 @@ void SetPlaneSignbits(cplane_t* out) {
 }
 #endif //BSPC
 
-// to allow boxes to be treated as brush models, we allocate
-// some extra indexes along with those needed by the map
-#define	BOX_BRUSHES		1
+// to allow boxes to be treated as brush models, CM_TempBoxModel builds
+// a hull of this size per thread, see cmTempBox_t
 #define	BOX_SIDES		6
-#define	BOX_LEAFS		2
 #define	BOX_PLANES		12
 
 #define	LL(x) x=LittleLong(x)
 
 clipMap_t cmg; //rwwRMG - changed from cm
-int c_pointcontents;
-int c_traces, c_brush_traces, c_patch_traces;
+std::atomic<int> c_pointcontents;
+std::atomic<int> c_traces, c_brush_traces, c_patch_traces;
 
 byte* cmod_base;
 
@@ -63,19 +63,35 @@ cvar_t* cm_noAreas;
 cvar_t* cm_noCurves;
 cvar_t* cm_playerCurveClip;
 cvar_t* cm_extraVerbose;
+cvar_t* cm_debugSurfaceUpdate;
 #endif
 
-cmodel_t box_model;
-cplane_t* box_planes;
-cbrush_t* box_brush;
+// CM_TempBoxModel rewrites the box for every trace against an entity, so
+// each thread gets its own hull, wrapped in a clip map of its own
+using cmTempBox_t = struct cmTempBox_s
+{
+	bool initialized;
+	cmodel_t model;
+	cbrush_t brush;
+	cbrushside_t sides[BOX_SIDES];
+	cplane_t planes[BOX_PLANES];
+	int leafbrush;
+	clipMap_t map;
+};
+
+static thread_local cmTempBox_t box;
 
-void CM_InitBoxHull();
+static cmTempBox_t& CM_InitBoxHull();
 void CM_FloodAreaConnections(clipMap_t& cm);
 
 //rwwRMG - added:
 clipMap_t SubBSP[MAX_SUB_BSP];
 int NumSubBSP, TotalSubModels;
 
+// multi-check marks of the calling thread for the world, the sub bsps and
+// the temp box, see CM_BeginCheck
+static thread_local cmCheck_t cm_checks[1 + MAX_SUB_BSP + 1];
+
 /*
 ===============================================================================
 
@@ -293,7 +309,7 @@ void CMod_LoadBrushes(const lump_t* l, clipMap_t& cm)
 	}
 	const int count = l->filelen / sizeof * in;
 
-	cm.brushes = static_cast<cbrush_t*>(Hunk_Alloc((BOX_BRUSHES + count) * sizeof * cm.brushes, h_high));
+	cm.brushes = static_cast<cbrush_t*>(Hunk_Alloc(count * sizeof * cm.brushes, h_high));
 	cm.numBrushes = count;
 
 	cbrush_t* out = cm.brushes;
@@ -329,7 +345,7 @@ static void CMod_LoadLeafs(const lump_t* l, clipMap_t& cm)
 	if (count < 1)
 		Com_Error(ERR_DROP, "Map with no leafs");
 
-	cm.leafs = static_cast<cLeaf_t*>(Hunk_Alloc((BOX_LEAFS + count) * sizeof * cm.leafs, h_high));
+	cm.leafs = static_cast<cLeaf_t*>(Hunk_Alloc(count * sizeof * cm.leafs, h_high));
 	cm.numLeafs = count;
 
 	cLeaf_t* out = cm.leafs;
@@ -366,7 +382,7 @@ static void CMod_LoadPlanes(const lump_t* l, clipMap_t& cm)
 
 	if (count < 1)
 		Com_Error(ERR_DROP, "Map with no planes");
-	cm.planes = static_cast<cplane_s*>(Hunk_Alloc((BOX_PLANES + count) * sizeof * cm.planes, h_high));
+	cm.planes = static_cast<cplane_s*>(Hunk_Alloc(count * sizeof * cm.planes, h_high));
 	cm.num_planes = count;
 
 	cplane_t* out = cm.planes;
@@ -399,7 +415,7 @@ static void CMod_LoadLeafBrushes(const lump_t* l, clipMap_t& cm)
 		Com_Error(ERR_DROP, "CMod_LoadLeafBrushes: funny lump size");
 	const int count = l->filelen / sizeof * in;
 
-	cm.leafbrushes = static_cast<int*>(Hunk_Alloc((count + BOX_BRUSHES) * sizeof * cm.leafbrushes, h_high));
+	cm.leafbrushes = static_cast<int*>(Hunk_Alloc(count * sizeof * cm.leafbrushes, h_high));
 	cm.numLeafBrushes = count;
 
 	int* out = cm.leafbrushes;
@@ -447,7 +463,7 @@ static void CMod_LoadBrushSides(const lump_t* l, clipMap_t& cm)
 	}
 	const int count = l->filelen / sizeof * in;
 
-	cm.brushsides = static_cast<cbrushside_t*>(Hunk_Alloc((BOX_SIDES + count) * sizeof * cm.brushsides, h_high));
+	cm.brushsides = static_cast<cbrushside_t*>(Hunk_Alloc(count * sizeof * cm.brushsides, h_high));
 	cm.numBrushSides = count;
 
 	cbrushside_t* out = cm.brushsides;
@@ -647,6 +663,7 @@ static void CM_LoadMap_Actual(const char* name, const qboolean clientload, int*
 	cm_noCurves = Cvar_Get("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get("cm_playerCurveClip", "1", CVAR_ARCHIVE_ND | CVAR_CHEAT);
 	cm_extraVerbose = Cvar_Get("cm_extraVerbose", "0", CVAR_TEMP);
+	cm_debugSurfaceUpdate = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
 #endif
 	Com_DPrintf("CM_LoadMap( %s, %i )\n", name, clientload);
 
@@ -763,12 +780,6 @@ static void CM_LoadMap_Actual(const char* name, const qboolean clientload, int*
 
 	TotalSubModels += cm.numSubModels;
 
-	if (&cm == &cmg)
-	{
-		// Load in the shader text - return instantly if already loaded
-		CM_InitBoxHull();
-	}
-
 #ifndef BSPC	// I hope we can lose this crap soon
 	//
 	// if we've got enough memory, and it's not a dedicated-server, then keep the loaded map binary around
@@ -851,11 +862,12 @@ cmodel_t* CM_clip_handleToModel(const clip_handle_t handle, clipMap_t** clip_map
 	}
 	if (handle == BOX_MODEL_HANDLE)
 	{
+		cmTempBox_t& tempBox = CM_InitBoxHull();
 		if (clip_map)
 		{
-			*clip_map = &cmg;
+			*clip_map = &tempBox.map;
 		}
-		return &box_model;
+		return &tempBox.model;
 	}
 
 	int count = cmg.numSubModels;
@@ -935,47 +947,72 @@ CM_InitBoxHull
 
 Set up the planes and nodes so that the six floats of a bounding box
 can just be stored out and get a proper clipping hull structure.
+The hull belongs to the calling thread and only points back into the
+world for its shader and to tell whether a map is loaded.
 ===================
 */
-void CM_InitBoxHull()
+static cmTempBox_t& CM_InitBoxHull()
 {
-	box_planes = &cmg.planes[cmg.num_planes];
+	if (!box.initialized)
+	{
+		box.brush.numsides = BOX_SIDES;
+		box.brush.sides = box.sides;
+		box.brush.contents = CONTENTS_BODY;
 
-	box_brush = &cmg.brushes[cmg.numBrushes];
-	box_brush->numsides = 6;
-	box_brush->sides = cmg.brushsides + cmg.numBrushSides;
-	box_brush->contents = CONTENTS_BODY;
+		box.model.firstNode = -1;
+		box.model.leaf.numLeafBrushes = 1;
+		box.model.leaf.firstLeafBrush = 0;
+		box.leafbrush = 0;
 
-	box_model.firstNode = -1;
-	box_model.leaf.numLeafBrushes = 1;
-	//	box_model.leaf.firstLeafBrush = cmg.numBrushes;
-	box_model.leaf.firstLeafBrush = cmg.numLeafBrushes;
-	cmg.leafbrushes[cmg.numLeafBrushes] = cmg.numBrushes;
+		for (int i = 0; i < 6; i++)
+		{
+			const int side = i & 1;
+
+			// brush sides
+			cbrushside_t* s = &box.sides[i];
+			s->plane = &box.planes[i * 2 + side];
+
+			// planes
+			cplane_t* p = &box.planes[i * 2];
+			p->type = i >> 1;
+			p->signbits = 0;
+			VectorClear(p->normal);
+			p->normal[i >> 1] = 1;
+
+			p = &box.planes[i * 2 + 1];
+			p->type = 3 + (i >> 1);
+			p->signbits = 0;
+			VectorClear(p->normal);
+			p->normal[i >> 1] = -1;
+
+			SetPlaneSignbits(p);
+		}
 
-	for (int i = 0; i < 6; i++)
+		Q_strncpyz(box.map.name, "*box", sizeof box.map.name);
+		box.map.numBrushSides = BOX_SIDES;
+		box.map.brushsides = box.sides;
+		box.map.num_planes = BOX_PLANES;
+		box.map.planes = box.planes;
+		box.map.numLeafBrushes = 1;
+		box.map.leafbrushes = &box.leafbrush;
+		box.map.numBrushes = 1;
+		box.map.brushes = &box.brush;
+		box.map.numSubModels = 1;
+		box.map.cmodels = &box.model;
+
+		box.initialized = true;
+	}
+
+	// the box takes the spare shader slot at the end of the world's
+	for (cbrushside_t& s : box.sides)
 	{
-		const int side = i & 1;
-
-		// brush sides
-		cbrushside_t* s = &cmg.brushsides[cmg.numBrushSides + i];
-		s->plane = cmg.planes + (cmg.num_planes + i * 2 + side);
-		s->shader_num = cmg.numShaders;
-
-		// planes
-		cplane_t* p = &box_planes[i * 2];
-		p->type = i >> 1;
-		p->signbits = 0;
-		VectorClear(p->normal);
-		p->normal[i >> 1] = 1;
-
-		p = &box_planes[i * 2 + 1];
-		p->type = 3 + (i >> 1);
-		p->signbits = 0;
-		VectorClear(p->normal);
-		p->normal[i >> 1] = -1;
-
-		SetPlaneSignbits(p);
+		s.shader_num = cmg.numShaders;
 	}
+	box.map.numShaders = cmg.numShaders;
+	box.map.shaders = cmg.shaders;
+	box.map.numNodes = cmg.numNodes;
+
+	return box;
 }
 
 /*
@@ -989,8 +1026,11 @@ Capsules are handled differently though.
 */
 clip_handle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, const int capsule)
 {
-	VectorCopy(mins, box_model.mins);
-	VectorCopy(maxs, box_model.maxs);
+	cmTempBox_t& tempBox = CM_InitBoxHull();
+	cplane_t* box_planes = tempBox.planes;
+
+	VectorCopy(mins, tempBox.model.mins);
+	VectorCopy(maxs, tempBox.model.maxs);
 
 	if (capsule)
 	{
@@ -1010,12 +1050,58 @@ clip_handle_t CM_TempBoxModel(const vec3_t mins, const vec3_t maxs, const int ca
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
-	VectorCopy(mins, box_brush->bounds[0]);
-	VectorCopy(maxs, box_brush->bounds[1]);
+	VectorCopy(mins, tempBox.brush.bounds[0]);
+	VectorCopy(maxs, tempBox.brush.bounds[1]);
 
 	return BOX_MODEL_HANDLE;
 }
 
+/*
+===================
+CM_BeginCheck
+
+Starts a new query against local for the calling thread: anything marked
+with the returned count has been tested by this query.  Generations only
+ever grow, so marks left over from an earlier map can never match.
+===================
+*/
+cmCheck_t* CM_BeginCheck(const clipMap_t* local)
+{
+	cmCheck_t* check;
+
+	if (local == &cmg)
+	{
+		check = &cm_checks[0];
+	}
+	else if (local >= SubBSP && local < SubBSP + MAX_SUB_BSP)
+	{
+		check = &cm_checks[1 + (local - SubBSP)];
+	}
+	else
+	{
+		check = &cm_checks[1 + MAX_SUB_BSP];
+	}
+
+	if (check->brushes.size() < static_cast<size_t>(local->numBrushes))
+	{
+		check->brushes.resize(local->numBrushes);
+	}
+	if (check->patches.size() < static_cast<size_t>(local->numSurfaces))
+	{
+		check->patches.resize(local->numSurfaces);
+	}
+
+	if (++check->count == 0)
+	{
+		// wrapped, forget every old mark
+		std::fill(check->brushes.begin(), check->brushes.end(), 0);
+		std::fill(check->patches.begin(), check->patches.end(), 0);
+		check->count = 1;
+	}
+
+	return check;
+}
+
 /*
 ===================
 CM_ModelBounds
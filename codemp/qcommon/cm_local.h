@@ -27,6 +27,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "cm_public.h"
 #include "qcommon/qcommon.h"
 
+#include <atomic>
+#include <vector>
+
 #define	MAX_SUBMODELS			512
 #define	BOX_MODEL_HANDLE		(MAX_SUBMODELS-1)
 #define CAPSULE_MODEL_HANDLE	(MAX_SUBMODELS-2)
@@ -74,7 +77,6 @@ using cbrush_t = struct cbrush_s
 	vec3_t bounds[2];
 	cbrushside_t* sides;
 	unsigned short numsides;
-	unsigned short checkcount; // to avoid repeated testings
 };
 
 class CCMShader
@@ -96,7 +98,6 @@ public:
 
 using cPatch_t = struct cPatch_s
 {
-	int checkcount; // to avoid repeated testings
 	int surfaceFlags;
 	int contents;
 	struct patchCollide_s* pc;
@@ -155,7 +156,17 @@ using clipMap_t = struct clipMap_s
 	cPatch_t** surfaces; // non-patches will be NULL
 
 	int floodvalid;
-	int checkcount; // incremented on each trace
+};
+
+// brushes and patches already tested by the running query, so one that
+// crosses several leafs is only tested once.  Kept per thread and per clip
+// map rather than stamped into the shared map, so queries can run from
+// several threads at once
+using cmCheck_t = struct cmCheck_s
+{
+	unsigned int count; // current query, bumped by CM_BeginCheck
+	std::vector<unsigned int> brushes;
+	std::vector<unsigned int> patches;
 };
 
 // keep 1/8 unit away to keep the position valid before network snapping
@@ -163,12 +174,13 @@ using clipMap_t = struct clipMap_s
 #define	SURFACE_CLIP_EPSILON	(0.125)
 
 extern clipMap_t cmg; //rwwRMG - changed from cm
-extern int c_pointcontents;
-extern int c_traces, c_brush_traces, c_patch_traces;
+extern std::atomic<int> c_pointcontents; // traces may run on several threads
+extern std::atomic<int> c_traces, c_brush_traces, c_patch_traces;
 extern cvar_t* cm_noAreas;
 extern cvar_t* cm_noCurves;
 extern cvar_t* cm_playerCurveClip;
 extern cvar_t* cm_extraVerbose;
+extern cvar_t* cm_debugSurfaceUpdate;
 
 // cm_test.c
 
@@ -208,6 +220,7 @@ using traceWork_t = struct traceWork_s
 	cplane_t* clipplane;
 	bool startout;
 	bool getout;
+	cmCheck_t* check; // brushes and patches this trace has already tested
 };
 
 using leafList_t = struct leafList_s
@@ -222,11 +235,11 @@ using leafList_t = struct leafList_s
 };
 
 void CM_StoreLeafs(leafList_t* ll, int nodenum);
-void CM_StoreBrushes(leafList_t* ll, int nodenum);
 
 void CM_BoxLeafnums_r(leafList_t* ll, int nodenum);
 
 cmodel_t* CM_clip_handleToModel(clip_handle_t handle, clipMap_t** clip_map = nullptr);
+cmCheck_t* CM_BeginCheck(const clipMap_t* local);
 
 // cm_patch.c
 
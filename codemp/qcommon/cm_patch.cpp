@@ -64,6 +64,8 @@ int	c_totalPatchBlocks;
 int	c_totalPatchSurfaces;
 int	c_totalPatchEdges;
 
+// last patch facet hit, for r_debugSurface.  Only traces on the main thread
+// update it, batched traces on the job threads leave it alone.
 static const patchCollide_t* debugPatchCollide;
 static const facet_t* debugFacet;
 static qboolean		debugBlock;
@@ -1216,9 +1218,6 @@ static void CM_TracePointThroughPatchCollide(traceWork_t* tw, trace_t& trace, co
 	int			i, j, k;
 	float		offset;
 	float		d1, d2;
-#ifndef BSPC
-	static cvar_t* cv;
-#endif //BSPC
 
 #ifndef BSPC
 	if (!cm_playerCurveClip->integer || !tw->isPoint) {
@@ -1278,10 +1277,7 @@ static void CM_TracePointThroughPatchCollide(traceWork_t* tw, trace_t& trace, co
 		if (j == facet->numBorders) {
 			// we hit this facet
 #ifndef BSPC
-			if (!cv) {
-				cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
-			}
-			if (cv->integer) {
+			if (cm_debugSurfaceUpdate->integer && !Com_InJob()) {
 				debugPatchCollide = pc;
 				debugFacet = facet;
 			}
@@ -1363,9 +1359,6 @@ void CM_TraceThroughPatchCollide(traceWork_t* tw, trace_t& trace, const patchCol
 	patchPlane_t* planes;
 	facet_t* facet;
 	float plane[4] = { 0.0f }, bestplane[4] = { 0.0f };
-#ifndef BSPC
-	static cvar_t* cv;
-#endif //BSPC
 
 #ifndef CULL_BBOX
 	// I'm not sure if test is strictly correct.  Are all
@@ -1477,10 +1470,7 @@ void CM_TraceThroughPatchCollide(traceWork_t* tw, trace_t& trace, const patchCol
 					enterFrac = 0;
 				}
 #ifndef BSPC
-				if (!cv) {
-					cv = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
-				}
-				if (cv && cv->integer) {
+				if (cm_debugSurfaceUpdate->integer && !Com_InJob()) {
 					debugPatchCollide = pc;
 					debugFacet = facet;
 				}
@@ -48,6 +48,7 @@ void CM_TransformedBoxTrace(trace_t* trace, const vec3_t start, const vec3_t end
 	const vec3_t angles, int capsule);
 
 byte* CM_ClusterPVS(int cluster);
+int CM_NumClusters(void);
 
 int CM_PointLeafnum(const vec3_t p);
 
@@ -89,52 +89,6 @@ void CM_StoreLeafs(leafList_t* ll, const int nodenum)
 	ll->list[ll->count++] = leafNum;
 }
 
-void CM_StoreBrushes(leafList_t* ll, const int nodenum)
-{
-	int i;
-
-	const int leafnum = -1 - nodenum;
-
-	cLeaf_t* leaf = &cmg.leafs[leafnum];
-
-	for (int k = 0; k < leaf->numLeafBrushes; k++)
-	{
-		const int brushnum = cmg.leafbrushes[leaf->firstLeafBrush + k];
-		cbrush_t* b = &cmg.brushes[brushnum];
-		if (b->checkcount == cmg.checkcount)
-		{
-			continue; // already checked this brush in another leaf
-		}
-		b->checkcount = cmg.checkcount;
-		for (i = 0; i < 3; i++)
-		{
-			if (b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i])
-			{
-				break;
-			}
-		}
-		if (i != 3)
-		{
-			continue;
-		}
-		if (ll->count >= ll->maxcount)
-		{
-			ll->overflowed = qtrue;
-			return;
-		}
-		reinterpret_cast<cbrush_t**>(ll->list)[ll->count++] = b;
-	}
-#if 0
-	// store patches?
-	for (k = 0; k < leaf->numLeafSurfaces; k++) {
-		patch = cm.surfaces[cm.leafsurfaces[leaf->firstleafsurface + k]];
-		if (!patch) {
-			continue;
-		}
-	}
-#endif
-}
-
 /*
 =============
 CM_BoxLeafnums
@@ -183,8 +137,6 @@ int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int* boxList, const int
 	//rwwRMG - changed to boxList to not conflict with list type
 	leafList_t ll{};
 
-	cmg.checkcount++;
-
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
 	ll.count = 0;
@@ -319,6 +271,11 @@ byte* CM_ClusterPVS(const int cluster)
 	return cmg.visibility + cluster * cmg.clusterBytes;
 }
 
+int CM_NumClusters(void)
+{
+	return cmg.numClusters;
+}
+
 /*
 ===============================================================================
 
@@ -233,11 +233,11 @@ void CM_TestInLeaf(traceWork_t* tw, trace_t& trace, cLeaf_t* leaf, clipMap_t* lo
 	{
 		const int brushnum = local->leafbrushes[leaf->firstLeafBrush + k];
 		cbrush_t* b = &local->brushes[brushnum];
-		if (b->checkcount == local->checkcount)
+		if (tw->check->brushes[brushnum] == tw->check->count)
 		{
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		tw->check->brushes[brushnum] = tw->check->count;
 
 		if (!(b->contents & tw->contents))
 		{
@@ -260,16 +260,17 @@ void CM_TestInLeaf(traceWork_t* tw, trace_t& trace, cLeaf_t* leaf, clipMap_t* lo
 #endif //BSPC
 		for (k = 0; k < leaf->numLeafSurfaces; k++)
 		{
-			cPatch_t* patch = local->surfaces[local->leafsurfaces[leaf->firstLeafSurface + k]];
+			const int surfacenum = local->leafsurfaces[leaf->firstLeafSurface + k];
+			cPatch_t* patch = local->surfaces[surfacenum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == local->checkcount)
+			if (tw->check->patches[surfacenum] == tw->check->count)
 			{
 				continue; // already checked this brush in another leaf
 			}
-			patch->checkcount = local->checkcount;
+			tw->check->patches[surfacenum] = tw->check->count;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -395,8 +396,10 @@ void CM_TestBoundingBoxInCapsule(traceWork_t * tw, trace_t & trace, const clip_h
 	// replace the capsule with the bounding box
 	const clip_handle_t h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmodel_t* cmod = CM_clip_handleToModel(h);
-	CM_TestInLeaf(tw, trace, &cmod->leaf, &cmg);
+	clipMap_t* boxMap;
+	cmodel_t* cmod = CM_clip_handleToModel(h, &boxMap);
+	tw->check = CM_BeginCheck(boxMap);
+	CM_TestInLeaf(tw, trace, &cmod->leaf, boxMap);
 }
 
 /*
@@ -429,11 +432,9 @@ void CM_PositionTest(traceWork_t * tw, trace_t & trace)
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
 
-	cmg.checkcount++;
-
 	CM_BoxLeafnums_r(&ll, 0);
 
-	cmg.checkcount++;
+	tw->check = CM_BeginCheck(&cmg);
 
 	// test the contents of the leafs
 	for (i = 0; i < ll.count; i++)
@@ -685,11 +686,11 @@ void CM_TraceThroughLeaf(traceWork_t * tw, trace_t & trace, clipMap_t * local, c
 		const int brushnum = local->leafbrushes[leaf->firstLeafBrush + k];
 
 		cbrush_t* b = &local->brushes[brushnum];
-		if (b->checkcount == local->checkcount)
+		if (tw->check->brushes[brushnum] == tw->check->count)
 		{
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		tw->check->brushes[brushnum] = tw->check->count;
 
 		if (!(b->contents & tw->contents))
 		{
@@ -713,16 +714,17 @@ void CM_TraceThroughLeaf(traceWork_t * tw, trace_t & trace, clipMap_t * local, c
 #endif
 		for (k = 0; k < leaf->numLeafSurfaces; k++)
 		{
-			cPatch_t* patch = local->surfaces[local->leafsurfaces[leaf->firstLeafSurface + k]];
+			const int surfacenum = local->leafsurfaces[leaf->firstLeafSurface + k];
+			cPatch_t* patch = local->surfaces[surfacenum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == local->checkcount)
+			if (tw->check->patches[surfacenum] == tw->check->count)
 			{
 				continue; // already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
+			tw->check->patches[surfacenum] = tw->check->count;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -1052,8 +1054,10 @@ void CM_TraceBoundingBoxThroughCapsule(traceWork_t * tw, trace_t & trace, const
 	// replace the capsule with the bounding box
 	const clip_handle_t h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
 	// calculate collision
-	cmodel_t* cmod = CM_clip_handleToModel(h);
-	CM_TraceThroughLeaf(tw, trace, &cmg, &cmod->leaf);
+	clipMap_t* boxMap;
+	cmodel_t* cmod = CM_clip_handleToModel(h, &boxMap);
+	tw->check = CM_BeginCheck(boxMap);
+	CM_TraceThroughLeaf(tw, trace, boxMap, &cmod->leaf);
 }
 
 //=========================================================================================
@@ -1073,11 +1077,11 @@ void CM_TraceToLeaf(traceWork_t * tw, trace_t & trace, cLeaf_t * leaf, clipMap_t
 		const int brushnum = local->leafbrushes[leaf->firstLeafBrush + k];
 
 		cbrush_t* b = &local->brushes[brushnum];
-		if (b->checkcount == local->checkcount)
+		if (tw->check->brushes[brushnum] == tw->check->count)
 		{
 			continue; // already checked this brush in another leaf
 		}
-		b->checkcount = local->checkcount;
+		tw->check->brushes[brushnum] = tw->check->count;
 
 		if (!(b->contents & tw->contents))
 		{
@@ -1100,16 +1104,17 @@ void CM_TraceToLeaf(traceWork_t * tw, trace_t & trace, cLeaf_t * leaf, clipMap_t
 #endif
 		for (k = 0; k < leaf->numLeafSurfaces; k++)
 		{
-			cPatch_t* patch = local->surfaces[local->leafsurfaces[leaf->firstLeafSurface + k]];
+			const int surfacenum = local->leafsurfaces[leaf->firstLeafSurface + k];
+			cPatch_t* patch = local->surfaces[surfacenum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == local->checkcount)
+			if (tw->check->patches[surfacenum] == tw->check->count)
 			{
 				continue; // already checked this patch in another leaf
 			}
-			patch->checkcount = local->checkcount;
+			tw->check->patches[surfacenum] = tw->check->count;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -1302,8 +1307,6 @@ void CM_Trace(trace_t * trace, const vec3_t start, const vec3_t end,
 
 	cmodel_t* cmod = CM_clip_handleToModel(model, &local);
 
-	local->checkcount++; // for multi-check avoidance
-
 	c_traces++; // for statistics, may be zeroed
 
 	// fill in a default trace
@@ -1317,6 +1320,8 @@ void CM_Trace(trace_t * trace, const vec3_t start, const vec3_t end,
 		return; // map not loaded, shouldn't happen
 	}
 
+	tw.check = CM_BeginCheck(local); // for multi-check avoidance
+
 	// allow NULL to be passed in for 0,0,0
 	if (!mins)
 	{
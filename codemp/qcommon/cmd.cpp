@@ -346,6 +346,7 @@ static void Cmd_Echo_f(void)
 using cmd_function_t = struct cmd_function_s
 {
 	cmd_function_s* next;
+	cmd_function_s* hashNext;
 	char* name;
 	char* description;
 	xcommand_t function;
@@ -359,6 +360,27 @@ static char cmd_cmd[BIG_INFO_STRING]; // the original command we received (no to
 
 static cmd_function_t* cmd_functions; // possible commands to execute
 
+#define CMD_HASH_SIZE		512
+static cmd_function_t* cmd_hashTable[CMD_HASH_SIZE]; // the same commands, by lowercased name
+
+/*
+================
+Cmd_HashValue
+
+return a hash value for the command name, ignoring case
+================
+*/
+static int Cmd_HashValue(const char* cmd_name)
+{
+	int hash = 0;
+	for (int i = 0; cmd_name[i] != '\0'; i++)
+	{
+		const char letter = tolower(static_cast<unsigned char>(cmd_name[i]));
+		hash += static_cast<int>(letter) * (i + 119);
+	}
+	return hash & (CMD_HASH_SIZE - 1);
+}
+
 /*
 ============
 Cmd_Argc
@@ -670,7 +692,7 @@ Cmd_FindCommand
 */
 static cmd_function_t* Cmd_FindCommand(const char* cmd_name)
 {
-	for (cmd_function_t* cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd_function_t* cmd = cmd_hashTable[Cmd_HashValue(cmd_name)]; cmd; cmd = cmd->hashNext)
 		if (!Q_stricmp(cmd_name, cmd->name))
 			return cmd;
 	return nullptr;
@@ -705,6 +727,10 @@ void Cmd_AddCommand(const char* cmd_name, const xcommand_t function, const char*
 	cmd->complete = nullptr;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+
+	const int hash = Cmd_HashValue(cmd_name);
+	cmd->hashNext = cmd_hashTable[hash];
+	cmd_hashTable[hash] = cmd;
 }
 
 void Cmd_AddCommandList(const cmdList_t* cmdList)
@@ -732,11 +758,10 @@ Cmd_SetCommandCompletionFunc
 */
 void Cmd_SetCommandCompletionFunc(const char* command, const completionFunc_t complete)
 {
-	for (cmd_function_t* cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!Q_stricmp(command, cmd->name))
-			cmd->complete = complete;
-	}
+	cmd_function_t* cmd = Cmd_FindCommand(command);
+
+	if (cmd)
+		cmd->complete = complete;
 }
 
 /*
@@ -746,25 +771,36 @@ Cmd_RemoveCommand
 */
 void Cmd_RemoveCommand(const char* cmd_name)
 {
-	cmd_function_t** back = &cmd_functions;
+	cmd_function_t** hashBack = &cmd_hashTable[Cmd_HashValue(cmd_name)];
 	while (true)
 	{
-		cmd_function_t* cmd = *back;
-		if (!cmd)
+		if (!*hashBack)
 		{
 			// command wasn't active
 			return;
 		}
-		if (strcmp(cmd_name, cmd->name) == 0)
+		if (strcmp(cmd_name, (*hashBack)->name) == 0)
+		{
+			break;
+		}
+		hashBack = &(*hashBack)->hashNext;
+	}
+
+	cmd_function_t* cmd = *hashBack;
+	*hashBack = cmd->hashNext;
+
+	for (cmd_function_t** back = &cmd_functions; *back; back = &(*back)->next)
+	{
+		if (*back == cmd)
 		{
 			*back = cmd->next;
-			Z_Free(cmd->name);
-			Z_Free(cmd->description);
-			Z_Free(cmd);
-			return;
+			break;
 		}
-		back = &cmd->next;
 	}
+
+	Z_Free(cmd->name);
+	Z_Free(cmd->description);
+	Z_Free(cmd);
 }
 
 /*
@@ -842,11 +878,10 @@ Cmd_CompleteArgument
 */
 void Cmd_CompleteArgument(const char* command, char* args, const int argNum)
 {
-	for (const cmd_function_t* cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!Q_stricmp(command, cmd->name) && cmd->complete)
-			cmd->complete(args, argNum);
-	}
+	const cmd_function_t* cmd = Cmd_FindCommand(command);
+
+	if (cmd && cmd->complete)
+		cmd->complete(args, argNum);
 }
 
 /*
@@ -858,8 +893,6 @@ A complete command line has been parsed, so try to execute it
 */
 void Cmd_ExecuteString(const char* text)
 {
-	cmd_function_t* cmd = nullptr;
-
 	// execute the command line
 	Cmd_TokenizeString(text);
 	if (!Cmd_Argc())
@@ -867,27 +900,14 @@ void Cmd_ExecuteString(const char* text)
 		return; // no tokens
 	}
 
-	// check registered command functions
-	for (cmd_function_t** prev = &cmd_functions; *prev; prev = &cmd->next)
+	// check registered command functions, a command without a
+	// function is left for the cgame or game to handle
+	const cmd_function_t* cmd = Cmd_FindCommand(Cmd_Argv(0));
+	if (cmd && cmd->function)
 	{
-		cmd = *prev;
-		if (!Q_stricmp(Cmd_Argv(0), cmd->name))
-		{
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmd->next;
-			cmd->next = cmd_functions;
-			cmd_functions = cmd;
-
-			// perform the action
-			if (!cmd->function)
-			{
-				// let the cgame or game handle it
-				break;
-			}
-			cmd->function();
-			return;
-		}
+		// perform the action
+		cmd->function();
+		return;
 	}
 
 	// check cvars
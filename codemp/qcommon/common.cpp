@@ -29,6 +29,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/game_version.h"
 #include "../server/NPCNav/navigator.h"
 #include "../shared/sys/sys_local.h"
+
+#include <atomic>
+
 #if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -261,6 +264,18 @@ void NORETURN QDECL Com_Error(int level, const char* fmt, ...)
 	static int lastErrorTime;
 	static int errorCount;
 
+	// a job can't shut anything down, the batch reports it on the main thread
+	if (Com_InJob())
+	{
+		char message[MAXPRINTMSG];
+
+		va_start(argptr, fmt);
+		Q_vsnprintf(message, sizeof message, fmt, argptr);
+		va_end(argptr);
+
+		Com_JobError(level, message);
+	}
+
 	if (com_errorEntered)
 	{
 		Sys_Error("recursive error after: %s", com_errorMessage);
@@ -1357,6 +1372,9 @@ void Com_Init(char* commandLine)
 
 		com_bootlogo = Cvar_Get("com_bootlogo", "1", CVAR_ARCHIVE_ND, "Show intro movies");
 
+		Com_InitJobs();
+		Com_InitProfile();
+
 		s = va("%s %s %s", JK_VERSION_OLD, PLATFORM_STRING, SOURCE_DATE);
 		com_version = Cvar_Get("version", s, CVAR_ROM | CVAR_SERVERINFO);
 
@@ -1607,6 +1625,8 @@ void Com_Frame(void)
 		int timeBeforeClient = 0;
 		int timeAfter = 0;
 
+		Com_ProfileFrame();
+
 		// write config file if anything changed
 		Com_WriteConfiguration();
 
@@ -1760,11 +1780,11 @@ void Com_Frame(void)
 		//
 		if (com_showtrace->integer)
 		{
-			extern int c_traces, c_brush_traces, c_patch_traces;
-			extern int c_pointcontents;
+			extern std::atomic<int> c_traces, c_brush_traces, c_patch_traces;
+			extern std::atomic<int> c_pointcontents;
 
-			Com_Printf("%4i traces  (%ib %ip) %4i points\n", c_traces,
-				c_brush_traces, c_patch_traces, c_pointcontents);
+			Com_Printf("%4i traces  (%ib %ip) %4i points\n", c_traces.load(),
+				c_brush_traces.load(), c_patch_traces.load(), c_pointcontents.load());
 			c_traces = 0;
 			c_brush_traces = 0;
 			c_patch_traces = 0;
@@ -1822,6 +1842,9 @@ void Com_Shutdown(void)
 	}
 
 	MSG_shutdownHuffman();
+
+	Com_ShutdownJobs();
+	Com_ShutdownProfile();
 	/*
 		// Only used for testing changes to huffman frequency table when tuning.
 		{
@@ -2053,13 +2076,32 @@ Field_CompleteFilename
 void Field_CompleteFilename(const char* dir, const char* ext, const qboolean stripExt,
 	const qboolean allowNonPureFilesOnDisk)
 {
+	Field_CompleteFilenames(dir, &ext, 1, stripExt, allowNonPureFilesOnDisk);
+}
+
+/*
+===============
+Field_CompleteFilenames
+
+Completes from the files with any of the given extensions
+===============
+*/
+void Field_CompleteFilenames(const char* dir, const char* const* exts, const int numExts, const qboolean stripExt,
+	const qboolean allowNonPureFilesOnDisk)
+{
+	int i;
+
 	matchCount = 0;
 	shortestMatch[0] = 0;
 
-	FS_FilenameCompletion(dir, ext, stripExt, FindMatches, allowNonPureFilesOnDisk);
+	for (i = 0; i < numExts; i++)
+		FS_FilenameCompletion(dir, exts[i], stripExt, FindMatches, allowNonPureFilesOnDisk);
 
 	if (!Field_Complete())
-		FS_FilenameCompletion(dir, ext, stripExt, PrintFileMatches, allowNonPureFilesOnDisk);
+	{
+		for (i = 0; i < numExts; i++)
+			FS_FilenameCompletion(dir, exts[i], stripExt, PrintFileMatches, allowNonPureFilesOnDisk);
+	}
 }
 
 /*
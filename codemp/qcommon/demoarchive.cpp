@@ -0,0 +1,366 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// demoarchive.cpp -- reading and writing the compressed, keyframed demo
+// archive described in qfiles.h.  The writing side is called from the server's
+// demo writer thread, so it must not touch the zone or the console.
+
+#include "qcommon/qcommon.h"
+
+#include <vector>
+
+#include <zlib.h>
+
+// sanity limit for a block, the server cuts them far smaller
+#define DEMO_MAX_BLOCK (16 * 1024 * 1024)
+
+/*
+==============================================================================
+
+WRITING
+
+==============================================================================
+*/
+
+/*
+==================
+Demo_WriteArchiveHeader
+
+Returns the number of bytes written, 0 if the write failed
+==================
+*/
+int Demo_WriteArchiveHeader(const fileHandle_t f, const int keyframeMsec)
+{
+	demoArchiveHeader_t header;
+
+	header.ident = LittleLong(DEMO_ARCHIVE_IDENT);
+	header.version = LittleLong(DEMO_ARCHIVE_VERSION);
+	header.protocol = LittleLong(PROTOCOL_VERSION);
+	header.keyframeMsec = LittleLong(keyframeMsec);
+
+	return FS_WriteQuiet(&header, sizeof header, f);
+}
+
+/*
+==================
+Demo_WriteArchiveBlock
+
+Compresses length bytes of the message stream into one block.  Returns the
+number of bytes written, 0 if it failed.
+==================
+*/
+int Demo_WriteArchiveBlock(const fileHandle_t f, const int type, const void* data, const int length)
+{
+	std::vector<byte> compressed(compressBound(length));
+	uLongf compressedLength = compressed.size();
+
+	if (compress2(compressed.data(), &compressedLength, static_cast<const Bytef*>(data), length,
+		Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		return 0;
+	}
+
+	demoArchiveBlock_t block;
+	block.type = LittleLong(type);
+	block.rawLength = LittleLong(length);
+	block.compressedLength = LittleLong(static_cast<int>(compressedLength));
+
+	if (!FS_WriteQuiet(&block, sizeof block, f)
+		|| !FS_WriteQuiet(compressed.data(), static_cast<int>(compressedLength), f))
+	{
+		return 0;
+	}
+	return static_cast<int>(sizeof block + compressedLength);
+}
+
+/*
+==================
+Demo_WriteArchiveIndex
+
+Ends the archive, indexOffset is where the index is about to be written.
+Returns the number of bytes written, 0 if anything failed.
+==================
+*/
+int Demo_WriteArchiveIndex(const fileHandle_t f, const demoKeyframe_t* keyframes, const int numKeyframes,
+	const int indexOffset)
+{
+	int written = 0;
+
+	for (int i = 0; i < numKeyframes; i++)
+	{
+		demoKeyframe_t keyframe;
+		keyframe.serverTime = LittleLong(keyframes[i].serverTime);
+		keyframe.sequence = LittleLong(keyframes[i].sequence);
+		keyframe.offset = LittleLong(keyframes[i].offset);
+		if (!FS_WriteQuiet(&keyframe, sizeof keyframe, f))
+		{
+			return 0;
+		}
+		written += sizeof keyframe;
+	}
+
+	demoArchiveFooter_t footer;
+	footer.numKeyframes = LittleLong(numKeyframes);
+	footer.indexOffset = LittleLong(indexOffset);
+	footer.ident = LittleLong(DEMO_INDEX_IDENT);
+
+	if (!FS_WriteQuiet(&footer, sizeof footer, f))
+	{
+		return 0;
+	}
+	return written + static_cast<int>(sizeof footer);
+}
+
+/*
+==============================================================================
+
+READING
+
+==============================================================================
+*/
+
+static void Demo_Reserve(byte** buffer, int* size, const int needed)
+{
+	if (*size >= needed)
+	{
+		return;
+	}
+
+	if (*buffer)
+	{
+		Z_Free(*buffer);
+	}
+	*size = needed;
+	*buffer = static_cast<byte*>(Z_Malloc(needed, TAG_GENERAL, qfalse));
+}
+
+/*
+==================
+Demo_OpenArchive
+
+Returns qfalse with the file rewound if f isn't an archive
+==================
+*/
+qboolean Demo_OpenArchive(demoArchive_t* archive, const fileHandle_t f, const int fileLength)
+{
+	demoArchiveHeader_t header;
+
+	Com_Memset(archive, 0, sizeof * archive);
+
+	if (FS_Read(&header, sizeof header, f) != sizeof header || LittleLong(header.ident) != DEMO_ARCHIVE_IDENT)
+	{
+		FS_Seek(f, 0, FS_SEEK_SET);
+		return qfalse;
+	}
+
+	if (LittleLong(header.version) != DEMO_ARCHIVE_VERSION)
+	{
+		Com_Error(ERR_DROP, "Demo archive has version %i, should be %i", LittleLong(header.version),
+			DEMO_ARCHIVE_VERSION);
+	}
+
+	archive->file = f;
+
+	// the index, if the recording was finished.  FS_Seek returns the offset
+	// rather than 0 for a file in a pk3, so check where it ended up instead.
+	demoArchiveFooter_t footer;
+	const int footerOffset = fileLength - static_cast<int>(sizeof footer);
+	qboolean haveFooter = qfalse;
+	if (fileLength >= static_cast<int>(sizeof header + sizeof footer))
+	{
+		FS_Seek(f, footerOffset, FS_SEEK_SET);
+		haveFooter = static_cast<qboolean>(FS_FTell(f) == footerOffset
+			&& FS_Read(&footer, sizeof footer, f) == sizeof footer
+			&& LittleLong(footer.ident) == DEMO_INDEX_IDENT);
+	}
+
+	if (haveFooter)
+	{
+		const int numKeyframes = LittleLong(footer.numKeyframes);
+		const int indexOffset = LittleLong(footer.indexOffset);
+
+		// bound both before the arithmetic, a corrupt footer could overflow it
+		if (numKeyframes > 0 && numKeyframes <= fileLength / static_cast<int>(sizeof(demoKeyframe_t))
+			&& indexOffset >= static_cast<int>(sizeof header) && indexOffset <= footerOffset
+			&& indexOffset + numKeyframes * static_cast<int>(sizeof(demoKeyframe_t)) == footerOffset)
+		{
+			archive->keyframes = static_cast<demoKeyframe_t*>(Z_Malloc(numKeyframes * sizeof(demoKeyframe_t),
+				TAG_GENERAL, qfalse));
+			FS_Seek(f, indexOffset, FS_SEEK_SET);
+			FS_Read(archive->keyframes, numKeyframes * sizeof(demoKeyframe_t), f);
+			for (int i = 0; i < numKeyframes; i++)
+			{
+				archive->keyframes[i].serverTime = LittleLong(archive->keyframes[i].serverTime);
+				archive->keyframes[i].sequence = LittleLong(archive->keyframes[i].sequence);
+				archive->keyframes[i].offset = LittleLong(archive->keyframes[i].offset);
+			}
+			archive->numKeyframes = numKeyframes;
+		}
+	}
+
+	FS_Seek(f, sizeof header, FS_SEEK_SET);
+	return qtrue;
+}
+
+/*
+==================
+Demo_CloseArchive
+
+Frees the buffers, the file stays open
+==================
+*/
+void Demo_CloseArchive(demoArchive_t* archive)
+{
+	if (archive->keyframes)
+	{
+		Z_Free(archive->keyframes);
+	}
+	if (archive->block)
+	{
+		Z_Free(archive->block);
+	}
+	if (archive->compressed)
+	{
+		Z_Free(archive->compressed);
+	}
+	Com_Memset(archive, 0, sizeof * archive);
+}
+
+/*
+==================
+Demo_SeekArchive
+
+Continues from the last keyframe at or before msec into the demo, the next
+read starts with its gamestate.  Returns qfalse if the archive has no index.
+==================
+*/
+qboolean Demo_SeekArchive(demoArchive_t* archive, const int msec)
+{
+	if (!archive->numKeyframes)
+	{
+		return qfalse;
+	}
+
+	const int serverTime = archive->keyframes[0].serverTime + msec;
+
+	// keyframes are in time order
+	int low = 0;
+	int high = archive->numKeyframes - 1;
+	while (low < high)
+	{
+		const int mid = (low + high + 1) / 2;
+		if (archive->keyframes[mid].serverTime <= serverTime)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	FS_Seek(archive->file, archive->keyframes[low].offset, FS_SEEK_SET);
+	archive->blockLength = 0;
+	archive->blockPos = 0;
+	archive->started = qfalse;
+	return qtrue;
+}
+
+/*
+==================
+Demo_ReadArchiveBlock
+
+Inflates the next block of the message stream, skipping the gamestates of
+keyframes playback runs through rather than starts at
+==================
+*/
+static qboolean Demo_ReadArchiveBlock(demoArchive_t* archive)
+{
+	demoArchiveBlock_t block;
+
+	while (FS_Read(&block, sizeof block, archive->file) == sizeof block)
+	{
+		const int type = LittleLong(block.type);
+		const int rawLength = LittleLong(block.rawLength);
+		const int compressedLength = LittleLong(block.compressedLength);
+
+		if (rawLength < 0 || rawLength > DEMO_MAX_BLOCK || compressedLength < 0 || compressedLength > DEMO_MAX_BLOCK)
+		{
+			Com_Printf("Demo archive is corrupt.\n");
+			return qfalse;
+		}
+
+		if ((type == DEMO_BLOCK_GAMESTATE && archive->started) || (type != DEMO_BLOCK_GAMESTATE && type != DEMO_BLOCK_MESSAGES))
+		{
+			FS_Seek(archive->file, compressedLength, FS_SEEK_CUR);
+			continue;
+		}
+
+		Demo_Reserve(&archive->compressed, &archive->compressedSize, compressedLength);
+		Demo_Reserve(&archive->block, &archive->blockSize, rawLength);
+		if (FS_Read(archive->compressed, compressedLength, archive->file) != compressedLength)
+		{
+			return qfalse;
+		}
+
+		uLongf length = rawLength;
+		if (uncompress(archive->block, &length, archive->compressed, compressedLength) != Z_OK
+			|| static_cast<int>(length) != rawLength)
+		{
+			Com_Printf("Demo archive is corrupt.\n");
+			return qfalse;
+		}
+
+		archive->blockLength = rawLength;
+		archive->blockPos = 0;
+		archive->started = qtrue;
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+/*
+==================
+Demo_ReadArchive
+
+Reads the message stream like FS_Read reads a .dm file
+==================
+*/
+int Demo_ReadArchive(demoArchive_t* archive, void* buffer, const int length)
+{
+	auto out = static_cast<byte*>(buffer);
+	int read = 0;
+
+	while (read < length)
+	{
+		if (archive->blockPos == archive->blockLength && !Demo_ReadArchiveBlock(archive))
+		{
+			break;
+		}
+
+		const int chunk = Q_min(length - read, archive->blockLength - archive->blockPos);
+		Com_Memcpy(out + read, archive->block + archive->blockPos, chunk);
+		archive->blockPos += chunk;
+		read += chunk;
+	}
+
+	return read;
+}
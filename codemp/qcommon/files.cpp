@@ -39,6 +39,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #endif
 #include <minizip/unzip.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #if defined(_WIN32)
 #include <windows.h>
 #endif
@@ -211,6 +215,9 @@ typedef struct pack_s {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t** hashTable;					// hash table
 	fileInPack_t* buildBuffer;				// buffer with the filenames etc.
+	const byte* mapped;						// the whole pk3 when fs_mmap is on, else NULL
+	size_t			mappedLen;
+	size_t			mappedBias;					// bytes in front of the zip data
 } pack_t;
 
 typedef struct directory_s {
@@ -240,6 +247,7 @@ static cvar_t* fs_basegame;
 static cvar_t* fs_cdpath;
 static cvar_t* fs_copyfiles;
 static cvar_t* fs_gamedirvar;
+static cvar_t* fs_mmap;
 static cvar_t* fs_dirbeforepak; //rww - when building search path, keep directories at top and insert pk3's under them
 static searchpath_t* fs_searchpaths;
 static int			fs_readCount;			// total bytes read
@@ -267,6 +275,13 @@ typedef struct fileHandleData_s {
 	int			zipFileLen;
 	qboolean	zipFile;
 	char		name[MAX_ZPATH];
+
+	// pk3 entry served from its pak's mapping instead of minizip
+	const byte* mapData;		// the entry's compressed data, NULL if not mapped
+	int			mapPos;			// uncompressed bytes read so far
+	qboolean	mapInflate;		// deflated, else stored
+	z_stream	mapStream;
+	byte* mapOwned;		// preloaded copy mapData points into, freed on close
 } fileHandleData_t;
 
 static fileHandleData_t	fsh[MAX_FILE_HANDLES];
@@ -301,6 +316,8 @@ char lastValidGame[MAX_OSPATH];
 FILE* missingFiles = NULL;
 #endif
 
+static void FS_ForgetMisses(void);
+
 /* C99 defines __func__ */
 #if __STDC_VERSION__ < 199901L
 #  if __GNUC__ >= 2 || _MSC_VER >= 1300
@@ -757,6 +774,7 @@ FS_SV_FOpenFileWrite
 */
 fileHandle_t FS_SV_FOpenFileWrite(const char* filename) {
 	FS_AssertInitialised();
+	FS_ForgetMisses();
 
 	char* ospath = FS_BuildOSPath(fs_homepath->string, filename, "");
 	ospath[strlen(ospath) - 1] = '\0';
@@ -874,6 +892,7 @@ FS_SV_Rename
 */
 void FS_SV_Rename(const char* from, const char* to, qboolean safe) {
 	FS_AssertInitialised();
+	FS_ForgetMisses();
 
 	// don't let sound stutter
 	S_ClearSoundBuffer();
@@ -906,6 +925,7 @@ FS_Rename
 */
 void FS_Rename(const char* from, const char* to) {
 	FS_AssertInitialised();
+	FS_ForgetMisses();
 
 	// don't let sound stutter
 	S_ClearSoundBuffer();
@@ -948,6 +968,16 @@ There are three cases handled:
 void FS_FCloseFile(fileHandle_t f) {
 	FS_AssertInitialised();
 
+	if (fsh[f].mapData) {
+		// the pak's minizip handle was never touched
+		if (fsh[f].mapInflate) {
+			inflateEnd(&fsh[f].mapStream);
+		}
+		Z_Free(fsh[f].mapOwned);
+		Com_Memset(&fsh[f], 0, sizeof fsh[f]);
+		return;
+	}
+
 	if (fsh[f].zipFile == qtrue) {
 		unzCloseCurrentFile(fsh[f].handleFiles.file.z);
 		if (fsh[f].handleFiles.unique) {
@@ -972,6 +1002,7 @@ FS_FOpenFileWrite
 */
 fileHandle_t FS_FOpenFileWrite(const char* filename, qboolean safe) {
 	FS_AssertInitialised();
+	FS_ForgetMisses();
 
 	fileHandle_t f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
@@ -1012,6 +1043,7 @@ FS_FOpenFileAppend
 */
 static fileHandle_t FS_FOpenFileAppend(const char* filename) {
 	FS_AssertInitialised();
+	FS_ForgetMisses();
 
 	fileHandle_t f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
@@ -1106,6 +1138,7 @@ Return qtrue if filename has a demo extension
 */
 
 #define DEMO_EXTENSION "dm_"
+#define DEMO_ARCHIVE_EXTENSION "dmz_"
 static qboolean FS_IsDemoExt(const char* filename, int namelen)
 {
 	const char* ext_test = strrchr(filename, '.');
@@ -1116,10 +1149,34 @@ static qboolean FS_IsDemoExt(const char* filename, int namelen)
 		if (protocol == PROTOCOL_VERSION)
 			return qtrue;
 	}
+	else if (ext_test && !Q_stricmpn(ext_test + 1, DEMO_ARCHIVE_EXTENSION, ARRAY_LEN(DEMO_ARCHIVE_EXTENSION) - 1))
+	{
+		const int protocol = atoi(ext_test + ARRAY_LEN(DEMO_ARCHIVE_EXTENSION));
+
+		if (protocol == PROTOCOL_VERSION)
+			return qtrue;
+	}
 
 	return qfalse;
 }
 
+/*
+===========
+FS_IsDirectoryExt
+
+Return qtrue if a pure server still takes filename from the loose directories
+===========
+*/
+static qboolean FS_IsDirectoryExt(const char* filename, const int namelen)
+{
+	return static_cast<qboolean>(FS_IsExt(filename, ".cfg", namelen) ||	// for config files
+		FS_IsExt(filename, ".fcf", namelen) ||		// force configuration files
+		FS_IsExt(filename, ".menu", namelen) ||		// menu files
+		FS_IsExt(filename, ".game", namelen) ||		// menu files
+		FS_IsExt(filename, ".dat", namelen) ||		// for journal files
+		FS_IsDemoExt(filename, namelen));			// demos
+}
+
 #ifdef _WIN32
 
 static bool Sys_GetFileTime(LPCSTR psFileName, FILETIME& ft)
@@ -1186,6 +1243,777 @@ static bool Sys_FileOutOfDate(LPCSTR psFinalFileName /* dest */, LPCSTR psDataFi
 
 #endif // _WIN32
 
+/*
+=============================================================================
+
+MAPPED PK3 FILES
+
+With fs_mmap on, every pk3 is mapped read only when it is added to the search
+path.  Files opened from it are read straight out of the mapping: stored ones
+are copied to the caller's buffer, deflated ones are inflated into it, and the
+shared minizip handle and its FILE* are left alone.  Entries minizip has to
+handle (encrypted, other methods, broken headers) still go through it.
+Mapping is off by default on 32 bit builds, where the paks would take address
+space the hunk is allocated from later.
+
+=============================================================================
+*/
+
+#define ZIP_CENTRAL_SIG		0x02014b50
+#define ZIP_LOCAL_SIG		0x04034b50
+#define ZIP_END_SIG			0x06054b50
+
+static unsigned FS_ZipShort(const byte* p) {
+	return p[0] | p[1] << 8;
+}
+
+static unsigned FS_ZipLong(const byte* p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | static_cast<unsigned>(p[3]) << 24;
+}
+
+/*
+================
+FS_MapPak
+
+Leaves pack->mapped NULL if the file can't be mapped or has no usable
+end of central directory record
+================
+*/
+static void FS_MapPak(pack_t* pack) {
+	size_t len;
+	const auto data = static_cast<const byte*>(Sys_MapFile(pack->pakFilename, &len));
+
+	if (!data) {
+		return;
+	}
+
+	// the record is the last thing in the file but for up to 64k of comment
+	if (len >= 22) {
+		const size_t last = len - 22;
+		const size_t first = last > 0xffff ? last - 0xffff : 0;
+
+		for (size_t end = last + 1; end-- > first; ) {
+			if (FS_ZipLong(data + end) != ZIP_END_SIG) {
+				continue;
+			}
+
+			const size_t centralEnd = static_cast<size_t>(FS_ZipLong(data + end + 16)) + FS_ZipLong(data + end + 12);
+			if (centralEnd <= end) {
+				pack->mapped = data;
+				pack->mappedLen = len;
+				pack->mappedBias = end - centralEnd;
+				return;
+			}
+			break;
+		}
+	}
+
+	Sys_UnmapFile(const_cast<byte*>(data), len);
+}
+
+/*
+================
+FS_LocateMappedEntry
+
+Finds the data of pakFile inside its pak's mapping
+================
+*/
+static qboolean FS_LocateMappedEntry(const pack_t* pak, const fileInPack_t* pakFile, const byte** data, size_t* compressedLen, qboolean* deflated) {
+	if (!pak->mapped) {
+		return qfalse;
+	}
+
+	// the central directory entry minizip found it by
+	const size_t central = pak->mappedBias + pakFile->pos;
+	if (central + 46 > pak->mappedLen || FS_ZipLong(pak->mapped + central) != ZIP_CENTRAL_SIG) {
+		return qfalse;
+	}
+
+	const unsigned flags = FS_ZipShort(pak->mapped + central + 8);
+	const unsigned method = FS_ZipShort(pak->mapped + central + 10);
+	const size_t csize = FS_ZipLong(pak->mapped + central + 20);
+	if (flags & 1 || (method != 0 && method != Z_DEFLATED)) {
+		return qfalse;		// encrypted, or something only minizip knows
+	}
+	if (method == 0 && csize != pakFile->len) {
+		return qfalse;
+	}
+
+	const size_t local = pak->mappedBias + FS_ZipLong(pak->mapped + central + 42);
+	if (local + 30 > pak->mappedLen || FS_ZipLong(pak->mapped + local) != ZIP_LOCAL_SIG) {
+		return qfalse;
+	}
+
+	const size_t start = local + 30 + FS_ZipShort(pak->mapped + local + 26) + FS_ZipShort(pak->mapped + local + 28);
+	if (start > pak->mappedLen || csize > pak->mappedLen - start) {
+		return qfalse;
+	}
+
+	*data = pak->mapped + start;
+	*compressedLen = csize;
+	*deflated = static_cast<qboolean>(method == Z_DEFLATED);
+	return qtrue;
+}
+
+/*
+================
+FS_OpenMappedEntry
+
+Points handle f at the data of pakFile inside its pak's mapping
+================
+*/
+static qboolean FS_OpenMappedEntry(const fileHandle_t f, const pack_t* pak, const fileInPack_t* pakFile) {
+	const byte* data;
+	size_t compressedLen;
+	qboolean deflated;
+
+	if (!FS_LocateMappedEntry(pak, pakFile, &data, &compressedLen, &deflated)) {
+		return qfalse;
+	}
+
+	fsh[f].mapData = data;
+	fsh[f].mapPos = 0;
+	fsh[f].mapInflate = deflated;
+	if (deflated) {
+		Com_Memset(&fsh[f].mapStream, 0, sizeof fsh[f].mapStream);
+		fsh[f].mapStream.next_in = const_cast<Bytef*>(data);
+		fsh[f].mapStream.avail_in = static_cast<uInt>(compressedLen);
+		if (inflateInit2(&fsh[f].mapStream, -MAX_WBITS) != Z_OK) {
+			fsh[f].mapData = nullptr;
+			fsh[f].mapInflate = qfalse;
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
+
+/*
+================
+FS_RewindMapped
+
+Back to the start of a deflated entry
+================
+*/
+static void FS_RewindMapped(const fileHandle_t f) {
+	z_stream* stream = &fsh[f].mapStream;
+	const uInt compressedLen = static_cast<uInt>(stream->next_in - fsh[f].mapData) + stream->avail_in;
+
+	inflateReset(stream);
+	stream->next_in = const_cast<Bytef*>(fsh[f].mapData);
+	stream->avail_in = compressedLen;
+	fsh[f].mapPos = 0;
+}
+
+/*
+================
+FS_ReadMapped
+================
+*/
+static int FS_ReadMapped(byte* buffer, int len, const fileHandle_t f) {
+	if (len > fsh[f].zipFileLen - fsh[f].mapPos) {
+		len = fsh[f].zipFileLen - fsh[f].mapPos;
+	}
+	if (len <= 0) {
+		return 0;
+	}
+
+	if (!fsh[f].mapInflate) {
+		Com_Memcpy(buffer, fsh[f].mapData + fsh[f].mapPos, len);
+		fsh[f].mapPos += len;
+		return len;
+	}
+
+	z_stream* stream = &fsh[f].mapStream;
+	stream->next_out = buffer;
+	stream->avail_out = len;
+
+	const int err = inflate(stream, Z_SYNC_FLUSH);
+	const int read = len - static_cast<int>(stream->avail_out);
+	if (err != Z_OK && err != Z_STREAM_END) {
+		Com_Printf(S_COLOR_YELLOW "WARNING: corrupt data in %s\n", fsh[f].name);
+	}
+
+	fsh[f].mapPos += read;
+	return read;
+}
+
+/*
+=============================================================================
+
+FILE INDEX
+
+One hash over the files of every pak in the search path, rebuilt whenever the
+search path changes.  Each name lists the paks holding it in search order, so
+a lookup only visits those and the loose directories instead of probing every
+pak.  Names that weren't found anywhere are remembered until something could
+have created them, but only when no loose directory would be searched for
+them: a file can appear in a directory behind the engine's back.
+
+=============================================================================
+*/
+
+#define FS_MISS_HASH_SIZE	4096
+#define FS_MAX_MISSES		16384
+
+typedef struct fsIndexHit_s {
+	const searchpath_t* search;
+	const fileInPack_t* pakFile;
+	int					order;			// position of search in fs_searchpaths
+	fsIndexHit_s* next;			// the same name in a later pak
+} fsIndexHit_t;
+
+typedef struct fsIndexName_s {
+	unsigned			hash;
+	const char* name;			// as the first pak spells it
+	fsIndexHit_t* hits;
+	fsIndexHit_t* lastHit;
+	fsIndexName_s* next;			// next name in the bucket
+} fsIndexName_t;
+
+typedef struct fsIndexDir_s {
+	const searchpath_t* search;
+	int					order;
+} fsIndexDir_t;
+
+typedef struct fsMiss_s {
+	unsigned			hash;
+	fsMiss_s* next;
+	char				name[1];		// variable sized
+} fsMiss_t;
+
+typedef struct fsIndex_s {
+	qboolean			valid;
+	int					hashSize;		// power of 2
+	fsIndexName_t** hashTable;
+	fsIndexName_t* names;
+	int					numNames;
+	fsIndexHit_t* hits;
+	int					numHits;
+	fsIndexDir_t* dirs;
+	int					numDirs;
+	int					numPaks;
+	int					numMappedPaks;
+
+	fsMiss_t* misses[FS_MISS_HASH_SIZE];
+	int					numMisses;
+
+	int					numBuilds;
+	int					buildMsec;
+
+	// since the last build
+	int					lookups;
+	int					pakHits;
+	int					dirHits;
+	int					notFound;
+	int					missCacheHits;
+} fsIndex_t;
+
+static fsIndex_t fs_index;
+
+/*
+================
+FS_IndexHash
+
+Ignores case and separator char distinctions like FS_FilenameCompare
+================
+*/
+static unsigned FS_IndexHash(const char* fname) {
+	unsigned hash = 2166136261u;
+
+	for (; *fname; fname++) {
+		int c = *fname;
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		if (c == '\\' || c == ':') {
+			c = '/';
+		}
+		hash = (hash ^ static_cast<unsigned>(c)) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+================
+FS_ForgetMisses
+
+Something may have created a file, so names that were missing have to be
+looked for again
+================
+*/
+static void FS_ForgetMisses(void) {
+	if (!fs_index.numMisses) {
+		return;
+	}
+
+	for (auto& bucket : fs_index.misses) {
+		while (bucket) {
+			fsMiss_t* next = bucket->next;
+			Z_Free(bucket);
+			bucket = next;
+		}
+	}
+	fs_index.numMisses = 0;
+}
+
+static qboolean FS_IsKnownMiss(const char* filename, const unsigned hash) {
+	for (const fsMiss_t* miss = fs_index.misses[hash & (FS_MISS_HASH_SIZE - 1)]; miss; miss = miss->next) {
+		if (miss->hash == hash && !FS_FilenameCompare(miss->name, filename)) {
+			return qtrue;
+		}
+	}
+	return qfalse;
+}
+
+static void FS_AddMiss(const char* filename, const unsigned hash) {
+	if (fs_index.numMisses >= FS_MAX_MISSES) {
+		FS_ForgetMisses();
+	}
+
+	const size_t len = strlen(filename);
+	const auto miss = static_cast<fsMiss_t*>(Z_Malloc(sizeof(fsMiss_t) + len, TAG_FILESYS, qfalse));
+	miss->hash = hash;
+	memcpy(miss->name, filename, len + 1);
+	miss->next = fs_index.misses[hash & (FS_MISS_HASH_SIZE - 1)];
+	fs_index.misses[hash & (FS_MISS_HASH_SIZE - 1)] = miss;
+	fs_index.numMisses++;
+}
+
+/*
+================
+FS_FreeIndex
+================
+*/
+static void FS_FreeIndex(void) {
+	FS_ForgetMisses();
+
+	Z_Free(fs_index.hashTable);
+	Z_Free(fs_index.names);
+	Z_Free(fs_index.hits);
+	Z_Free(fs_index.dirs);
+	fs_index.hashTable = nullptr;
+	fs_index.names = nullptr;
+	fs_index.hits = nullptr;
+	fs_index.dirs = nullptr;
+	fs_index.valid = qfalse;
+}
+
+/*
+================
+FS_InvalidateIndex
+
+The search path changed, the index is rebuilt on the next lookup
+================
+*/
+static void FS_InvalidateIndex(void) {
+	fs_index.valid = qfalse;
+	FS_ForgetMisses();
+}
+
+/*
+================
+FS_BuildIndex
+================
+*/
+static void FS_BuildIndex(void) {
+	const int start = Sys_Milliseconds();
+	int numFiles = 0;
+	int numDirs = 0;
+
+	FS_FreeIndex();
+
+	for (const searchpath_t* search = fs_searchpaths; search; search = search->next) {
+		if (search->pack) {
+			numFiles += search->pack->numfiles;
+		}
+		else if (search->dir) {
+			numDirs++;
+		}
+	}
+
+	fs_index.hashSize = 1024;
+	while (fs_index.hashSize < numFiles && fs_index.hashSize < 1 << 20) {
+		fs_index.hashSize <<= 1;
+	}
+	fs_index.hashTable = static_cast<fsIndexName_t**>(Z_Malloc(fs_index.hashSize * sizeof(fsIndexName_t*), TAG_FILESYS, qtrue));
+	fs_index.names = static_cast<fsIndexName_t*>(Z_Malloc(numFiles * sizeof(fsIndexName_t), TAG_FILESYS, qfalse));
+	fs_index.hits = static_cast<fsIndexHit_t*>(Z_Malloc(numFiles * sizeof(fsIndexHit_t), TAG_FILESYS, qfalse));
+	fs_index.dirs = static_cast<fsIndexDir_t*>(Z_Malloc(numDirs * sizeof(fsIndexDir_t), TAG_FILESYS, qfalse));
+	fs_index.numNames = 0;
+	fs_index.numHits = 0;
+	fs_index.numDirs = 0;
+	fs_index.numPaks = 0;
+	fs_index.numMappedPaks = 0;
+
+	int order = 0;
+	for (const searchpath_t* search = fs_searchpaths; search; search = search->next, order++) {
+		if (search->dir) {
+			fs_index.dirs[fs_index.numDirs].search = search;
+			fs_index.dirs[fs_index.numDirs].order = order;
+			fs_index.numDirs++;
+			continue;
+		}
+		if (!search->pack) {
+			continue;
+		}
+
+		fs_index.numPaks++;
+		if (search->pack->mapped) {
+			fs_index.numMappedPaks++;
+		}
+		for (int i = 0; i < search->pack->numfiles; i++) {
+			const fileInPack_t* pakFile = &search->pack->buildBuffer[i];
+			if (!pakFile->name) {
+				continue;		// the zip directory ended early
+			}
+
+			const unsigned hash = FS_IndexHash(pakFile->name);
+			fsIndexName_t** bucket = &fs_index.hashTable[hash & (fs_index.hashSize - 1)];
+			fsIndexName_t* name = *bucket;
+			while (name && (name->hash != hash || FS_FilenameCompare(name->name, pakFile->name))) {
+				name = name->next;
+			}
+
+			if (!name) {
+				name = &fs_index.names[fs_index.numNames++];
+				name->hash = hash;
+				name->name = pakFile->name;
+				name->hits = nullptr;
+				name->lastHit = nullptr;
+				name->next = *bucket;
+				*bucket = name;
+			}
+			else if (name->lastHit->search == search) {
+				// the pak has it twice, its own hash finds the later one
+				name->lastHit->pakFile = pakFile;
+				continue;
+			}
+
+			fsIndexHit_t* hit = &fs_index.hits[fs_index.numHits++];
+			hit->search = search;
+			hit->pakFile = pakFile;
+			hit->order = order;
+			hit->next = nullptr;
+			if (name->lastHit) {
+				name->lastHit->next = hit;
+			}
+			else {
+				name->hits = hit;
+			}
+			name->lastHit = hit;
+		}
+	}
+
+	fs_index.valid = qtrue;
+	fs_index.numBuilds++;
+	fs_index.buildMsec = Sys_Milliseconds() - start;
+	fs_index.lookups = 0;
+	fs_index.pakHits = 0;
+	fs_index.dirHits = 0;
+	fs_index.notFound = 0;
+	fs_index.missCacheHits = 0;
+}
+
+/*
+================
+FS_IndexLookup
+
+The paks holding filename in search order, NULL if none do
+================
+*/
+static const fsIndexHit_t* FS_IndexLookup(const char* filename, const unsigned hash) {
+	if (!fs_index.valid) {
+		FS_BuildIndex();
+	}
+
+	for (const fsIndexName_t* name = fs_index.hashTable[hash & (fs_index.hashSize - 1)]; name; name = name->next) {
+		if (name->hash == hash && !FS_FilenameCompare(name->name, filename)) {
+			return name->hits;
+		}
+	}
+	return nullptr;
+}
+
+/*
+================
+FS_Stats_f
+================
+*/
+static void FS_Stats_f(void) {
+	if (!fs_index.valid) {
+		FS_BuildIndex();
+	}
+
+	const int found = fs_index.pakHits + fs_index.dirHits;
+
+	Com_Printf("index: %i names, %i entries from %i paks (%i mapped), %i directories\n",
+		fs_index.numNames, fs_index.numHits, fs_index.numPaks, fs_index.numMappedPaks, fs_index.numDirs);
+	Com_Printf("built %i times, last build took %i msec\n", fs_index.numBuilds, fs_index.buildMsec);
+	Com_Printf("%i lookups since: %i in paks, %i in directories, %i not found, %i answered by the miss cache\n",
+		fs_index.lookups, fs_index.pakHits, fs_index.dirHits, fs_index.notFound, fs_index.missCacheHits);
+	if (fs_index.lookups) {
+		Com_Printf("%.1f%% found, %.1f%% of misses served from the cache (%i names held)\n",
+			100.0f * found / fs_index.lookups,
+			fs_index.notFound + fs_index.missCacheHits ? 100.0f * fs_index.missCacheHits / (fs_index.notFound + fs_index.missCacheHits) : 0.0f,
+			fs_index.numMisses);
+	}
+}
+
+/*
+=============================================================================
+
+PRELOADING
+
+While a map loads, the files it is going to ask for are decoded out of their
+mapped paks on the job threads.  Buffers are allocated up front on the main
+thread, so the workers only touch the mapping, their own buffer and zlib.
+Opening a preloaded file hands its buffer to the handle instead of inflating
+the data again; whether it is the right file is decided by the normal search,
+a preload only matches the exact pak entry it was decoded from.
+
+=============================================================================
+*/
+
+#define MAX_PRELOAD_FILES	1024
+#define MAX_PRELOAD_BYTES	(256 * 1024 * 1024)
+
+enum {
+	PRELOAD_QUEUED,
+	PRELOAD_BUSY,
+	PRELOAD_DONE,
+	PRELOAD_FAILED
+};
+
+typedef struct fsPreloadFile_s {
+	const byte* data;			// compressed data in the mapping
+	size_t				compressedLen;
+	qboolean			deflated;
+	int					len;
+	byte* buffer;			// len + 1 bytes, NULL once handed over
+	std::atomic<int>	state;
+} fsPreloadFile_t;
+
+typedef struct fsPreload_s {
+	fsPreloadFile_t		files[MAX_PRELOAD_FILES];
+	int					numFiles;
+	int					numStarted;		// files handed to Com_StartJobs so far
+	int					batchStart;		// first file of the running batch
+	size_t				bytes;
+
+	int					startTime;
+	std::atomic<int>	decodeUsec;		// summed over all threads
+	int					used;
+	int					waited;			// asked for while a worker had it
+	int					decodedHere;	// asked for before a worker got to it
+
+	qboolean			lengthOnly;		// FS_ReadFile without a buffer, leave the preload alone
+} fsPreload_t;
+
+static fsPreload_t fs_preload;
+
+/*
+================
+FS_DecodePreload
+================
+*/
+static void FS_DecodePreload(fsPreloadFile_t* file) {
+	const auto start = std::chrono::steady_clock::now();
+	qboolean ok = qtrue;
+
+	if (!file->deflated) {
+		Com_Memcpy(file->buffer, file->data, file->len);
+	}
+	else {
+		z_stream stream;
+		Com_Memset(&stream, 0, sizeof stream);
+		stream.next_in = const_cast<Bytef*>(file->data);
+		stream.avail_in = static_cast<uInt>(file->compressedLen);
+		stream.next_out = file->buffer;
+		stream.avail_out = file->len;
+
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+			ok = qfalse;
+		}
+		else {
+			ok = static_cast<qboolean>(inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0);
+			inflateEnd(&stream);
+		}
+	}
+	file->buffer[file->len] = 0;
+
+	fs_preload.decodeUsec += static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count());
+	file->state = ok ? PRELOAD_DONE : PRELOAD_FAILED;
+}
+
+static void FS_PreloadJob(const int index, void* data) {
+	fsPreloadFile_t* file = &fs_preload.files[*static_cast<int*>(data) + index];
+	int expected = PRELOAD_QUEUED;
+
+	if (file->state.compare_exchange_strong(expected, PRELOAD_BUSY)) {
+		FS_DecodePreload(file);
+	}
+}
+
+/*
+================
+FS_PreloadFile
+
+Queues qpath for the next FS_StartPreload.  Only files the index finds in a
+mapped pak are worth it, everything else is left to the normal path.
+================
+*/
+void FS_PreloadFile(const char* qpath) {
+	const byte* data;
+	size_t compressedLen;
+	qboolean deflated;
+
+	if (!fs_searchpaths || !qpath || !qpath[0] || Com_NumJobWorkers() < 2) {
+		return;
+	}
+	if (fs_preload.numFiles == MAX_PRELOAD_FILES) {
+		return;
+	}
+
+	// qpaths are not supposed to have a leading slash
+	if (qpath[0] == '/' || qpath[0] == '\\') {
+		qpath++;
+	}
+
+	const fsIndexHit_t* hit = FS_IndexLookup(qpath, FS_IndexHash(qpath));
+	while (hit && !FS_PakIsPure(hit->search->pack)) {
+		hit = hit->next;
+	}
+	if (!hit || !hit->pakFile->len || fs_preload.bytes + hit->pakFile->len > MAX_PRELOAD_BYTES) {
+		return;
+	}
+	if (!FS_LocateMappedEntry(hit->search->pack, hit->pakFile, &data, &compressedLen, &deflated)) {
+		return;
+	}
+
+	for (int i = 0; i < fs_preload.numFiles; i++) {
+		if (fs_preload.files[i].data == data) {
+			return;
+		}
+	}
+
+	fsPreloadFile_t* file = &fs_preload.files[fs_preload.numFiles++];
+	file->data = data;
+	file->compressedLen = compressedLen;
+	file->deflated = deflated;
+	file->len = static_cast<int>(hit->pakFile->len);
+	file->buffer = static_cast<byte*>(Z_Malloc(file->len + 1, TAG_FILESYS, qfalse));
+	file->state = PRELOAD_QUEUED;
+	fs_preload.bytes += file->len;
+}
+
+/*
+================
+FS_StartPreload
+
+Hands the files queued since the last call to the job threads
+================
+*/
+void FS_StartPreload(void) {
+	if (fs_preload.numStarted == fs_preload.numFiles) {
+		return;
+	}
+	if (!fs_preload.numStarted) {
+		fs_preload.startTime = Sys_Milliseconds();
+	}
+
+	// the running batch reads batchStart, let it finish first
+	Com_FinishJobs();
+	fs_preload.batchStart = fs_preload.numStarted;
+	fs_preload.numStarted = fs_preload.numFiles;
+	Com_StartJobs(fs_preload.numFiles - fs_preload.batchStart, FS_PreloadJob, &fs_preload.batchStart);
+}
+
+/*
+================
+FS_FinishPreload
+
+Waits for the workers and frees whatever nobody asked for
+================
+*/
+void FS_FinishPreload(const qboolean report) {
+	if (!fs_preload.numFiles) {
+		return;
+	}
+
+	Com_FinishJobs();
+
+	int unused = 0;
+	for (int i = 0; i < fs_preload.numFiles; i++) {
+		fsPreloadFile_t* file = &fs_preload.files[i];
+		if (file->buffer) {
+			Z_Free(file->buffer);
+			file->buffer = nullptr;
+			unused++;
+		}
+	}
+
+	if (report) {
+		Com_Printf("Preloaded %i files (%i KB) in %i msec of decoding: %i used, %i unused, %i waited on, %i decoded by the loader, %i msec total\n",
+			fs_preload.numFiles, static_cast<int>(fs_preload.bytes / 1024), fs_preload.decodeUsec / 1000,
+			fs_preload.used, unused, fs_preload.waited, fs_preload.decodedHere,
+			Sys_Milliseconds() - fs_preload.startTime);
+	}
+
+	fs_preload.numFiles = 0;
+	fs_preload.numStarted = 0;
+	fs_preload.bytes = 0;
+	fs_preload.decodeUsec = 0;
+	fs_preload.used = 0;
+	fs_preload.waited = 0;
+	fs_preload.decodedHere = 0;
+}
+
+/*
+================
+FS_TakePreload
+
+Hands handle f the preloaded copy of its mapped data, if there is one
+================
+*/
+static void FS_TakePreload(const fileHandle_t f) {
+	for (int i = 0; i < fs_preload.numFiles; i++) {
+		fsPreloadFile_t* file = &fs_preload.files[i];
+		if (file->data != fsh[f].mapData) {
+			continue;
+		}
+		if (!file->buffer) {
+			return;		// already handed out
+		}
+
+		int expected = PRELOAD_QUEUED;
+		if (file->state.compare_exchange_strong(expected, PRELOAD_BUSY)) {
+			fs_preload.decodedHere++;
+			FS_DecodePreload(file);
+		}
+		else if (expected == PRELOAD_BUSY) {
+			fs_preload.waited++;
+			while (file->state == PRELOAD_BUSY) {
+				std::this_thread::yield();
+			}
+		}
+
+		if (file->state != PRELOAD_DONE) {
+			return;
+		}
+
+		if (fsh[f].mapInflate) {
+			inflateEnd(&fsh[f].mapStream);
+			fsh[f].mapInflate = qfalse;
+		}
+		fsh[f].mapData = file->buffer;
+		fsh[f].mapOwned = file->buffer;
+		file->buffer = nullptr;
+		fs_preload.used++;
+		return;
+	}
+}
+
 static bool FS_FileCacheable(const char* const filename)
 {
 	extern	cvar_t* com_buildScript;
@@ -1213,8 +2041,6 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 	//void			*temp;
 	int				l;
 
-	long hash = 0;
-
 	FS_AssertInitialised();
 
 	if (file == nullptr) {
@@ -1247,6 +2073,16 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 
 	const bool isUserConfig = !Q_stricmp(filename, "autoexec_mp.cfg") || !Q_stricmp(filename, Q3CONFIG_CFG);
 
+	const unsigned indexHash = FS_IndexHash(filename);
+	fs_index.lookups++;
+
+	if (FS_IsKnownMiss(filename, indexHash)) {
+		fs_index.missCacheHits++;
+		Com_DPrintf("Can't find %s\n", filename);
+		*file = 0;
+		return -1;
+	}
+
 	//
 	// search through the path, one element at a time
 	//
@@ -1265,13 +2101,26 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 	{
 		b_faster_to_re_open_using_new_local_file = qfalse;
 
-		for (const searchpath_t* search = fs_searchpaths; search; search = search->next) {
-			//
-			if (search->pack) {
-				hash = FS_HashFileName(filename, search->pack->hashSize);
+		// only the paks the index says hold the file and the directories,
+		//	in search path order
+		const fsIndexHit_t* hit = FS_IndexLookup(filename, indexHash);
+		int dirNum = 0;
+
+		while (hit || dirNum < fs_index.numDirs) {
+			const searchpath_t* search;
+			const fileInPack_t* pakFile = nullptr;
+
+			if (hit && (dirNum == fs_index.numDirs || hit->order < fs_index.dirs[dirNum].order)) {
+				search = hit->search;
+				pakFile = hit->pakFile;
+				hit = hit->next;
 			}
+			else {
+				search = fs_index.dirs[dirNum++].search;
+			}
+
 			// is the element a pak file?
-			if (search->pack && search->pack->hashTable[hash]) {
+			if (pakFile) {
 				// disregard if it doesn't match one of the allowed pure pak files
 				if (!FS_PakIsPure(search->pack)) {
 					continue;
@@ -1283,110 +2132,112 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 					continue;
 				}
 
-				// look through all the pak file elements
+				// found it!
 				pack_t* pak = search->pack;
-				fileInPack_t* pakFile = pak->hashTable[hash];
-				do {
-					// case and separator insensitive comparisons
-					if (!FS_FilenameCompare(pakFile->name, filename)) {
-						// found it!
 
-						// mark the pak as having been referenced and mark specifics on cgame and ui
-						// shaders, txt, arena files  by themselves do not count as a reference as
-						// these are loaded from all pk3s
-						// from every pk3 file..
-
-						// The x86.dll suffixes are needed in order for sv_pure to continue to
-						// work on non-x86/windows systems...
-
-						l = strlen(filename);
-						if (!(pak->referenced & FS_GENERAL_REF)) {
-							if (!FS_IsExt(filename, ".shader", l) &&
-								!FS_IsExt(filename, ".txt", l) &&
-								!FS_IsExt(filename, ".str", l) &&
-								!FS_IsExt(filename, ".cfg", l) &&
-								!FS_IsExt(filename, ".config", l) &&
-								!FS_IsExt(filename, ".bot", l) &&
-								!FS_IsExt(filename, ".arena", l) &&
-								!FS_IsExt(filename, ".menu", l) &&
-								!FS_IsExt(filename, ".fcf", l) &&
-								Q_stricmp(filename, "MovieDuels-mpgamex86.dll") != 0 &&
-								!strstr(filename, "levelshots"))
-							{
-								pak->referenced |= FS_GENERAL_REF;
-							}
-						}
+				// mark the pak as having been referenced and mark specifics on cgame and ui
+				// shaders, txt, arena files  by themselves do not count as a reference as
+				// these are loaded from all pk3s
+				// from every pk3 file..
 
-						if (!(pak->referenced & FS_CGAME_REF))
-						{
-							if (Q_stricmp(filename, "cgame.qvm") == 0 ||
-								Q_stricmp(filename, "cgamex86.dll") == 0)
-							{
-								pak->referenced |= FS_CGAME_REF;
-							}
-						}
+				// The x86.dll suffixes are needed in order for sv_pure to continue to
+				// work on non-x86/windows systems...
 
-						if (!(pak->referenced & FS_UI_REF))
-						{
-							if (Q_stricmp(filename, "ui.qvm") == 0 ||
-								Q_stricmp(filename, "uix86.dll") == 0)
-							{
-								pak->referenced |= FS_UI_REF;
-							}
-						}
+				l = strlen(filename);
+				if (!(pak->referenced & FS_GENERAL_REF)) {
+					if (!FS_IsExt(filename, ".shader", l) &&
+						!FS_IsExt(filename, ".txt", l) &&
+						!FS_IsExt(filename, ".str", l) &&
+						!FS_IsExt(filename, ".cfg", l) &&
+						!FS_IsExt(filename, ".config", l) &&
+						!FS_IsExt(filename, ".bot", l) &&
+						!FS_IsExt(filename, ".arena", l) &&
+						!FS_IsExt(filename, ".menu", l) &&
+						!FS_IsExt(filename, ".fcf", l) &&
+						Q_stricmp(filename, "MovieDuels-mpgamex86.dll") != 0 &&
+						!strstr(filename, "levelshots"))
+					{
+						pak->referenced |= FS_GENERAL_REF;
+					}
+				}
 
-						if (uniqueFILE) {
-							// open a new file on the pakfile
-							fsh[*file].handleFiles.file.z = unzOpen(pak->pakFilename);
-							if (fsh[*file].handleFiles.file.z == nullptr) {
-								Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
-							}
-						}
-						else {
-							fsh[*file].handleFiles.file.z = pak->handle;
-						}
-						Q_strncpyz(fsh[*file].name, filename, sizeof fsh[*file].name);
-						fsh[*file].zipFile = qtrue;
+				if (!(pak->referenced & FS_CGAME_REF))
+				{
+					if (Q_stricmp(filename, "cgame.qvm") == 0 ||
+						Q_stricmp(filename, "cgamex86.dll") == 0)
+					{
+						pak->referenced |= FS_CGAME_REF;
+					}
+				}
+
+				if (!(pak->referenced & FS_UI_REF))
+				{
+					if (Q_stricmp(filename, "ui.qvm") == 0 ||
+						Q_stricmp(filename, "uix86.dll") == 0)
+					{
+						pak->referenced |= FS_UI_REF;
+					}
+				}
+
+				if (FS_OpenMappedEntry(*file, pak, pakFile)) {
+					// every mapped handle has its own cursor, unique or not
+					fsh[*file].handleFiles.file.z = pak->handle;
+					if (fs_preload.numFiles && !fs_preload.lengthOnly) {
+						FS_TakePreload(*file);
+					}
+				}
+				else if (uniqueFILE) {
+					// open a new file on the pakfile
+					fsh[*file].handleFiles.file.z = unzOpen(pak->pakFilename);
+					if (fsh[*file].handleFiles.file.z == nullptr) {
+						Com_Error(ERR_FATAL, "Couldn't open %s", pak->pakFilename);
+					}
+				}
+				else {
+					fsh[*file].handleFiles.file.z = pak->handle;
+				}
+				Q_strncpyz(fsh[*file].name, filename, sizeof fsh[*file].name);
+				fsh[*file].zipFile = qtrue;
 
-						// set the file position in the zip file (also sets the current file info)
-						unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
+				if (!fsh[*file].mapData) {
+					// set the file position in the zip file (also sets the current file info)
+					unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
 
-						// open the file in the zip
-						unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+					// open the file in the zip
+					unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+				}
 
 #if 0
-						zfi = (unz_s*)fsh[*file].handleFiles.file.z;
-						// in case the file was new
-						temp = zfi->filestream;
-						// set the file position in the zip file (also sets the current file info)
-						unzSetOffset(pak->handle, pakFile->pos);
-						// copy the file info into the unzip structure
-						Com_Memcpy(zfi, pak->handle, sizeof(unz_s));
-						// we copy this back into the structure
-						zfi->filestream = temp;
-						// open the file in the zip
-						unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+				zfi = (unz_s*)fsh[*file].handleFiles.file.z;
+				// in case the file was new
+				temp = zfi->filestream;
+				// set the file position in the zip file (also sets the current file info)
+				unzSetOffset(pak->handle, pakFile->pos);
+				// copy the file info into the unzip structure
+				Com_Memcpy(zfi, pak->handle, sizeof(unz_s));
+				// we copy this back into the structure
+				zfi->filestream = temp;
+				// open the file in the zip
+				unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
 #endif
-						fsh[*file].zipFilePos = pakFile->pos;
-						fsh[*file].zipFileLen = pakFile->len;
+				fsh[*file].zipFilePos = pakFile->pos;
+				fsh[*file].zipFileLen = pakFile->len;
 
-						if (fs_debug->integer) {
-							Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n",
-								filename, pak->pakFilename);
-						}
+				if (fs_debug->integer) {
+					Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n",
+						filename, pak->pakFilename);
+				}
 #ifndef DEDICATED
 #ifndef FINAL_BUILD
-						// Check for unprecached files when in game but not in the menus
-						if ((cls.state == CA_ACTIVE) && !(Key_GetCatcher() & KEYCATCH_UI))
-						{
-							Com_Printf(S_COLOR_YELLOW "WARNING: File %s not precached\n", filename);
-						}
+				// Check for unprecached files when in game but not in the menus
+				if ((cls.state == CA_ACTIVE) && !(Key_GetCatcher() & KEYCATCH_UI))
+				{
+					Com_Printf(S_COLOR_YELLOW "WARNING: File %s not precached\n", filename);
+				}
 #endif
 #endif // DEDICATED
-						return pakFile->len;
-					}
-					pakFile = pakFile->next;
-				} while (pakFile != nullptr);
+				fs_index.pakHits++;
+				return pakFile->len;
 			}
 			else if (search->dir) {
 				// check a file in the directory tree
@@ -1399,15 +2250,8 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 				//   this test can make the search fail although the file is in the directory
 				// I had the problem on https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=8
 				// turned out I used FS_FileExists instead
-				if (fs_numServerPaks) {
-					if (!FS_IsExt(filename, ".cfg", l) &&		// for config files
-						!FS_IsExt(filename, ".fcf", l) &&		// force configuration files
-						!FS_IsExt(filename, ".menu", l) &&		// menu files
-						!FS_IsExt(filename, ".game", l) &&		// menu files
-						!FS_IsExt(filename, ".dat", l) &&		// for journal files
-						!FS_IsDemoExt(filename, l)) {			// demos
-						continue;
-					}
+				if (fs_numServerPaks && !FS_IsDirectoryExt(filename, l)) {
+					continue;
 				}
 
 				directory_t* dir = search->dir;
@@ -1418,12 +2262,7 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 					continue;
 				}
 
-				if (!FS_IsExt(filename, ".cfg", l) &&		// for config files
-					!FS_IsExt(filename, ".fcf", l) &&		// force configuration files
-					!FS_IsExt(filename, ".menu", l) &&		// menu files
-					!FS_IsExt(filename, ".game", l) &&		// menu files
-					!FS_IsExt(filename, ".dat", l) &&		// for journal files
-					!FS_IsDemoExt(filename, l)) {			// demos
+				if (!FS_IsDirectoryExt(filename, l)) {
 					fs_fakeChkSum = Q_flrand(0.0f, 1.0f);
 				}
 #ifdef _WIN32
@@ -1509,11 +2348,20 @@ long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueF
 				}
 #endif
 #endif // dedicated
+				fs_index.dirHits++;
 				return FS_fplength(fsh[*file].handleFiles.file.o);
 			}
 		}
 	} while (b_faster_to_re_open_using_new_local_file);
 
+	fs_index.notFound++;
+
+	// only the paks were searched, and those change only through the engine;
+	// a directory can gain the file at any time, so look again next time
+	if (!fs_index.numDirs || (fs_numServerPaks && !FS_IsDirectoryExt(filename, strlen(filename)))) {
+		FS_AddMiss(filename, indexHash);
+	}
+
 	Com_DPrintf("Can't find %s\n", filename);
 #ifdef FS_MISSING
 	if (missingFiles) {
@@ -1590,17 +2438,20 @@ int FS_Read(void* buffer, int len, fileHandle_t f) {
 		}
 		return len;
 	}
+	if (fsh[f].mapData) {
+		return FS_ReadMapped(buf, len, f);
+	}
 	return unzReadCurrentFile(fsh[f].handleFiles.file.z, buffer, len);
 }
 
 /*
 =================
-FS_Write
+FS_WriteToHandle
 
 Properly handles partial writes
 =================
 */
-int FS_Write(const void* buffer, int len, const fileHandle_t h) {
+static int FS_WriteToHandle(const void* buffer, int len, const fileHandle_t h, const qboolean quiet) {
 	FS_AssertInitialised();
 
 	if (!h) {
@@ -1620,13 +2471,17 @@ int FS_Write(const void* buffer, int len, const fileHandle_t h) {
 				tries = 1;
 			}
 			else {
-				Com_Printf("FS_Write: 0 bytes written\n");
+				if (!quiet) {
+					Com_Printf("FS_Write: 0 bytes written\n");
+				}
 				return 0;
 			}
 		}
 
 		if (written == -1) {
-			Com_Printf("FS_Write: -1 bytes written\n");
+			if (!quiet) {
+				Com_Printf("FS_Write: -1 bytes written\n");
+			}
 			return 0;
 		}
 
@@ -1639,6 +2494,27 @@ int FS_Write(const void* buffer, int len, const fileHandle_t h) {
 	return len;
 }
 
+/*
+=================
+FS_Write
+=================
+*/
+int FS_Write(const void* buffer, const int len, const fileHandle_t h) {
+	return FS_WriteToHandle(buffer, len, h, qfalse);
+}
+
+/*
+=================
+FS_WriteQuiet
+
+FS_Write without the console output, for threads other than the main one.
+Returns 0 if the write failed.
+=================
+*/
+int FS_WriteQuiet(const void* buffer, const int len, const fileHandle_t h) {
+	return FS_WriteToHandle(buffer, len, h, qtrue);
+}
+
 void QDECL FS_Printf(const fileHandle_t h, const char* fmt, ...) {
 	va_list		argptr;
 	char		msg[MAXPRINTMSG];
@@ -1701,13 +2577,28 @@ int FS_Seek(fileHandle_t f, long offset, int origin) {
 			}
 		}
 
+		if (fsh[f].mapData && !fsh[f].mapInflate) {
+			// stored in a mapped pak, just move the cursor
+			int target = origin == FS_SEEK_SET ? remainder : currentPosition + remainder;
+			if (target > fsh[f].zipFileLen) {
+				target = fsh[f].zipFileLen;
+			}
+			fsh[f].mapPos = target;
+			return offset;
+		}
+
 		switch (origin) {
 		case FS_SEEK_SET:
 			if (remainder == currentPosition) {
 				return offset;
 			}
-			unzSetOffset(fsh[f].handleFiles.file.z, fsh[f].zipFilePos);
-			unzOpenCurrentFile(fsh[f].handleFiles.file.z);
+			if (fsh[f].mapData) {
+				FS_RewindMapped(f);
+			}
+			else {
+				unzSetOffset(fsh[f].handleFiles.file.z, fsh[f].zipFilePos);
+				unzOpenCurrentFile(fsh[f].handleFiles.file.z);
+			}
 			//fallthrough
 
 		case FS_SEEK_END:
@@ -1751,8 +2642,6 @@ CONVENIENCE FUNCTIONS FOR ENTIRE FILES
 */
 
 int	FS_FileIsInPAK(const char* filename, int* pChecksum) {
-	long			hash = 0;
-
 	FS_AssertInitialised();
 
 	if (!filename) {
@@ -1771,36 +2660,17 @@ int	FS_FileIsInPAK(const char* filename, int* pChecksum) {
 		return -1;
 	}
 
-	//
-	// search through the path, one element at a time
-	//
-
-	for (const searchpath_t* search = fs_searchpaths; search; search = search->next) {
-		//
-		if (search->pack) {
-			hash = FS_HashFileName(filename, search->pack->hashSize);
+	// only the paks holding it, in search path order
+	for (const fsIndexHit_t* hit = FS_IndexLookup(filename, FS_IndexHash(filename)); hit; hit = hit->next) {
+		// disregard if it doesn't match one of the allowed pure pak files
+		if (!FS_PakIsPure(hit->search->pack)) {
+			continue;
 		}
-		// is the element a pak file?
-		if (search->pack && search->pack->hashTable[hash]) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if (!FS_PakIsPure(search->pack)) {
-				continue;
-			}
 
-			// look through all the pak file elements
-			const pack_t* pak = search->pack;
-			const fileInPack_t* pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if (!FS_FilenameCompare(pakFile->name, filename)) {
-					if (pChecksum) {
-						*pChecksum = pak->pure_checksum;
-					}
-					return 1;
-				}
-				pakFile = pakFile->next;
-			} while (pakFile != nullptr);
+		if (pChecksum) {
+			*pChecksum = hit->search->pack->pure_checksum;
 		}
+		return 1;
 	}
 	return -1;
 }
@@ -1869,8 +2739,11 @@ long FS_ReadFile(const char* qpath, void** buffer) {
 		isConfig = qfalse;
 	}
 
-	// look for it in the filesystem or pack files
+	// look for it in the filesystem or pack files, a length query must not
+	// claim (or decode) a preloaded buffer only to free it on close
+	fs_preload.lengthOnly = static_cast<qboolean>(buffer == nullptr);
 	len = FS_FOpenFileRead(qpath, &h, qfalse);
+	fs_preload.lengthOnly = qfalse;
 	if (h == 0) {
 		if (buffer) {
 			*buffer = nullptr;
@@ -1897,13 +2770,21 @@ long FS_ReadFile(const char* qpath, void** buffer) {
 
 	fs_loadCount++;
 
-	buf = static_cast<byte*>(Z_Malloc(len + 1, TAG_FILESYS, qfalse));
-	buf[len] = '\0';	// because we're not calling Z_Malloc with optional trailing 'bZeroIt' bool
-	*buffer = buf;
+	if (fsh[h].mapOwned && !fsh[h].mapPos) {
+		// decoded ahead of time by the preloader, take its buffer
+		buf = fsh[h].mapOwned;
+		fsh[h].mapOwned = nullptr;
+		fs_readCount += len;
+	}
+	else {
+		buf = static_cast<byte*>(Z_Malloc(len + 1, TAG_FILESYS, qfalse));
+		buf[len] = '\0';	// because we're not calling Z_Malloc with optional trailing 'bZeroIt' bool
 
-	//	Z_Label(buf, qpath);
+		//	Z_Label(buf, qpath);
 
-	FS_Read(buf, len, h);
+		FS_Read(buf, len, h);
+	}
+	*buffer = buf;
 
 	// guarantee that it will have a trailing 0 for string operations
 	buf[len] = 0;
@@ -2078,6 +2959,9 @@ Frees a pak structure and releases all associated resources
 
 static void FS_FreePak(pack_t* thepak)
 {
+	if (thepak->mapped) {
+		Sys_UnmapFile(const_cast<byte*>(thepak->mapped), thepak->mappedLen);
+	}
 	unzClose(thepak->handle);
 	Z_Free(thepak->buildBuffer);
 	Z_Free(thepak);
@@ -2858,6 +3742,8 @@ static void FS_AddGameDirectory(const char* path, const char* dir) {
 		}
 	}
 
+	FS_InvalidateIndex();
+
 	Q_strncpyz(fs_gamedir, dir, sizeof fs_gamedir);
 
 	// find all pak files in this directory
@@ -2899,6 +3785,10 @@ static void FS_AddGameDirectory(const char* path, const char* dir) {
 		// store the game name for downloading
 		Q_strncpyz(pak->pakGamename, dir, sizeof pak->pakGamename);
 
+		if (fs_mmap->integer) {
+			FS_MapPak(pak);
+		}
+
 		fs_packFiles += pak->numfiles;
 
 		search = static_cast<searchpath_s*>(Z_Malloc(sizeof(searchpath_t), TAG_FILESYS, qtrue));
@@ -3115,6 +4005,10 @@ void FS_Shutdown(qboolean closemfp) {
 		}
 	}
 
+	// the workers may still be decoding out of the paks
+	FS_FinishPreload(qfalse);
+	FS_FreeIndex();
+
 	// free everything
 	for (searchpath_t* p = fs_searchpaths; p; p = next) {
 		next = p->next;
@@ -3136,6 +4030,7 @@ void FS_Shutdown(qboolean closemfp) {
 	Cmd_RemoveCommand("fdir");
 	Cmd_RemoveCommand("touchFile");
 	Cmd_RemoveCommand("which");
+	Cmd_RemoveCommand("fs_stats");
 
 #ifdef FS_MISSING
 	if (closemfp) {
@@ -3198,6 +4093,10 @@ static void FS_ReorderPurePaks()
 			p_previous = &s->next;
 		}
 	}
+
+	if (fs_reordered) {
+		FS_InvalidateIndex();
+	}
 }
 
 /**
@@ -3237,6 +4136,8 @@ static void FS_Startup(const char* gameName) {
 	fs_gamedirvar = Cvar_Get("fs_game", "MD", CVAR_INIT | CVAR_SYSTEMINFO, "Mod directory");
 
 	fs_dirbeforepak = Cvar_Get("fs_dirbeforepak", "0", CVAR_INIT | CVAR_PROTECTED, "Prioritize directories before paks if not pure");
+	// mapping every pk3 up front would eat the address space a 32 bit build needs for the hunk
+	fs_mmap = Cvar_Get("fs_mmap", sizeof(void*) == 4 ? "0" : "1", CVAR_ARCHIVE | CVAR_LATCH, "Map pk3 files into memory and read their files without minizip");
 
 	// add search path elements in reverse priority order (lowest priority first)
 	if (fs_cdpath->string[0]) {
@@ -3293,11 +4194,15 @@ static void FS_Startup(const char* gameName) {
 	Cmd_AddCommand("fdir", FS_NewDir_f, "Lists a folder with filters");
 	Cmd_AddCommand("touchFile", FS_TouchFile_f, "Touches a file");
 	Cmd_AddCommand("which", FS_Which_f, "Determines which search path a file was loaded from");
+	Cmd_AddCommand("fs_stats", FS_Stats_f, "Prints file index build time and lookup hit rates");
 
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
 
+	// index every pak and directory now so the first map load doesn't pay for it
+	FS_BuildIndex();
+
 	// print the current search paths
 	FS_Path_f();
 
@@ -3513,6 +4418,9 @@ void FS_ClearPakReferences(int flags) {
 			search->pack->referenced &= ~flags;
 		}
 	}
+
+	// new map, new downloads: don't trust misses recorded for the last one
+	FS_ForgetMisses();
 }
 
 /*
@@ -3541,6 +4449,9 @@ void FS_PureServerSetLoadedPaks(const char* pakSums, const char* pakNames) {
 		fs_serverPaks[i] = atoi(Cmd_Argv(i));
 	}
 
+	// purity decides which paks a lookup may use, so earlier misses may not hold
+	FS_ForgetMisses();
+
 	if (fs_numServerPaks) {
 		Com_DPrintf("Connected to a pure server.\n");
 	}
@@ -3806,7 +4717,10 @@ int		FS_FOpenFileByMode(const char* qpath, fileHandle_t* f, fsMode_t mode) {
 
 int		FS_FTell(fileHandle_t f) {
 	int pos;
-	if (fsh[f].zipFile == qtrue) {
+	if (fsh[f].mapData) {
+		pos = fsh[f].mapPos;
+	}
+	else if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	}
 	else {
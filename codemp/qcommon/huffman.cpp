@@ -27,7 +27,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/qcommon.h"
 
-static int bloc = 0;
+// per thread so that messages can be encoded on job workers
+static thread_local int bloc = 0;
 
 void Huff_putBit(const int bit, byte* fout, int* offset)
 {
@@ -50,6 +51,51 @@ int Huff_getBit(const byte* fin, int* offset)
 	return t;
 }
 
+/* Write count (at most 57) bits at once, first bit in bit 0.  Like
+ * Huff_putBit, the bits already written to the current byte are kept */
+void Huff_putBits(const uint64_t bits, const int count, byte* fout, int* offset)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	byte* out = fout + (*offset >> 3);
+	const int shift = *offset & 7;
+	const uint64_t v = bits << shift | (out[0] & ((1 << shift) - 1));
+	const int numBytes = (shift + count + 7) >> 3;
+
+	for (int i = 0; i < numBytes; i++)
+	{
+		out[i] = static_cast<byte>(v >> (i << 3));
+	}
+	*offset += count;
+}
+
+/* Return the next count (at most 24) bits without consuming them.  Bytes
+ * at or past maxoffset are never touched and read as zero */
+unsigned Huff_peekBits(const byte* fin, const int offset, const int count, const int maxoffset)
+{
+	const byte* in = fin + (offset >> 3);
+	const int available = ((maxoffset + 7) >> 3) - (offset >> 3);
+	unsigned window;
+
+	if (available >= 4)
+	{
+		window = in[0] | in[1] << 8 | in[2] << 16 | static_cast<unsigned>(in[3]) << 24;
+	}
+	else
+	{
+		window = 0;
+		for (int i = 0; i < available; i++)
+		{
+			window |= in[i] << (i << 3);
+		}
+	}
+
+	return window >> (offset & 7) & ((1u << count) - 1);
+}
+
 /* Add a bit to the output file (buffered) */
 static void add_bit(const char bit, byte* fout)
 {
@@ -361,6 +407,29 @@ void Huff_offsetReceive(node_t* node, int* ch, byte* fin, int* offset, int maxof
 	*offset = bloc;
 }
 
+/* Get a symbol, HUFF_LOOKUP_BITS at a time when the code is short enough */
+int Huff_lookupReceive(const huffCodes_t* codes, node_t* tree, byte* fin, int* offset, const int maxoffset)
+{
+	const int available = maxoffset - *offset;
+
+	if (available > 0)
+	{
+		const int entry = codes->lookup[Huff_peekBits(fin, *offset, HUFF_LOOKUP_BITS, maxoffset)];
+		const int length = entry >> 9;
+
+		if (length && length <= available)
+		{
+			*offset += length;
+			return entry & 0x1ff;
+		}
+	}
+
+	// long code, or the message ends inside it
+	int ch;
+	Huff_offsetReceive(tree, &ch, fin, offset, maxoffset);
+	return ch;
+}
+
 /* Send the prefix code for this node */
 static void send(node_t* node, node_t* child, byte* fout, int maxoffset)
 {
@@ -470,7 +539,7 @@ void Huff_Decompress(msg_t* mbuf, const int offset)
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern int oldsize;
+extern thread_local int oldsize;
 
 void Huff_Compress(msg_t* mbuf, const int offset)
 {
@@ -512,6 +581,49 @@ void Huff_Compress(msg_t* mbuf, const int offset)
 	Com_Memcpy(mbuf->data + offset, seq, bloc >> 3);
 }
 
+/* Flatten the current tree into code and lookup tables.  Only valid until
+ * the next Huff_addRef */
+void Huff_BuildCodes(const huff_t* huff, huffCodes_t* codes)
+{
+	Com_Memset(codes, 0, sizeof * codes);
+
+	for (int symbol = 0; symbol <= HMAX; symbol++)
+	{
+		const node_t* node = huff->loc[symbol];
+		unsigned code = 0;
+		int length = 0;
+
+		if (!node)
+		{
+			continue;
+		}
+
+		// walk up to the root, shifting so the bit nearest the root (the
+		// first one sent) ends up in bit 0
+		for (; node->parent && length <= HUFF_MAX_CODE_BITS; node = node->parent, length++)
+		{
+			code = code << 1 | (node->parent->right == node ? 1 : 0);
+		}
+
+		if (!length || length > HUFF_MAX_CODE_BITS)
+		{
+			continue;
+		}
+
+		codes->code[symbol] = code;
+		codes->length[symbol] = static_cast<byte>(length);
+
+		if (length <= HUFF_LOOKUP_BITS)
+		{
+			// every window starting with this code decodes to it
+			for (int fill = 0; fill < 1 << (HUFF_LOOKUP_BITS - length); fill++)
+			{
+				codes->lookup[code | fill << length] = static_cast<unsigned short>(symbol | length << 9);
+			}
+		}
+	}
+}
+
 void Huff_Init(huffman_t* huff)
 {
 	Com_Memset(&huff->compressor, 0, sizeof(huff_t));
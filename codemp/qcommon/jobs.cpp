@@ -0,0 +1,418 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// jobs.cpp -- small worker pool used to spread independent per-item work
+// (one index per client, per trace, ...) across cores.  Jobs must not touch
+// the console, the filesystem or the VMs; anything that does belongs in the
+// serial part of the caller.
+
+#include "qcommon/qcommon.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define MAX_JOB_WORKERS 32
+
+cvar_t* com_jobThreads;
+
+using jobPool_t = struct jobPool_s
+{
+	std::mutex batchLock; // one ParallelFor at a time
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::vector<std::thread> threads;
+
+	jobFunc_t func;
+	void* data;
+	int count;
+	std::atomic<int> next;
+	int active; // workers that have not finished the current batch
+	unsigned generation;
+	bool failed;
+	int errorCode; // first error raised by a job, raised again by the caller
+	char errorMessage[MAXPRINTMSG];
+	bool quit;
+};
+
+// what Com_Error throws on a job instead of handling the error there
+using jobError_t = struct jobError_s
+{
+	int code;
+	char message[MAXPRINTMSG];
+};
+
+// allocated (and never destroyed outside of Com_ShutdownJobs) so that exiting
+// without a clean shutdown doesn't run destructors under running workers
+static jobPool_t* jobPool = nullptr;
+
+static thread_local bool jobIsWorker = false;
+
+// a Com_StartJobs batch is running and owns the pool until Com_FinishJobs
+static bool jobAsync = false;
+
+static void Job_Fail(jobPool_t* pool, const int code, const char* message)
+{
+	std::lock_guard<std::mutex> lk(pool->lock);
+	if (!pool->failed)
+	{
+		pool->failed = true;
+		pool->errorCode = code;
+		Q_strncpyz(pool->errorMessage, message, sizeof pool->errorMessage);
+	}
+}
+
+static void Job_RunBatch(jobPool_t* pool)
+{
+	int index;
+
+	while ((index = pool->next.fetch_add(1)) < pool->count)
+	{
+		try
+		{
+			pool->func(index, pool->data);
+		}
+		catch (const jobError_t& error)
+		{
+			Job_Fail(pool, error.code, error.message);
+		}
+		catch (const std::exception& e)
+		{
+			char message[MAXPRINTMSG];
+			Com_sprintf(message, sizeof message, "job threw: %s", e.what());
+			Job_Fail(pool, ERR_DROP, message);
+		}
+		catch (...)
+		{
+			Job_Fail(pool, ERR_DROP, "job threw an unknown exception");
+		}
+	}
+}
+
+/*
+==================
+Job_RaiseError
+
+Raises the first error of a finished batch on the calling thread
+==================
+*/
+static void Job_RaiseError(jobPool_t* pool)
+{
+	int errorCode;
+	char errorMessage[MAXPRINTMSG];
+	{
+		std::lock_guard<std::mutex> lk(pool->lock);
+		if (!pool->failed)
+		{
+			return;
+		}
+		errorCode = pool->errorCode;
+		Q_strncpyz(errorMessage, pool->errorMessage, sizeof errorMessage);
+		pool->failed = false;
+	}
+
+	Com_Error(errorCode, "%s", errorMessage);
+}
+
+/*
+==================
+Com_InJob
+
+True while running a job, where errors must not be handled on the spot
+==================
+*/
+bool Com_InJob(void)
+{
+	return jobIsWorker;
+}
+
+/*
+==================
+Com_JobError
+
+Called by Com_Error inside a job, unwinds the job so the batch can report the error
+once every job has stopped
+==================
+*/
+void NORETURN Com_JobError(const int code, const char* message)
+{
+	jobError_t error;
+	error.code = code;
+	Q_strncpyz(error.message, message, sizeof error.message);
+	throw error;
+}
+
+static void Job_WorkerLoop(jobPool_t* pool)
+{
+	unsigned seen = 0;
+
+	jobIsWorker = true;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lk(pool->lock);
+			pool->wake.wait(lk, [&] { return pool->quit || pool->generation != seen; });
+			if (pool->quit)
+			{
+				return;
+			}
+			seen = pool->generation;
+		}
+
+		Job_RunBatch(pool);
+
+		std::lock_guard<std::mutex> lk(pool->lock);
+		if (--pool->active == 0)
+		{
+			pool->done.notify_one();
+		}
+	}
+}
+
+/*
+==================
+Com_InitJobs
+
+com_jobThreads is the number of extra threads; -1 picks one less than the
+number of hardware threads, 0 runs every job on the calling thread.
+==================
+*/
+void Com_InitJobs(void)
+{
+	com_jobThreads = Cvar_Get("com_jobThreads", "0", CVAR_ARCHIVE_ND | CVAR_LATCH,
+		"Number of worker threads for parallel server work (-1 = auto, 0 = off)");
+
+	if (jobPool)
+	{
+		return;
+	}
+
+	int numThreads = com_jobThreads->integer;
+	if (numThreads < 0)
+	{
+		numThreads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+	}
+	if (numThreads > MAX_JOB_WORKERS)
+	{
+		numThreads = MAX_JOB_WORKERS;
+	}
+	if (numThreads <= 0)
+	{
+		return;
+	}
+
+	jobPool = new jobPool_t;
+	jobPool->func = nullptr;
+	jobPool->data = nullptr;
+	jobPool->count = 0;
+	jobPool->next = 0;
+	jobPool->active = 0;
+	jobPool->generation = 0;
+	jobPool->failed = false;
+	jobPool->errorCode = 0;
+	jobPool->errorMessage[0] = '\0';
+	jobPool->quit = false;
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		jobPool->threads.emplace_back(Job_WorkerLoop, jobPool);
+	}
+
+	Com_Printf("Started %i job worker threads\n", numThreads);
+}
+
+/*
+==================
+Com_ShutdownJobs
+==================
+*/
+void Com_ShutdownJobs(void)
+{
+	if (!jobPool)
+	{
+		return;
+	}
+
+	Com_FinishJobs();
+
+	{
+		std::lock_guard<std::mutex> lk(jobPool->lock);
+		jobPool->quit = true;
+	}
+	jobPool->wake.notify_all();
+
+	for (auto& thread : jobPool->threads)
+	{
+		thread.join();
+	}
+
+	delete jobPool;
+	jobPool = nullptr;
+}
+
+/*
+==================
+Com_NumJobWorkers
+
+Number of threads a ParallelFor can spread over, including the caller
+==================
+*/
+int Com_NumJobWorkers(void)
+{
+	if (!jobPool)
+	{
+		return 1;
+	}
+	return static_cast<int>(jobPool->threads.size()) + 1;
+}
+
+/*
+==================
+Com_ParallelFor
+
+Calls func( i, data ) for every i in [0, count) and returns once all of them
+have finished.  The caller takes part in the work.  Nested calls from inside
+a job run inline.  A Com_StartJobs batch still running is finished first,
+with the caller helping, so the pool is free again for this one.  A Com_Error
+inside a job stops that job only, the first one is raised again here once the
+whole batch is done.
+==================
+*/
+void Com_ParallelFor(const int count, const jobFunc_t func, void* data)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (!jobPool || count == 1 || jobIsWorker)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			func(i, data);
+		}
+		return;
+	}
+
+	// queue behind a background batch instead of running this one alone
+	Com_FinishJobs();
+
+	std::lock_guard<std::mutex> batch(jobPool->batchLock);
+
+	{
+		std::lock_guard<std::mutex> lk(jobPool->lock);
+		jobPool->func = func;
+		jobPool->data = data;
+		jobPool->count = count;
+		jobPool->next = 0;
+		jobPool->active = static_cast<int>(jobPool->threads.size());
+		jobPool->failed = false;
+		jobPool->generation++;
+	}
+	jobPool->wake.notify_all();
+
+	jobIsWorker = true;
+	Job_RunBatch(jobPool);
+	jobIsWorker = false;
+
+	{
+		std::unique_lock<std::mutex> lk(jobPool->lock);
+		jobPool->done.wait(lk, [] { return jobPool->active == 0; });
+	}
+
+	Job_RaiseError(jobPool);
+}
+
+/*
+==================
+Com_StartJobs
+
+Like Com_ParallelFor, but returns at once and leaves the work to the worker
+threads; data must stay valid until Com_FinishJobs.  Only one such batch runs
+at a time, a second Com_StartJobs or a Com_ParallelFor finishes the first.
+Without workers everything runs before returning.
+==================
+*/
+void Com_StartJobs(const int count, const jobFunc_t func, void* data)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (!jobPool || jobIsWorker)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			func(i, data);
+		}
+		return;
+	}
+
+	Com_FinishJobs();
+
+	jobPool->batchLock.lock();
+	jobAsync = true;
+
+	{
+		std::lock_guard<std::mutex> lk(jobPool->lock);
+		jobPool->func = func;
+		jobPool->data = data;
+		jobPool->count = count;
+		jobPool->next = 0;
+		jobPool->active = static_cast<int>(jobPool->threads.size());
+		jobPool->failed = false;
+		jobPool->generation++;
+	}
+	jobPool->wake.notify_all();
+}
+
+/*
+==================
+Com_FinishJobs
+
+Helps with whatever is left of the Com_StartJobs batch and waits for it
+==================
+*/
+void Com_FinishJobs(void)
+{
+	if (!jobAsync)
+	{
+		return;
+	}
+
+	jobIsWorker = true;
+	Job_RunBatch(jobPool);
+	jobIsWorker = false;
+
+	{
+		std::unique_lock<std::mutex> lk(jobPool->lock);
+		jobPool->done.wait(lk, [] { return jobPool->active == 0; });
+	}
+
+	jobAsync = false;
+	jobPool->batchLock.unlock();
+
+	Job_RaiseError(jobPool);
+}
@@ -26,10 +26,13 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/qcommon.h"
 #include "server/server.h"
 
+#include <atomic>
+
 //#define _NEWHUFFTABLE_		// Build "c:\\netchan.bin"
 //#define _USINGNEWHUFFTABLE_		// Build a new frequency table to cut and paste.
 
 static huffman_t msgHuff;
+static huffCodes_t msgHuffCodes; // msgHuff never changes after MSG_initHuffman
 
 static qboolean msgInit = qfalse;
 #ifdef _NEWHUFFTABLE_
@@ -49,7 +52,7 @@ Handles byte ordering and avoids alignment errors
 int gLastBitIndex = 0;
 #endif
 
-int oldsize = 0;
+thread_local int oldsize = 0;
 
 bool g_nOverrideChecked = false;
 void MSG_CheckNETFPSFOverrides(qboolean psfOverrides);
@@ -136,7 +139,32 @@ bit functions
 =============================================================================
 */
 
-int overflows;
+thread_local int overflows;
+
+/*
+============
+MSG_FlushBits
+
+Stores bits gathered by MSG_WriteBits.  On overflow whatever fits is still
+written and the cursor left one past the end, the same as a bit by bit
+Huff_offsetTransmit would.
+============
+*/
+static qboolean MSG_FlushBits(msg_t* msg, const uint64_t bits, const int count, const int maxbits)
+{
+	if (msg->bit + count > maxbits)
+	{
+		const int fits = maxbits - msg->bit;
+
+		Huff_putBits(bits & ((1ULL << fits) - 1), fits, msg->data, &msg->bit);
+		msg->bit = maxbits + 1;
+		msg->overflowed = qtrue;
+		return qfalse;
+	}
+
+	Huff_putBits(bits, count, msg->data, &msg->bit);
+	return qtrue;
+}
 
 // negative bit values include signs
 void MSG_WriteBits(msg_t* msg, int value, int bits)
@@ -224,45 +252,123 @@ void MSG_WriteBits(msg_t* msg, int value, int bits)
 	}
 	else
 	{
-		int i;
+		const int maxbits = msg->maxsize << 3;
+		uint64_t pending = 0; // raw bits and codes, stored with one Huff_putBits
+		int numPending = 0;
+
 		value &= (0xffffffff >> (32 - bits));
 		if (bits & 7)
 		{
 			const int nbits = bits & 7;
 
-			if (msg->bit + nbits > msg->maxsize << 3)
+			if (msg->bit + nbits > maxbits)
 			{
 				msg->overflowed = qtrue;
 				return;
 			}
-			for (i = 0; i < nbits; i++)
-			{
-				Huff_putBit(value & 1, msg->data, &msg->bit);
-				value = value >> 1;
-			}
+			pending = value & ((1 << nbits) - 1);
+			numPending = nbits;
+			value = value >> nbits;
 			bits = bits - nbits;
 		}
-		if (bits)
+		for (int i = 0; i < bits; i += 8)
 		{
-			for (i = 0; i < bits; i += 8)
-			{
+			const int ch = value & 0xff;
+			const int length = msgHuffCodes.length[ch];
+
 #ifdef _NEWHUFFTABLE_
-				fwrite(&value, 1, 1, fp);
+			fwrite(&value, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
-				Huff_offsetTransmit(&msgHuff.compressor, value & 0xff, msg->data, &msg->bit, msg->maxsize << 3);
-				value = value >> 8;
+			value = value >> 8;
 
-				if (msg->bit > msg->maxsize << 3)
+			if (!length || numPending + length > 57)
+			{
+				if (!MSG_FlushBits(msg, pending, numPending, maxbits))
+				{
+					return;
+				}
+				pending = 0;
+				numPending = 0;
+			}
+
+			if (!length)
+			{
+				// code too long for the table
+				Huff_offsetTransmit(&msgHuff.compressor, ch, msg->data, &msg->bit, maxbits);
+				if (msg->bit > maxbits)
 				{
 					msg->overflowed = qtrue;
 					return;
 				}
+				continue;
 			}
+
+			pending |= static_cast<uint64_t>(msgHuffCodes.code[ch]) << numPending;
+			numPending += length;
+		}
+
+		if (!MSG_FlushBits(msg, pending, numPending, maxbits))
+		{
+			return;
 		}
 		msg->cursize = (msg->bit >> 3) + 1;
 	}
 }
 
+/*
+============
+MSG_WriteEncodedBits
+
+Appends the first numBits of a bitstream that was already written (and
+huffman encoded) by MSG_WriteBits into another message.  The stream doesn't
+depend on where it starts, so it can be copied to any bit position.
+============
+*/
+void MSG_WriteEncodedBits(msg_t* msg, const byte* data, const int numBits)
+{
+	if (msg->overflowed || numBits <= 0)
+	{
+		return;
+	}
+
+	const int numBytes = (numBits + 7) >> 3;
+
+	// the same overflow check as MSG_WriteBits, so a copied stream fits exactly
+	// when writing it directly would have; the copy still has to stay inside the
+	// buffer, including the byte past the end that a shifted copy touches
+	if (msg->oob || msg->maxsize - msg->cursize < 4 || (msg->bit >> 3) + numBytes >= msg->maxsize)
+	{
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	const int shift = msg->bit & 7;
+	byte* out = msg->data + (msg->bit >> 3);
+
+	if (!shift)
+	{
+		Com_Memcpy(out, data, numBytes);
+	}
+	else
+	{
+		// the partial byte at the cursor keeps its low bits
+		*out &= (1 << shift) - 1;
+		for (int i = 0; i < numBytes; i++)
+		{
+			out[i] |= data[i] << shift;
+			out[i + 1] = data[i] >> (8 - shift);
+		}
+	}
+
+	msg->bit += numBits;
+	// clear anything copied past the end of the stream
+	if (msg->bit & 7)
+	{
+		msg->data[msg->bit >> 3] &= (1 << (msg->bit & 7)) - 1;
+	}
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
 int MSG_ReadBits(msg_t* msg, int bits)
 {
 	int value;
@@ -316,7 +422,6 @@ int MSG_ReadBits(msg_t* msg, int bits)
 	}
 	else
 	{
-		int i;
 		int nbits = 0;
 		if (bits & 7)
 		{
@@ -327,17 +432,16 @@ int MSG_ReadBits(msg_t* msg, int bits)
 				msg->readcount = msg->cursize + 1;
 				return 0;
 			}
-			for (i = 0; i < nbits; i++)
-			{
-				value |= (Huff_getBit(msg->data, &msg->bit) << i);
-			}
+			value = static_cast<int>(Huff_peekBits(msg->data, msg->bit, nbits, msg->cursize << 3));
+			msg->bit += nbits;
 			bits = bits - nbits;
 		}
 		if (bits)
 		{
-			for (i = 0; i < bits; i += 8)
+			for (int i = 0; i < bits; i += 8)
 			{
-				Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
+				get = Huff_lookupReceive(&msgHuffCodes, msgHuff.decompressor.tree, msg->data, &msg->bit,
+					msg->cursize << 3);
 #ifdef _NEWHUFFTABLE_
 				fwrite(&get, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
@@ -919,7 +1023,7 @@ using netField_t = struct netField_s
 	size_t offset;
 	int bits; // 0 = float
 #ifndef FINAL_BUILD
-	unsigned	mCount;
+	std::atomic<unsigned>	mCount; // bumped by the snapshot encoders on the job threads
 #endif
 };
 
@@ -1228,7 +1332,7 @@ void MSG_WriteDeltaEntity(msg_t* msg, entityState_s* from, entityState_s* to, co
 		{
 			lc = i + 1;
 #ifndef FINAL_BUILD
-			field->mCount++;
+			field->mCount.fetch_add(1, std::memory_order_relaxed);
 #endif
 		}
 	}
@@ -2587,7 +2691,7 @@ void MSG_WriteDeltaPlayerstate(msg_t * msg, playerState_s * from, playerState_s
 		{
 			lc = i + 1;
 #ifndef FINAL_BUILD
-			field->mCount++;
+			field->mCount.fetch_add(1, std::memory_order_relaxed);
 #endif
 		}
 	}
@@ -3579,6 +3683,7 @@ void MSG_initHuffman()
 			Huff_addRef(&msgHuff.decompressor, static_cast<byte>(i)); // Do update
 		}
 	}
+	Huff_BuildCodes(&msgHuff.compressor, &msgHuffCodes);
 }
 
 #else
@@ -3613,6 +3718,7 @@ void MSG_initHuffman() {
 	}
 	Com_Printf("};\n");
 	FS_FreeFile(data);
+	Huff_BuildCodes(&msgHuff.compressor, &msgHuffCodes);
 	Cbuf_AddText("condump dump.txt\n");
 }
 
@@ -3645,16 +3751,14 @@ void MSG_ReportChangeVectors_f(void) {
 	Com_Printf("Entity State Fields:\n");
 	for (i = 0, field = entityStateFields; i < numFields; i++, field++)
 	{
-		Com_Printf("%s\t\t%d\n", field->name, field->mCount);
-		field->mCount = 0;
+		Com_Printf("%s\t\t%u\n", field->name, field->mCount.exchange(0, std::memory_order_relaxed));
 	}
 
 	Com_Printf("\nPlayer State Fields:\n");
 	numFields = (int)ARRAY_LEN(playerStateFields);
 	for (i = 0, field = playerStateFields; i < numFields; i++, field++)
 	{
-		Com_Printf("%s\t\t%d\n", field->name, field->mCount);
-		field->mCount = 0;
+		Com_Printf("%s\t\t%u\n", field->name, field->mCount.exchange(0, std::memory_order_relaxed));
 	}
 }
 #endif	// FINAL_BUILD
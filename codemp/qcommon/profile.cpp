@@ -0,0 +1,634 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// profile.cpp -- scoped zone profiler.  While com_profile is set every
+// PROFILE_SCOPE that finishes drops a { zone, start, end } event into a ring
+// owned by the thread that ran it, so recording takes no locks.  profile_dump
+// writes what the rings hold as a Chrome trace (chrome://tracing, Perfetto).
+// Each thread also keeps a call count and a duration histogram per zone, the
+// percentiles profile_dump prints come from those, so a zone that runs once a
+// frame isn't judged by the few calls the busy zones left in the ring.
+
+#include "qcommon/qcommon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MAX_PROFILE_ZONES	256
+#define MAX_PROFILE_THREADS	64
+
+// durations under a microsecond share the first bucket, after that each
+// doubling is split in four, so a bucket is at most a quarter of its value
+#define PROFILE_BUCKETS			128
+#define PROFILE_BUCKET_SHIFT	10
+
+cvar_t* com_profile;
+static cvar_t* com_profileEvents;
+
+bool com_profiling = false;
+
+using profileEvent_t = struct profileEvent_s
+{
+	int64_t start; // Com_ProfileTime
+	int64_t end;
+	int zone;
+};
+
+using profileZoneStats_t = struct profileZoneStats_s
+{
+	std::atomic<uint32_t> calls;
+	std::atomic<int64_t> total;
+	std::atomic<int64_t> max;
+	std::atomic<uint32_t> buckets[PROFILE_BUCKETS];
+};
+
+using profileRing_t = struct profileRing_s
+{
+	profileEvent_t* events;
+	uint64_t size; // power of two
+	std::atomic<uint64_t> head; // events ever written, the next one goes to head & (size - 1)
+	std::atomic<uint64_t> cleared; // head at the last profile_clear
+	int threadNum;
+	bool mainThread;
+
+	// only the owning thread writes these, it zeroes them itself when it sees
+	// a new profileStatsGeneration
+	profileZoneStats_t* zones; // MAX_PROFILE_ZONES
+	std::atomic<int> statsGeneration;
+	std::atomic<int64_t> statsStart; // first zone start since then
+	std::atomic<int64_t> statsEnd; // last zone end
+};
+
+static std::mutex profileLock; // zone and thread registration
+static const char* profileZoneNames[MAX_PROFILE_ZONES];
+static std::atomic<int> profileNumZones(0);
+static profileRing_t* profileRings[MAX_PROFILE_THREADS];
+static std::atomic<int> profileNumRings(0);
+static std::atomic<int> profileStatsGeneration(0); // bumped by profile_clear
+
+static std::chrono::steady_clock::time_point profileBaseTime = std::chrono::steady_clock::now();
+static std::thread::id profileMainThread;
+
+static thread_local profileRing_t* profileThreadRing = nullptr;
+static thread_local bool profileThreadRefused = false; // out of ring slots
+
+/*
+==================
+Com_ProfileTime
+
+Nanoseconds since profileBaseTime, which is taken during static
+initialisation
+==================
+*/
+int64_t Com_ProfileTime(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profileBaseTime).count();
+}
+
+/*
+==================
+Com_ProfileRegisterZone
+
+Returns the id of the zone with this name, adding it if it is new.  Names
+are not copied, PROFILE_SCOPE passes string literals.
+==================
+*/
+int Com_ProfileRegisterZone(const char* name)
+{
+	std::lock_guard<std::mutex> lk(profileLock);
+
+	const int numZones = profileNumZones.load(std::memory_order_relaxed);
+	for (int i = 0; i < numZones; i++)
+	{
+		if (!strcmp(profileZoneNames[i], name))
+		{
+			return i;
+		}
+	}
+
+	if (numZones == MAX_PROFILE_ZONES)
+	{
+		return -1;
+	}
+
+	profileZoneNames[numZones] = name;
+	profileNumZones.store(numZones + 1, std::memory_order_release);
+	return numZones;
+}
+
+/*
+==================
+Profile_ThreadRing
+
+The calling thread's ring, made the first time the thread records
+==================
+*/
+static profileRing_t* Profile_ThreadRing(void)
+{
+	if (profileThreadRing || profileThreadRefused)
+	{
+		return profileThreadRing;
+	}
+
+	std::lock_guard<std::mutex> lk(profileLock);
+
+	const int numRings = profileNumRings.load(std::memory_order_relaxed);
+	if (numRings == MAX_PROFILE_THREADS)
+	{
+		profileThreadRefused = true;
+		return nullptr;
+	}
+
+	uint64_t size = 1024;
+	while (size < static_cast<uint64_t>(com_profileEvents->integer) && size < 1 << 22)
+	{
+		size <<= 1;
+	}
+
+	const auto ring = new profileRing_t;
+	ring->events = new profileEvent_t[size];
+	ring->size = size;
+	ring->head = 0;
+	ring->cleared = 0;
+	ring->threadNum = numRings;
+	ring->mainThread = std::this_thread::get_id() == profileMainThread;
+	ring->zones = new profileZoneStats_t[MAX_PROFILE_ZONES]();
+	ring->statsGeneration = profileStatsGeneration.load(std::memory_order_relaxed);
+	ring->statsStart = INT64_MAX;
+	ring->statsEnd = 0;
+
+	profileRings[numRings] = ring;
+	profileNumRings.store(numRings + 1, std::memory_order_release);
+
+	profileThreadRing = ring;
+	return ring;
+}
+
+/*
+==================
+Profile_Bucket
+==================
+*/
+static int Profile_Bucket(const int64_t duration)
+{
+	if (duration < 1 << PROFILE_BUCKET_SHIFT)
+	{
+		return 0;
+	}
+
+	int exponent = PROFILE_BUCKET_SHIFT;
+	while (duration >> (exponent + 1) && exponent < PROFILE_BUCKET_SHIFT + (PROFILE_BUCKETS - 2) / 4)
+	{
+		exponent++;
+	}
+
+	const int bucket = 1 + (exponent - PROFILE_BUCKET_SHIFT) * 4 + static_cast<int>(duration >> (exponent - 2) & 3);
+	return std::min(bucket, PROFILE_BUCKETS - 1);
+}
+
+/*
+==================
+Profile_BucketValue
+
+The middle of a bucket, in nanoseconds
+==================
+*/
+static int64_t Profile_BucketValue(const int bucket)
+{
+	if (!bucket)
+	{
+		return 1 << (PROFILE_BUCKET_SHIFT - 1);
+	}
+
+	const int exponent = PROFILE_BUCKET_SHIFT + (bucket - 1) / 4;
+	const int64_t width = static_cast<int64_t>(1) << (exponent - 2);
+	return (4 + (bucket - 1) % 4) * width + width / 2;
+}
+
+/*
+==================
+Profile_ResetStats
+
+Run by the thread owning the ring
+==================
+*/
+static void Profile_ResetStats(profileRing_t* ring)
+{
+	for (int i = 0; i < MAX_PROFILE_ZONES; i++)
+	{
+		profileZoneStats_t& zone = ring->zones[i];
+		zone.calls.store(0, std::memory_order_relaxed);
+		zone.total.store(0, std::memory_order_relaxed);
+		zone.max.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint32_t>& bucket : zone.buckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+	ring->statsStart.store(INT64_MAX, std::memory_order_relaxed);
+	ring->statsEnd.store(0, std::memory_order_relaxed);
+}
+
+/*
+==================
+Profile_AddStats
+
+Single writer, so plain loads and stores are enough.  profile_dump may read
+a zone halfway through an update and be off by the one call.
+==================
+*/
+static void Profile_AddStats(profileRing_t* ring, const int zoneNum, const int64_t start, const int64_t end)
+{
+	const int generation = profileStatsGeneration.load(std::memory_order_acquire);
+	if (ring->statsGeneration.load(std::memory_order_relaxed) != generation)
+	{
+		Profile_ResetStats(ring);
+		ring->statsGeneration.store(generation, std::memory_order_release);
+	}
+
+	profileZoneStats_t& zone = ring->zones[zoneNum];
+	const int64_t duration = end - start;
+	std::atomic<uint32_t>& bucket = zone.buckets[Profile_Bucket(duration)];
+
+	zone.calls.store(zone.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	zone.total.store(zone.total.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+	if (duration > zone.max.load(std::memory_order_relaxed))
+	{
+		zone.max.store(duration, std::memory_order_relaxed);
+	}
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	if (start < ring->statsStart.load(std::memory_order_relaxed))
+	{
+		ring->statsStart.store(start, std::memory_order_relaxed);
+	}
+	if (end > ring->statsEnd.load(std::memory_order_relaxed))
+	{
+		ring->statsEnd.store(end, std::memory_order_relaxed);
+	}
+}
+
+/*
+==================
+Com_ProfileRecord
+
+Called by profileScope_c when a zone it opened closes
+==================
+*/
+void Com_ProfileRecord(const int zone, const int64_t start)
+{
+	const int64_t end = Com_ProfileTime();
+
+	if (zone < 0)
+	{
+		return;
+	}
+
+	profileRing_t* ring = Profile_ThreadRing();
+	if (!ring)
+	{
+		return;
+	}
+
+	const uint64_t head = ring->head.load(std::memory_order_relaxed);
+	profileEvent_t& event = ring->events[head & (ring->size - 1)];
+	event.start = start;
+	event.end = end;
+	event.zone = zone;
+	ring->head.store(head + 1, std::memory_order_release);
+
+	Profile_AddStats(ring, zone, start, end);
+}
+
+/*
+==================
+Profile_CopyRing
+
+Copies out the events a ring still holds, oldest first.  The owning thread
+may keep recording while this runs, whatever it overwrote in the meantime
+is dropped.
+==================
+*/
+static void Profile_CopyRing(const profileRing_t* ring, std::vector<profileEvent_t>& events)
+{
+	const uint64_t head = ring->head.load(std::memory_order_acquire);
+	const uint64_t first = std::max(head > ring->size ? head - ring->size : 0, ring->cleared.load(std::memory_order_relaxed));
+
+	events.clear();
+	for (uint64_t i = first; i < head; i++)
+	{
+		events.push_back(ring->events[i & (ring->size - 1)]);
+	}
+
+	const uint64_t after = ring->head.load(std::memory_order_acquire);
+	if (after > ring->size && after - ring->size > first)
+	{
+		const uint64_t overwritten = std::min<uint64_t>(after - ring->size - first, events.size());
+		events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(overwritten));
+	}
+}
+
+using profileStats_t = struct profileStats_s
+{
+	int zone;
+	uint32_t calls;
+	int64_t total;
+	int64_t max;
+	uint32_t buckets[PROFILE_BUCKETS];
+};
+
+/*
+==================
+Profile_Percentile
+
+Nearest rank over the histogram, in microseconds
+==================
+*/
+static double Profile_Percentile(const profileStats_t& zone, const int percent)
+{
+	uint64_t rank = (static_cast<uint64_t>(zone.calls) * percent + 99) / 100;
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+
+	uint64_t seen = 0;
+	for (int i = 0; i < PROFILE_BUCKETS; i++)
+	{
+		seen += zone.buckets[i];
+		if (seen >= rank)
+		{
+			return std::min(Profile_BucketValue(i), zone.max) / 1000.0;
+		}
+	}
+	return zone.max / 1000.0;
+}
+
+/*
+==================
+Profile_GatherStats
+
+Sums the zone statistics of every thread, returns the time they span
+==================
+*/
+static int64_t Profile_GatherStats(std::vector<profileStats_t>& stats, const int numRings)
+{
+	const int generation = profileStatsGeneration.load(std::memory_order_acquire);
+	int64_t windowStart = INT64_MAX;
+	int64_t windowEnd = 0;
+
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		Com_Memset(&stats[i], 0, sizeof stats[i]);
+		stats[i].zone = static_cast<int>(i);
+	}
+
+	for (int i = 0; i < numRings; i++)
+	{
+		const profileRing_t* ring = profileRings[i];
+
+		// nothing recorded on this thread since the last profile_clear
+		if (ring->statsGeneration.load(std::memory_order_acquire) != generation)
+		{
+			continue;
+		}
+
+		for (profileStats_t& zone : stats)
+		{
+			const profileZoneStats_t& recorded = ring->zones[zone.zone];
+			zone.calls += recorded.calls.load(std::memory_order_relaxed);
+			zone.total += recorded.total.load(std::memory_order_relaxed);
+			zone.max = std::max(zone.max, recorded.max.load(std::memory_order_relaxed));
+			for (int j = 0; j < PROFILE_BUCKETS; j++)
+			{
+				zone.buckets[j] += recorded.buckets[j].load(std::memory_order_relaxed);
+			}
+		}
+		windowStart = std::min(windowStart, ring->statsStart.load(std::memory_order_relaxed));
+		windowEnd = std::max(windowEnd, ring->statsEnd.load(std::memory_order_relaxed));
+	}
+
+	return windowEnd > windowStart ? windowEnd - windowStart : 0;
+}
+
+/*
+==================
+Profile_PrintSummary
+==================
+*/
+static void Profile_PrintSummary(std::vector<profileStats_t>& stats, const int64_t window)
+{
+	std::sort(stats.begin(), stats.end(), [](const profileStats_t& a, const profileStats_t& b) { return a.total > b.total; });
+
+	Com_Printf("%-28s %8s %9s %6s %9s %9s %9s %9s\n", "zone", "calls", "total ms", "%", "p50 us", "p95 us", "p99 us", "max us");
+	for (const profileStats_t& zone : stats)
+	{
+		if (!zone.calls)
+		{
+			continue;
+		}
+
+		Com_Printf("%-28s %8u %9.2f %6.2f %9.1f %9.1f %9.1f %9.1f\n",
+			profileZoneNames[zone.zone],
+			zone.calls,
+			zone.total / 1000000.0,
+			window > 0 ? 100.0 * zone.total / window : 0.0,
+			Profile_Percentile(zone, 50),
+			Profile_Percentile(zone, 95),
+			Profile_Percentile(zone, 99),
+			zone.max / 1000.0);
+	}
+	Com_Printf("over %.1f ms since profile_clear (%% is of that span, zones on other threads and nested zones overlap;"
+		" percentiles are read off histogram buckets, good to an eighth)\n", window / 1000000.0);
+}
+
+/*
+==================
+Profile_FlushTrace
+==================
+*/
+static void Profile_FlushTrace(std::string& out, const fileHandle_t f, const bool force)
+{
+	if (force || out.size() >= 0x10000)
+	{
+		FS_Write(out.data(), static_cast<int>(out.size()), f);
+		out.clear();
+	}
+}
+
+/*
+==================
+Profile_Dump_f
+
+profile_dump [file] : write a Chrome trace of the recorded zones and print
+their timings
+==================
+*/
+static void Profile_Dump_f(void)
+{
+	char filename[MAX_QPATH];
+
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("usage: profile_dump [file]\n");
+		return;
+	}
+
+	Q_strncpyz(filename, Cmd_Argc() == 2 ? Cmd_Argv(1) : "profile", sizeof filename);
+	COM_DefaultExtension(filename, sizeof filename, ".json");
+
+	const int numRings = profileNumRings.load(std::memory_order_acquire);
+	const int numZones = profileNumZones.load(std::memory_order_acquire);
+	if (!numRings)
+	{
+		Com_Printf("Nothing recorded, set com_profile 1 first.\n");
+		return;
+	}
+
+	const fileHandle_t f = FS_FOpenFileWrite(filename);
+	if (!f)
+	{
+		Com_Printf("Couldn't write %s.\n", filename);
+		return;
+	}
+
+	std::vector<profileEvent_t> events;
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	int numEvents = 0;
+
+	for (int i = 0; i < numRings; i++)
+	{
+		const profileRing_t* ring = profileRings[i];
+		char threadName[32];
+
+		if (ring->mainThread)
+		{
+			Q_strncpyz(threadName, "main", sizeof threadName);
+		}
+		else
+		{
+			Com_sprintf(threadName, sizeof threadName, "thread %i", ring->threadNum);
+		}
+		out += va("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}},\n",
+			ring->threadNum, threadName);
+
+		Profile_CopyRing(ring, events);
+		for (const profileEvent_t& event : events)
+		{
+			const int64_t duration = event.end - event.start;
+
+			if (event.zone >= numZones)
+			{
+				continue;
+			}
+
+			out += va("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f},\n",
+				profileZoneNames[event.zone], ring->threadNum, event.start / 1000.0, duration / 1000.0);
+			Profile_FlushTrace(out, f, false);
+			numEvents++;
+		}
+	}
+
+	// the thread_name records always leave a trailing comma to swallow
+	out.resize(out.size() - 2);
+	out += "\n]}\n";
+	Profile_FlushTrace(out, f, true);
+	FS_FCloseFile(f);
+
+	Com_Printf("Wrote %i events from %i threads to %s\n", numEvents, numRings, filename);
+
+	std::vector<profileStats_t> stats(numZones);
+	const int64_t window = Profile_GatherStats(stats, numRings);
+	if (std::any_of(stats.begin(), stats.end(), [](const profileStats_t& zone) { return zone.calls != 0; }))
+	{
+		Profile_PrintSummary(stats, window);
+	}
+}
+
+/*
+==================
+Profile_Clear_f
+
+Drops everything recorded so far.  Only the owning thread writes head and
+the zone statistics, so this just moves the point profile_dump reads from and
+tells each thread to zero its statistics the next time it records.
+==================
+*/
+static void Profile_Clear_f(void)
+{
+	const int numRings = profileNumRings.load(std::memory_order_acquire);
+
+	profileStatsGeneration.fetch_add(1, std::memory_order_release);
+
+	for (int i = 0; i < numRings; i++)
+	{
+		profileRings[i]->cleared.store(profileRings[i]->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
+
+/*
+==================
+Com_InitProfile
+==================
+*/
+void Com_InitProfile(void)
+{
+	com_profile = Cvar_Get("com_profile", "0", 0, "Record profiler zones for profile_dump");
+	com_profileEvents = Cvar_Get("com_profileEvents", "65536", CVAR_ARCHIVE_ND | CVAR_LATCH,
+		"Profiler events kept per thread, older ones are overwritten");
+
+	profileMainThread = std::this_thread::get_id();
+
+	Cmd_AddCommand("profile_dump", Profile_Dump_f, "Write recorded profiler zones as a Chrome trace and print their timings");
+	Cmd_AddCommand("profile_clear", Profile_Clear_f, "Drop recorded profiler zones");
+}
+
+/*
+==================
+Com_ProfileFrame
+
+Picks up com_profile changes, called between frames so no zone is open on
+another thread.
+==================
+*/
+void Com_ProfileFrame(void)
+{
+	com_profiling = com_profile && com_profile->integer;
+}
+
+/*
+==================
+Com_ShutdownProfile
+==================
+*/
+void Com_ShutdownProfile(void)
+{
+	com_profiling = false;
+
+	Cmd_RemoveCommand("profile_dump");
+	Cmd_RemoveCommand("profile_clear");
+
+	// rings are left alone, threads that outlive this may still hold theirs
+}
@@ -28,6 +28,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/q_shared.h"
 #include "sys/sys_public.h"
+#include "qcommon/qfiles.h"
 
 //============================================================================
 
@@ -57,6 +58,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits(msg_t* msg, int value, int bits);
+void MSG_WriteEncodedBits(msg_t* msg, const byte* data, int numBits);
 
 void MSG_WriteChar(msg_t* sb, int c);
 void MSG_WriteByte(msg_t* sb, int c);
@@ -639,6 +641,7 @@ int FS_FileIsInPAK(const char* filename, int* pChecksum);
 qboolean FS_FindPureDLL(const char* name);
 
 int FS_Write(const void* buffer, int len, fileHandle_t h);
+int FS_WriteQuiet(const void* buffer, int len, fileHandle_t h);
 
 int FS_Read(void* buffer, int len, fileHandle_t f);
 // properly handles partial reads and reads from other dlls
@@ -721,6 +724,13 @@ void FS_Rename(const char* from, const char* to);
 
 qboolean FS_WriteToTemporaryFile(const void* data, size_t dataLength, char** temp_file_path);
 
+void FS_PreloadFile(const char* qpath);
+void FS_StartPreload(void);
+void FS_FinishPreload(qboolean report);
+// decodes the files queued with FS_PreloadFile from their mapped paks on the
+// job threads, FS_ReadFile and FS_Read pick the results up; FS_FinishPreload
+// waits for the workers and frees what wasn't used
+
 /*
 ==============================================================
 
@@ -745,6 +755,8 @@ void Field_Clear(field_t* edit);
 void Field_AutoComplete(field_t* field);
 void Field_CompleteKeyname();
 void Field_CompleteFilename(const char* dir, const char* ext, qboolean stripExt, qboolean allowNonPureFilesOnDisk);
+void Field_CompleteFilenames(const char* dir, const char* const* exts, int numExts, qboolean stripExt,
+	qboolean allowNonPureFilesOnDisk);
 void Field_CompleteCommand(char* cmd, qboolean doCommands, qboolean doCvars);
 
 /*
@@ -895,6 +907,86 @@ int Hunk_MemoryRemaining(void);
 
 void Com_TouchMemory(void);
 
+// worker thread pool, see jobs.cpp
+using jobFunc_t = void (*)(int index, void* data);
+
+extern cvar_t* com_jobThreads;
+
+void Com_InitJobs(void);
+void Com_ShutdownJobs(void);
+int Com_NumJobWorkers(void);
+void Com_ParallelFor(int count, jobFunc_t func, void* data);
+void Com_StartJobs(int count, jobFunc_t func, void* data);
+void Com_FinishJobs(void);
+bool Com_InJob(void);
+void NORETURN Com_JobError(int code, const char* message);
+
+// compressed demo archives, see demoarchive.cpp and qfiles.h
+using demoArchive_t = struct demoArchive_s
+{
+	fileHandle_t file;
+	demoKeyframe_t* keyframes;
+	int numKeyframes;
+	qboolean started; // a block was read since opening or seeking
+
+	byte* block; // inflated message stream
+	int blockSize;
+	int blockLength;
+	int blockPos;
+
+	byte* compressed;
+	int compressedSize;
+};
+
+int Demo_WriteArchiveHeader(fileHandle_t f, int keyframeMsec);
+int Demo_WriteArchiveBlock(fileHandle_t f, int type, const void* data, int length);
+int Demo_WriteArchiveIndex(fileHandle_t f, const demoKeyframe_t* keyframes, int numKeyframes, int indexOffset);
+qboolean Demo_OpenArchive(demoArchive_t* archive, fileHandle_t f, int fileLength);
+void Demo_CloseArchive(demoArchive_t* archive);
+qboolean Demo_SeekArchive(demoArchive_t* archive, int msec);
+int Demo_ReadArchive(demoArchive_t* archive, void* buffer, int length);
+
+// scoped zone profiler, see profile.cpp
+extern cvar_t* com_profile;
+extern bool com_profiling; // com_profile, only changes between frames
+
+void Com_InitProfile(void);
+void Com_ShutdownProfile(void);
+void Com_ProfileFrame(void);
+int Com_ProfileRegisterZone(const char* name);
+int64_t Com_ProfileTime(void);
+void Com_ProfileRecord(int zone, int64_t start);
+
+class profileScope_c
+{
+	int zone;
+	int64_t start;
+
+public:
+	explicit profileScope_c(const int zone) : zone(com_profiling ? zone : -1), start(com_profiling ? Com_ProfileTime() : 0)
+	{
+	}
+
+	~profileScope_c()
+	{
+		if (zone >= 0)
+		{
+			Com_ProfileRecord(zone, start);
+		}
+	}
+
+	profileScope_c(const profileScope_c&) = delete;
+	profileScope_c& operator=(const profileScope_c&) = delete;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+// times the rest of the enclosing block as zone "name" while com_profile is set
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profileZone, __LINE__) = Com_ProfileRegisterZone(name); \
+	const profileScope_c PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+
 // commandLine should not include the executable name (argv[0])
 void Com_Init(char* commandLine);
 void Com_Frame(void);
@@ -1024,6 +1116,17 @@ using huffman_t = struct huffman_s
 	huff_t decompressor;
 };
 
+#define HUFF_LOOKUP_BITS	11
+#define HUFF_MAX_CODE_BITS	32
+
+// flat tables for a tree that doesn't change any more
+using huffCodes_t = struct huffCodes_s
+{
+	unsigned code[HMAX + 1]; // first bit to send in bit 0
+	byte length[HMAX + 1]; // 0 if the symbol has to go through the tree
+	unsigned short lookup[1 << HUFF_LOOKUP_BITS]; // symbol | length << 9 for the next input bits, 0 for longer codes
+};
+
 void Huff_Compress(msg_t* mbuf, int offset);
 void Huff_Decompress(msg_t* mbuf, int offset);
 void Huff_Init(huffman_t* huff);
@@ -1034,6 +1137,10 @@ void Huff_offsetReceive(node_t* node, int* ch, byte* fin, int* offset, int maxof
 void Huff_offsetTransmit(const huff_t* huff, int ch, byte* fout, int* offset, int maxoffset);
 void Huff_putBit(int bit, byte* fout, int* offset);
 int Huff_getBit(const byte* fin, int* offset);
+void Huff_BuildCodes(const huff_t* huff, huffCodes_t* codes);
+void Huff_putBits(uint64_t bits, int count, byte* fout, int* offset);
+unsigned Huff_peekBits(const byte* fin, int offset, int count, int maxoffset);
+int Huff_lookupReceive(const huffCodes_t* codes, node_t* tree, byte* fin, int* offset, int maxoffset);
 
 extern huffman_t clientHuffTables;
 
@@ -1054,3 +1161,4 @@ const void* PD_Load(const char* name, size_t* size);
 uint32_t ConvertUTF8ToUTF32(char* utf8CurrentChar, char** utf8NextChar);
 
 #include "sys/sys_public.h"
+#include "qcommon/qfiles.h"
@@ -534,3 +534,54 @@ typedef struct dfontdat_s
 } dfontdat_t;
 
 /////////////////// fonts end ////////////////////////////////////
+
+/*
+========================================================================
+
+.dmz server demo archive
+
+The message stream is the one a .dm demo holds, {int sequence, int length,
+byte data[length]} records ending with -1 -1, cut into zlib compressed
+blocks that never split a record.  A keyframe is a GAMESTATE block holding a
+gamestate record as of that moment, and the MESSAGES block after it starts
+with a non-delta snapshot, so playback can begin at any keyframe.  Playing
+from the start skips every GAMESTATE block but the first.
+
+The keyframe index trails the blocks and is found through the fixed size
+footer that ends the file.  An archive without one (the server died while
+recording) still plays from the start.  All values are little endian.
+
+========================================================================
+*/
+
+#define DEMO_ARCHIVE_IDENT		(('Z'<<24)+('M'<<16)+('D'<<8)+'J')
+#define DEMO_ARCHIVE_VERSION	1
+#define DEMO_INDEX_IDENT		(('X'<<24)+('D'<<16)+('N'<<8)+'I')
+
+#define DEMO_BLOCK_MESSAGES		1
+#define DEMO_BLOCK_GAMESTATE	2
+
+typedef struct demoArchiveHeader_s {
+	int			ident;
+	int			version;
+	int			protocol;				// PROTOCOL_VERSION of the messages
+	int			keyframeMsec;			// requested keyframe spacing
+} demoArchiveHeader_t;
+
+typedef struct demoArchiveBlock_s {
+	int			type;
+	int			rawLength;
+	int			compressedLength;		// zlib stream that follows
+} demoArchiveBlock_t;
+
+typedef struct demoKeyframe_s {
+	int			serverTime;				// of the snapshot after the gamestate
+	int			sequence;				// message sequence of that snapshot
+	int			offset;					// of the GAMESTATE block
+} demoKeyframe_t;
+
+typedef struct demoArchiveFooter_s {
+	int			numKeyframes;
+	int			indexOffset;			// demoKeyframe_t[numKeyframes]
+	int			ident;
+} demoArchiveFooter_t;
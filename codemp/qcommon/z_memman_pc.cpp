@@ -43,6 +43,11 @@ extern int SND_FreeOldestSound();
 
 // This handles zone memory allocation.
 // It is a wrapper around malloc with a tag id and a magic number at the start
+//
+// Small blocks are carved out of size-class slabs, and small hunk and temp
+//	blocks out of an arena per tag, so a map load doesn't make a heap call per
+//	block. Everything else gets its own malloc. Every block keeps its header and
+//	tail and sits on its tag's list whichever way it was allocated.
 
 #define ZONE_MAGIC			0x21436587
 
@@ -51,10 +56,38 @@ using zoneHeader_t = struct zoneHeader_s
 	int iMagic;
 	memtag_t eTag;
 	int iSize;
+	int iChunkOffset; // bytes back to the owning zoneChunk_t, 0 if the block was malloc'd on its own
 	zoneHeader_s* pNext;
 	zoneHeader_s* pPrev;
 };
 
+#define ZONE_ALIGN				16
+#define ZONE_SLAB_CHUNK_SIZE	(64 * 1024)
+#define ZONE_ARENA_CHUNK_SIZE	(1024 * 1024)
+#define ZONE_ARENA_MAX_BLOCK	(ZONE_ARENA_CHUNK_SIZE / 16) // bigger hunk blocks are malloc'd on their own
+#define ZONE_ARENA_CLASS		-1
+
+// block sizes including the header and tail, multiples of ZONE_ALIGN
+static const int zoneSlabSizes[] = { 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 1024 };
+#define ZONE_NUM_SLAB_CLASSES	static_cast<int>(ARRAY_LEN(zoneSlabSizes))
+#define ZONE_SLAB_MAX_BLOCK		1024
+
+// a slab of one size class, or a bump arena for one tag
+using zoneChunk_t = struct zoneChunk_s
+{
+	int iClass; // index into zoneSlabSizes, or ZONE_ARENA_CLASS
+	memtag_t eTag; // arenas only
+	int iLive; // blocks handed out and not freed yet
+	int iUsed; // bytes carved off so far, counting from the start of the chunk
+	int iSize;
+	bool bListed; // slabs only, on their class's list of slabs with room
+	zoneChunk_s* pNext;
+	zoneChunk_s* pPrev;
+	void* pFreeSlots; // slabs only, freed blocks chained through their first bytes
+};
+
+#define ZONE_CHUNK_HEADER		static_cast<int>((sizeof(zoneChunk_t) + ZONE_ALIGN - 1) & ~(ZONE_ALIGN - 1))
+
 using zoneTail_t = struct
 {
 	int iMagic;
@@ -80,12 +113,17 @@ using zoneStats_t = struct zoneStats_s
 	//
 	int i_sizesPerTag[TAG_COUNT];
 	int iCountsPerTag[TAG_COUNT];
+
+	int iChunks; // slabs and arenas currently held
+	int iChunkBytes;
 };
 
 using zone_t = struct zone_s
 {
 	zoneStats_t Stats;
-	zoneHeader_t Header;
+	zoneHeader_t Headers[TAG_COUNT]; // list heads, one per tag so Z_TagFree only walks its own blocks
+	zoneChunk_t* pSlabs[ZONE_NUM_SLAB_CLASSES]; // slabs with room, per size class
+	zoneChunk_t* pArenas[TAG_COUNT]; // the arena each hunk tag is currently filling
 };
 
 cvar_t* com_validateZone;
@@ -101,30 +139,30 @@ void Z_Validate(void)
 		return;
 	}
 
-	zoneHeader_t* pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	for (int i = 0; i < TAG_COUNT; i++)
 	{
-#ifdef DETAILED_ZONE_DEBUG_CODE
-		// this won't happen here, but wtf?
-		int& iAllocCount = mapAllocatedZones[pMemory];
-		if (iAllocCount <= 0)
+		for (zoneHeader_t* pMemory = TheZone.Headers[i].pNext; pMemory; pMemory = pMemory->pNext)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
-			return;
-		}
+#ifdef DETAILED_ZONE_DEBUG_CODE
+			// this won't happen here, but wtf?
+			int& iAllocCount = mapAllocatedZones[pMemory];
+			if (iAllocCount <= 0)
+			{
+				Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
+				return;
+			}
 #endif
 
-		if (pMemory->iMagic != ZONE_MAGIC)
-		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
-		}
+			if (pMemory->iMagic != ZONE_MAGIC)
+			{
+				Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
+			}
 
-		if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
-		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
+			if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+			{
+				Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
+			}
 		}
-
-		pMemory = pMemory->pNext;
 	}
 }
 
@@ -148,41 +186,30 @@ using StaticMem_t = struct StaticMem_s
 #pragma pack(pop)
 
 StaticZeroMem_t gZeroMalloc =
-{ {ZONE_MAGIC, TAG_STATIC, 0, nullptr, nullptr}, {ZONE_MAGIC} };
+{ {ZONE_MAGIC, TAG_STATIC, 0, 0, nullptr, nullptr}, {ZONE_MAGIC} };
 StaticMem_t gEmptyString =
-{ {ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'\0', '\0'}, {ZONE_MAGIC} };
+{ {ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'\0', '\0'}, {ZONE_MAGIC} };
 StaticMem_t gNumberString[] = {
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'0', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'1', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'2', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'3', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'4', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'5', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'6', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'7', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'8', '\0'}, {ZONE_MAGIC}},
-	{{ZONE_MAGIC, TAG_STATIC, 2, nullptr, nullptr}, {'9', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'0', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'1', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'2', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'3', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'4', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'5', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'6', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'7', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'8', '\0'}, {ZONE_MAGIC}},
+	{{ZONE_MAGIC, TAG_STATIC, 2, 0, nullptr, nullptr}, {'9', '\0'}, {ZONE_MAGIC}},
 };
 
 qboolean gbMemFreeupOccured = qfalse;
 
-void* Z_Malloc(const int iSize, const memtag_t eTag, const qboolean bZeroit, const int iUnusedAlign)
+// gets memory from the system, dumping caches until it can. iSize and eTag are
+//	only for the out of memory report...
+//
+static void* Zone_SystemAlloc(const int iRealSize, const qboolean bZeroit, const int iSize, const memtag_t eTag)
 {
-	gbMemFreeupOccured = qfalse;
-
-	if (iSize == 0)
-	{
-		auto pMemory = reinterpret_cast<zoneHeader_t*>(&gZeroMalloc);
-		return &pMemory[1];
-	}
-
-	// Add in tracking info
-	//
-	const int iRealSize = iSize + sizeof(zoneHeader_t) + sizeof(zoneTail_t);
-
-	// Allocate a chunk...
-	//
-	zoneHeader_t* pMemory = nullptr;
+	void* pMemory = nullptr;
 	while (pMemory == nullptr)
 	{
 		if (gbMemFreeupOccured)
@@ -192,11 +219,11 @@ void* Z_Malloc(const int iSize, const memtag_t eTag, const qboolean bZeroit, con
 
 		if (bZeroit)
 		{
-			pMemory = static_cast<zoneHeader_t*>(calloc(iRealSize, 1));
+			pMemory = calloc(iRealSize, 1);
 		}
 		else
 		{
-			pMemory = static_cast<zoneHeader_t*>(malloc(iRealSize));
+			pMemory = malloc(iRealSize);
 		}
 		if (!pMemory)
 		{
@@ -278,17 +305,275 @@ void* Z_Malloc(const int iSize, const memtag_t eTag, const qboolean bZeroit, con
 		}
 	}
 
-	// Link in
-	pMemory->iMagic = ZONE_MAGIC;
-	pMemory->eTag = eTag;
-	pMemory->iSize = iSize;
-	pMemory->pNext = TheZone.Header.pNext;
-	TheZone.Header.pNext = pMemory;
+	return pMemory;
+}
+
+static zoneChunk_t* Zone_NewChunk(const int iChunkSize, const int iClass, const memtag_t eTag)
+{
+	const auto pChunk = static_cast<zoneChunk_t*>(Zone_SystemAlloc(iChunkSize, qfalse, iChunkSize, eTag));
+
+	pChunk->iClass = iClass;
+	pChunk->eTag = eTag;
+	pChunk->iLive = 0;
+	pChunk->iUsed = ZONE_CHUNK_HEADER;
+	pChunk->iSize = iChunkSize;
+	pChunk->bListed = false;
+	pChunk->pNext = nullptr;
+	pChunk->pPrev = nullptr;
+	pChunk->pFreeSlots = nullptr;
+
+	TheZone.Stats.iChunks++;
+	TheZone.Stats.iChunkBytes += iChunkSize;
+
+	return pChunk;
+}
+
+static void Zone_FreeChunk(zoneChunk_t* pChunk)
+{
+	TheZone.Stats.iChunks--;
+	TheZone.Stats.iChunkBytes -= pChunk->iSize;
+
+	free(pChunk);
+}
+
+static void Zone_LinkSlab(zoneChunk_t* pChunk)
+{
+	zoneChunk_t*& pHead = TheZone.pSlabs[pChunk->iClass];
+
+	pChunk->pPrev = nullptr;
+	pChunk->pNext = pHead;
+	if (pHead)
+	{
+		pHead->pPrev = pChunk;
+	}
+	pHead = pChunk;
+	pChunk->bListed = true;
+}
+
+static void Zone_UnlinkSlab(zoneChunk_t* pChunk)
+{
+	if (pChunk->pPrev)
+	{
+		pChunk->pPrev->pNext = pChunk->pNext;
+	}
+	else
+	{
+		TheZone.pSlabs[pChunk->iClass] = pChunk->pNext;
+	}
+	if (pChunk->pNext)
+	{
+		pChunk->pNext->pPrev = pChunk->pPrev;
+	}
+	pChunk->pNext = pChunk->pPrev = nullptr;
+	pChunk->bListed = false;
+}
+
+static zoneHeader_t* Zone_SlabAlloc(const int iRealSize, const memtag_t eTag)
+{
+	int iClass = 0;
+	while (zoneSlabSizes[iClass] < iRealSize)
+	{
+		iClass++;
+	}
+	const int iBlockSize = zoneSlabSizes[iClass];
+
+	zoneChunk_t* pChunk = TheZone.pSlabs[iClass];
+	if (!pChunk)
+	{
+		pChunk = Zone_NewChunk(ZONE_SLAB_CHUNK_SIZE, iClass, eTag);
+		Zone_LinkSlab(pChunk);
+	}
+
+	byte* pBlock;
+	if (pChunk->pFreeSlots)
+	{
+		pBlock = static_cast<byte*>(pChunk->pFreeSlots);
+		pChunk->pFreeSlots = *reinterpret_cast<void**>(pBlock);
+	}
+	else
+	{
+		pBlock = reinterpret_cast<byte*>(pChunk) + pChunk->iUsed;
+		pChunk->iUsed += iBlockSize;
+	}
+	pChunk->iLive++;
+
+	// full slabs come off the list until something in them is freed
+	if (!pChunk->pFreeSlots && pChunk->iUsed + iBlockSize > pChunk->iSize)
+	{
+		Zone_UnlinkSlab(pChunk);
+	}
+
+	const auto pMemory = reinterpret_cast<zoneHeader_t*>(pBlock);
+	pMemory->iChunkOffset = static_cast<int>(pBlock - reinterpret_cast<byte*>(pChunk));
+	return pMemory;
+}
+
+static zoneHeader_t* Zone_ArenaAlloc(const int iRealSize, const memtag_t eTag)
+{
+	const int iBlockSize = (iRealSize + ZONE_ALIGN - 1) & ~(ZONE_ALIGN - 1);
+
+	zoneChunk_t* pChunk = TheZone.pArenas[eTag];
+	if (!pChunk || pChunk->iUsed + iBlockSize > pChunk->iSize)
+	{
+		// a retired arena goes once its last block does
+		if (pChunk && !pChunk->iLive)
+		{
+			Zone_FreeChunk(pChunk);
+		}
+		pChunk = Zone_NewChunk(ZONE_ARENA_CHUNK_SIZE, ZONE_ARENA_CLASS, eTag);
+		TheZone.pArenas[eTag] = pChunk;
+	}
+
+	byte* pBlock = reinterpret_cast<byte*>(pChunk) + pChunk->iUsed;
+	pChunk->iUsed += iBlockSize;
+	pChunk->iLive++;
+
+	const auto pMemory = reinterpret_cast<zoneHeader_t*>(pBlock);
+	pMemory->iChunkOffset = static_cast<int>(pBlock - reinterpret_cast<byte*>(pChunk));
+	return pMemory;
+}
+
+// hands a slab or arena block back to its chunk, releasing the chunk if that
+//	was the last block in it and it isn't the one kept around for reuse...
+//
+static void Zone_ChunkFree(zoneHeader_t* pMemory)
+{
+	const auto pChunk = reinterpret_cast<zoneChunk_t*>(reinterpret_cast<byte*>(pMemory) - pMemory->iChunkOffset);
+
+	pChunk->iLive--;
+
+	if (pChunk->iClass == ZONE_ARENA_CLASS)
+	{
+		if (!pChunk->iLive)
+		{
+			if (TheZone.pArenas[pChunk->eTag] == pChunk)
+			{
+				pChunk->iUsed = ZONE_CHUNK_HEADER;
+			}
+			else
+			{
+				Zone_FreeChunk(pChunk);
+			}
+		}
+		return;
+	}
+
+	*reinterpret_cast<void**>(pMemory) = pChunk->pFreeSlots;
+	pChunk->pFreeSlots = pMemory;
+
+	if (!pChunk->bListed)
+	{
+		Zone_LinkSlab(pChunk);
+	}
+	else if (!pChunk->iLive && (pChunk->pPrev || pChunk->pNext))
+	{
+		// keep one slab per class, release the other empty ones
+		Zone_UnlinkSlab(pChunk);
+		Zone_FreeChunk(pChunk);
+	}
+}
+
+// releases the empty slabs and arenas kept around for reuse
+//
+static void Zone_FreeIdleChunks(void)
+{
+	for (int i = 0; i < ZONE_NUM_SLAB_CLASSES; i++)
+	{
+		zoneChunk_t* pChunk = TheZone.pSlabs[i];
+		while (pChunk)
+		{
+			zoneChunk_t* pNext = pChunk->pNext;
+			if (!pChunk->iLive)
+			{
+				Zone_UnlinkSlab(pChunk);
+				Zone_FreeChunk(pChunk);
+			}
+			pChunk = pNext;
+		}
+	}
+
+	for (auto& pArena : TheZone.pArenas)
+	{
+		if (pArena && !pArena->iLive)
+		{
+			Zone_FreeChunk(pArena);
+			pArena = nullptr;
+		}
+	}
+}
+
+static bool Zone_TagUsesArena(const memtag_t eTag)
+{
+	return eTag == TAG_HUNK_MARK1 || eTag == TAG_HUNK_MARK2 || eTag == TAG_TEMP_HUNKALLOC;
+}
+
+static void Zone_LinkBlock(zoneHeader_t* pMemory)
+{
+	zoneHeader_t* pHead = &TheZone.Headers[pMemory->eTag];
+
+	pMemory->pNext = pHead->pNext;
+	pHead->pNext = pMemory;
 	if (pMemory->pNext)
 	{
 		pMemory->pNext->pPrev = pMemory;
 	}
-	pMemory->pPrev = &TheZone.Header;
+	pMemory->pPrev = pHead;
+}
+
+static void Zone_UnlinkBlock(const zoneHeader_t* pMemory)
+{
+	// Sanity checks...
+	//
+	assert(pMemory->pPrev->pNext == pMemory);
+	assert(!pMemory->pNext || pMemory->pNext->pPrev == pMemory);
+
+	pMemory->pPrev->pNext = pMemory->pNext;
+	if (pMemory->pNext)
+	{
+		pMemory->pNext->pPrev = pMemory->pPrev;
+	}
+}
+
+void* Z_Malloc(const int iSize, const memtag_t eTag, const qboolean bZeroit, const int iUnusedAlign)
+{
+	gbMemFreeupOccured = qfalse;
+
+	if (iSize == 0)
+	{
+		auto pMemory = reinterpret_cast<zoneHeader_t*>(&gZeroMalloc);
+		return &pMemory[1];
+	}
+
+	// Add in tracking info
+	//
+	const int iRealSize = iSize + sizeof(zoneHeader_t) + sizeof(zoneTail_t);
+
+	// Allocate a chunk...
+	//
+	zoneHeader_t* pMemory;
+	if (Zone_TagUsesArena(eTag) && iRealSize <= ZONE_ARENA_MAX_BLOCK)
+	{
+		pMemory = Zone_ArenaAlloc(iRealSize, eTag);
+	}
+	else if (iRealSize <= ZONE_SLAB_MAX_BLOCK)
+	{
+		pMemory = Zone_SlabAlloc(iRealSize, eTag);
+	}
+	else
+	{
+		pMemory = static_cast<zoneHeader_t*>(Zone_SystemAlloc(iRealSize, bZeroit, iSize, eTag));
+		pMemory->iChunkOffset = 0;
+	}
+	if (bZeroit && pMemory->iChunkOffset)
+	{
+		memset(&pMemory[1], 0, iSize);
+	}
+
+	// Link in
+	pMemory->iMagic = ZONE_MAGIC;
+	pMemory->eTag = eTag;
+	pMemory->iSize = iSize;
+	Zone_LinkBlock(pMemory);
 	//
 	// add tail...
 	//
@@ -353,7 +638,9 @@ void Z_MorphMallocTag(void* pv_address, const memtag_t eDesiredTag)
 
 	// morph...
 	//
+	Zone_UnlinkBlock(pMemory);
 	pMemory->eTag = eDesiredTag;
+	Zone_LinkBlock(pMemory);
 
 	// INC new tag stats...
 	//
@@ -374,19 +661,17 @@ static void Zone_FreeBlock(zoneHeader_t* pMemory)
 		TheZone.Stats.i_sizesPerTag[pMemory->eTag] -= pMemory->iSize;
 		TheZone.Stats.iCountsPerTag[pMemory->eTag]--;
 
-		// Sanity checks...
-		//
-		assert(pMemory->pPrev->pNext == pMemory);
-		assert(!pMemory->pNext || pMemory->pNext->pPrev == pMemory);
-
 		// Unlink and free...
 		//
-		pMemory->pPrev->pNext = pMemory->pNext;
-		if (pMemory->pNext)
+		Zone_UnlinkBlock(pMemory);
+		if (pMemory->iChunkOffset)
+		{
+			Zone_ChunkFree(pMemory);
+		}
+		else
 		{
-			pMemory->pNext->pPrev = pMemory->pPrev;
+			free(pMemory);
 		}
-		free(pMemory);
 
 #ifdef DETAILED_ZONE_DEBUG_CODE
 		// this has already been checked for in execution order, but wtf?
@@ -474,15 +759,20 @@ void Z_TagFree(const memtag_t eTag)
 	//	int iZoneBlocks = TheZone.Stats.iCount;
 	//#endif
 
-	zoneHeader_t* pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	for (int i = 0; i < TAG_COUNT; i++)
 	{
-		zoneHeader_t* pNext = pMemory->pNext;
-		if (eTag == TAG_ALL || pMemory->eTag == eTag)
+		if (eTag != TAG_ALL && i != static_cast<int>(eTag))
+		{
+			continue;
+		}
+
+		zoneHeader_t* pMemory = TheZone.Headers[i].pNext;
+		while (pMemory)
 		{
+			zoneHeader_t* pNext = pMemory->pNext;
 			Zone_FreeBlock(pMemory);
+			pMemory = pNext;
 		}
-		pMemory = pNext;
 	}
 
 	// these stupid pragmas don't work here???!?!?!
@@ -534,6 +824,12 @@ static void Z_Stats_f(void)
 		TheZone.Stats.iPeak,
 		static_cast<float>(TheZone.Stats.iPeak) / 1024.0f / 1024.0f
 	);
+
+	Com_Printf("Slabs and arenas hold %d bytes (%.2fMB) in %d chunks\n",
+		TheZone.Stats.iChunkBytes,
+		static_cast<float>(TheZone.Stats.iChunkBytes) / 1024.0f / 1024.0f,
+		TheZone.Stats.iChunks
+	);
 }
 
 // Gives a detailed breakdown of the memory blocks in the zone
@@ -586,6 +882,8 @@ void Com_ShutdownZoneMemory(void)
 		assert(!TheZone.Stats.iCount);
 		assert(!TheZone.Stats.iCurrent);
 	}
+
+	Zone_FreeIdleChunks();
 }
 
 // Initialises the zone memory system
@@ -593,7 +891,10 @@ void Com_ShutdownZoneMemory(void)
 void Com_InitZoneMemory(void)
 {
 	memset(&TheZone, 0, sizeof TheZone);
-	TheZone.Header.iMagic = ZONE_MAGIC;
+	for (auto& header : TheZone.Headers)
+	{
+		header.iMagic = ZONE_MAGIC;
+	}
 }
 
 void Com_InitZoneMemoryVars(void)
@@ -651,17 +952,17 @@ void Com_TouchMemory(void)
 
 	int sum = 0;
 
-	zoneHeader_t* pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	for (const auto& header : TheZone.Headers)
 	{
-		const auto pMem = reinterpret_cast<byte*>(&pMemory[1]);
-		const int j = pMemory->iSize >> 2;
-		for (int i = 0; i < j; i += 64)
+		for (zoneHeader_t* pMemory = header.pNext; pMemory; pMemory = pMemory->pNext)
 		{
-			sum += reinterpret_cast<int*>(pMem)[i];
+			const auto pMem = reinterpret_cast<byte*>(&pMemory[1]);
+			const int j = pMemory->iSize >> 2;
+			for (int i = 0; i < j; i += 64)
+			{
+				sum += reinterpret_cast<int*>(pMem)[i];
+			}
 		}
-
-		pMemory = pMemory->pNext;
 	}
 
 	//	end = Sys_Milliseconds();
@@ -0,0 +1,324 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// tr_skinning.cpp
+//
+// The vector kernels turn the surface's bones into columns once, then pull
+// the packed weights out of a batch of verts slot by slot, so every vert of
+// the batch runs the same branch free loop over its bones.
+
+#include "tr_skinning.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SKIN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SKIN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SKIN_TARGET(x) __attribute__((target(x)))
+#else
+#define SKIN_TARGET(x)
+#endif
+
+#define SKIN_BATCH	4
+
+// slots past a vert's own weight count weigh nothing on bone 0
+using skinBatch_t = struct skinBatch_s
+{
+	int count;
+	int numWeights; // most weights of any vert in the batch
+	float weights[iMAX_G2_BONEWEIGHTS_PER_VERT][SKIN_BATCH];
+	int bones[iMAX_G2_BONEWEIGHTS_PER_VERT][SKIN_BATCH];
+};
+
+// a bone matrix on its side: x, y and z axis then origin, w unused
+using skinColumns_t = struct skinColumns_s
+{
+	alignas(16) float c[4][4];
+};
+
+// inlined so each kernel builds these with its own instruction set, the avx
+// one mustn't call out to sse code with the upper halves in use
+static inline void R_SkinColumns(const mdxmSurface_t* surface, const mdxaBone_t* const* bones, skinColumns_t* columns)
+{
+	const int numBones = surface->numBoneReferences < iMAX_G2_BONEREFS_PER_SURFACE ? surface->numBoneReferences : iMAX_G2_BONEREFS_PER_SURFACE;
+
+	for (int i = 0; i < numBones; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			columns[i].c[c][0] = bones[i]->matrix[0][c];
+			columns[i].c[c][1] = bones[i]->matrix[1][c];
+			columns[i].c[c][2] = bones[i]->matrix[2][c];
+			columns[i].c[c][3] = 0.0f;
+		}
+	}
+}
+
+static inline void R_DecodeSkinBatch(const mdxmVertex_t* v, const int count, skinBatch_t& batch)
+{
+	batch.count = count;
+	batch.numWeights = 1;
+
+	for (int lane = 0; lane < SKIN_BATCH; lane++)
+	{
+		const int iNumWeights = lane < count ? G2_GetVertWeights(&v[lane]) : 0;
+		float fTotalWeight = 0.0f;
+
+		for (int k = 0; k < iMAX_G2_BONEWEIGHTS_PER_VERT; k++)
+		{
+			if (k < iNumWeights)
+			{
+				batch.bones[k][lane] = G2_GetVertBoneIndex(&v[lane], k);
+				batch.weights[k][lane] = G2_GetVertBoneWeight(&v[lane], k, fTotalWeight, iNumWeights);
+			}
+			else
+			{
+				batch.bones[k][lane] = 0;
+				batch.weights[k][lane] = 0.0f;
+			}
+		}
+
+		if (iNumWeights > batch.numWeights)
+		{
+			batch.numWeights = iNumWeights;
+		}
+	}
+}
+
+static void R_SkinVertsScalar(const mdxmSurface_t* surface, const mdxaBone_t* const* bones, const vec3_t scale, float* out)
+{
+	const int numVerts = surface->numVerts;
+	auto v = reinterpret_cast<const mdxmVertex_t*>((const byte*)surface + surface->ofsVerts);
+	const auto pTexCoords = reinterpret_cast<const mdxmVertexTexCoord_t*>(&v[numVerts]);
+
+	for (int j = 0; j < numVerts; j++, v++, out += 5)
+	{
+		vec3_t tempVert;
+		const int iNumWeights = G2_GetVertWeights(v);
+		float fTotalWeight = 0.0f;
+
+		VectorClear(tempVert);
+		for (int k = 0; k < iNumWeights; k++)
+		{
+			const int iBoneIndex = G2_GetVertBoneIndex(v, k);
+			const float fBoneWeight = G2_GetVertBoneWeight(v, k, fTotalWeight, iNumWeights);
+			const mdxaBone_t& bone = *bones[iBoneIndex];
+
+			tempVert[0] += fBoneWeight * (DotProduct(bone.matrix[0], v->vertCoords) + bone.matrix[0][3]);
+			tempVert[1] += fBoneWeight * (DotProduct(bone.matrix[1], v->vertCoords) + bone.matrix[1][3]);
+			tempVert[2] += fBoneWeight * (DotProduct(bone.matrix[2], v->vertCoords) + bone.matrix[2][3]);
+		}
+
+		out[0] = tempVert[0] * scale[0];
+		out[1] = tempVert[1] * scale[1];
+		out[2] = tempVert[2] * scale[2];
+		// we will need the S & T coors too for hitlocation and hitmaterial stuff
+		out[3] = pTexCoords[j].texCoords[0];
+		out[4] = pTexCoords[j].texCoords[1];
+	}
+}
+
+#ifdef SKIN_X86
+
+SKIN_TARGET("sse2")
+static void R_SkinVertsSSE2(const mdxmSurface_t* surface, const mdxaBone_t* const* bones, const vec3_t scale, float* out)
+{
+	skinColumns_t columns[iMAX_G2_BONEREFS_PER_SURFACE];
+	skinBatch_t batch;
+	const int numVerts = surface->numVerts;
+	const auto v = reinterpret_cast<const mdxmVertex_t*>((const byte*)surface + surface->ofsVerts);
+	const auto pTexCoords = reinterpret_cast<const mdxmVertexTexCoord_t*>(&v[numVerts]);
+	const __m128 scaleV = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+
+	R_SkinColumns(surface, bones, columns);
+
+	for (int j = 0; j < numVerts; j += SKIN_BATCH)
+	{
+		R_DecodeSkinBatch(&v[j], numVerts - j < SKIN_BATCH ? numVerts - j : SKIN_BATCH, batch);
+
+		for (int lane = 0; lane < batch.count; lane++)
+		{
+			const float* xyz = v[j + lane].vertCoords;
+			const __m128 x = _mm_set1_ps(xyz[0]);
+			const __m128 y = _mm_set1_ps(xyz[1]);
+			const __m128 z = _mm_set1_ps(xyz[2]);
+			__m128 acc = _mm_setzero_ps();
+
+			for (int k = 0; k < batch.numWeights; k++)
+			{
+				const skinColumns_t& bone = columns[batch.bones[k][lane]];
+				__m128 p = _mm_add_ps(_mm_mul_ps(_mm_load_ps(bone.c[0]), x), _mm_load_ps(bone.c[3]));
+
+				p = _mm_add_ps(p, _mm_mul_ps(_mm_load_ps(bone.c[1]), y));
+				p = _mm_add_ps(p, _mm_mul_ps(_mm_load_ps(bone.c[2]), z));
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(batch.weights[k][lane]), p));
+			}
+
+			// the fourth float is garbage until the S goes over it
+			float* row = out + (j + lane) * 5;
+			_mm_storeu_ps(row, _mm_mul_ps(acc, scaleV));
+			row[3] = pTexCoords[j + lane].texCoords[0];
+			row[4] = pTexCoords[j + lane].texCoords[1];
+		}
+	}
+}
+
+SKIN_TARGET("avx2,fma")
+static inline __m256 R_SkinPair(const __m128 lo, const __m128 hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+// two verts at a time, one in each half
+SKIN_TARGET("avx2,fma")
+static void R_SkinVertsAVX2(const mdxmSurface_t* surface, const mdxaBone_t* const* bones, const vec3_t scale, float* out)
+{
+	skinColumns_t columns[iMAX_G2_BONEREFS_PER_SURFACE];
+	skinBatch_t batch;
+	const int numVerts = surface->numVerts;
+	const auto v = reinterpret_cast<const mdxmVertex_t*>((const byte*)surface + surface->ofsVerts);
+	const auto pTexCoords = reinterpret_cast<const mdxmVertexTexCoord_t*>(&v[numVerts]);
+	const __m256 scaleV = _mm256_setr_ps(scale[0], scale[1], scale[2], 0.0f, scale[0], scale[1], scale[2], 0.0f);
+
+	R_SkinColumns(surface, bones, columns);
+
+	for (int j = 0; j < numVerts; j += SKIN_BATCH)
+	{
+		R_DecodeSkinBatch(&v[j], numVerts - j < SKIN_BATCH ? numVerts - j : SKIN_BATCH, batch);
+
+		for (int lane = 0; lane < batch.count; lane += 2)
+		{
+			const int other = lane + 1 < batch.count ? lane + 1 : lane;
+			const float* a = v[j + lane].vertCoords;
+			const float* b = v[j + other].vertCoords;
+			const __m256 x = R_SkinPair(_mm_set1_ps(a[0]), _mm_set1_ps(b[0]));
+			const __m256 y = R_SkinPair(_mm_set1_ps(a[1]), _mm_set1_ps(b[1]));
+			const __m256 z = R_SkinPair(_mm_set1_ps(a[2]), _mm_set1_ps(b[2]));
+			__m256 acc = _mm256_setzero_ps();
+
+			for (int k = 0; k < batch.numWeights; k++)
+			{
+				const skinColumns_t& boneA = columns[batch.bones[k][lane]];
+				const skinColumns_t& boneB = columns[batch.bones[k][other]];
+				const __m256 w = R_SkinPair(_mm_set1_ps(batch.weights[k][lane]), _mm_set1_ps(batch.weights[k][other]));
+				__m256 p = _mm256_fmadd_ps(R_SkinPair(_mm_load_ps(boneA.c[0]), _mm_load_ps(boneB.c[0])), x,
+					R_SkinPair(_mm_load_ps(boneA.c[3]), _mm_load_ps(boneB.c[3])));
+
+				p = _mm256_fmadd_ps(R_SkinPair(_mm_load_ps(boneA.c[1]), _mm_load_ps(boneB.c[1])), y, p);
+				p = _mm256_fmadd_ps(R_SkinPair(_mm_load_ps(boneA.c[2]), _mm_load_ps(boneB.c[2])), z, p);
+				acc = _mm256_fmadd_ps(w, p, acc);
+			}
+
+			acc = _mm256_mul_ps(acc, scaleV);
+
+			// the fourth floats are garbage until the S goes over them
+			float* row = out + (j + lane) * 5;
+			_mm_storeu_ps(row, _mm256_castps256_ps128(acc));
+			if (other != lane)
+			{
+				_mm_storeu_ps(row + 5, _mm256_extractf128_ps(acc, 1));
+				row[8] = pTexCoords[j + other].texCoords[0];
+				row[9] = pTexCoords[j + other].texCoords[1];
+			}
+			row[3] = pTexCoords[j + lane].texCoords[0];
+			row[4] = pTexCoords[j + lane].texCoords[1];
+		}
+	}
+}
+
+static qboolean R_CpuSupports(const skinKernel_t kernel)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	if (kernel == SKIN_SSE2)
+	{
+		return static_cast<qboolean>((info[3] & 1 << 26) != 0);
+	}
+
+	// avx2 and fma, with the os saving the upper halves of the registers
+	if (!(info[2] & 1 << 12) || !(info[2] & 1 << 27) || !(info[2] & 1 << 28) || maxLeaf < 7 ||
+		(_xgetbv(0) & 6) != 6)
+	{
+		return qfalse;
+	}
+	__cpuidex(info, 7, 0);
+	return static_cast<qboolean>((info[1] & 1 << 5) != 0);
+#else
+	__builtin_cpu_init();
+	if (kernel == SKIN_SSE2)
+	{
+		return static_cast<qboolean>(__builtin_cpu_supports("sse2") != 0);
+	}
+	return static_cast<qboolean>(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+#endif
+}
+
+#endif // SKIN_X86
+
+qboolean R_SkinKernelSupported(const skinKernel_t kernel)
+{
+	switch (kernel)
+	{
+	case SKIN_SCALAR:
+		return qtrue;
+#ifdef SKIN_X86
+	case SKIN_SSE2:
+	case SKIN_AVX2:
+		return R_CpuSupports(kernel);
+#endif
+	default:
+		return qfalse;
+	}
+}
+
+skinKernel_t R_BestSkinKernel(void)
+{
+	static const skinKernel_t best = R_SkinKernelSupported(SKIN_AVX2) ? SKIN_AVX2 :
+		R_SkinKernelSupported(SKIN_SSE2) ? SKIN_SSE2 : SKIN_SCALAR;
+
+	return best;
+}
+
+void R_SkinSurfaceVerts(const skinKernel_t kernel, const mdxmSurface_t* surface, const mdxaBone_t* const* bones, const vec3_t scale, float* out)
+{
+	switch (kernel)
+	{
+#ifdef SKIN_X86
+	case SKIN_AVX2:
+		R_SkinVertsAVX2(surface, bones, scale, out);
+		break;
+	case SKIN_SSE2:
+		R_SkinVertsSSE2(surface, bones, scale, out);
+		break;
+#endif
+	default:
+		R_SkinVertsScalar(surface, bones, scale, out);
+		break;
+	}
+}
@@ -0,0 +1,46 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// Filename:-	tr_skinning.h
+//
+// ghoul2 vertex skinning for collision, shared by the renderers
+
+#pragma once
+
+#include "../qcommon/q_shared.h"
+
+#define MDXABONEDEF	// q_shared.h has the bone struct already
+#include "mdx_format.h"
+
+enum skinKernel_t
+{
+	SKIN_SCALAR,
+	SKIN_SSE2,
+	SKIN_AVX2,
+	SKIN_NUM_KERNELS
+};
+
+qboolean R_SkinKernelSupported(skinKernel_t kernel);
+skinKernel_t R_BestSkinKernel(void);
+
+// skins a surface's verts into rows of 5 floats, the scaled position and the
+// texture coords, the layout the ghoul2 traces read. bones[i] is the posed
+// matrix of the surface's bone reference i.
+void R_SkinSurfaceVerts(skinKernel_t kernel, const mdxmSurface_t* surface, const mdxaBone_t* const* bones, const vec3_t scale, float* out);
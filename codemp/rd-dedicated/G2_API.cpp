@@ -31,6 +31,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <set>
 #include <list>
 #include <string>
+#include <vector>
 
 #ifdef _FULL_G2_LEAK_CHECKING
 int g_Ghoul2Allocations = 0;
@@ -301,6 +302,85 @@ qboolean G2API_OverrideServerWithClientData(CGhoul2Info_v& ghoul2, int model_ind
 #define G2_MODEL_BITS (10)
 #define G2_INDEX_MASK (MAX_G2_MODELS-1)
 
+/*
+Skinned vertex caches for G2API_CollisionDetectCache, one per ghoul2 info
+slot.  Skinning into the shared vert space meant that every entity needing
+a retransform wiped the cached verts of all the others, so in a busy fight
+nothing stayed cached.  With a cache each, an instance is skinned again only
+when G2_NeedRetransform says its pose changed.  Caches of deleted instances
+go back to a pool; past r_ghoul2vertcachemb the pool and then the least
+recently traced caches are freed.
+*/
+class CG2VertCache : public IHeapAllocator
+{
+	std::vector<char> mHeap;
+	std::vector<std::vector<char>> mOverflow; // allocations that didn't fit this pass
+	size_t mHeapUsed = 0;
+	size_t mUsed = 0; // everything handed out this pass, overflow included
+
+public:
+	int mHandle = 0; // ghoul2 handle the verts were skinned for
+	int mSkinTime = -1; // ghoul2 time of the cached pose
+	int mLastUsed = 0; // ghoul2 time of the last hit test, for the budget
+	int mLod = -1;
+	vec3_t mScale = {};
+	std::vector<std::pair<const model_s*, size_t*>> mModels; // model and mTransformedVertsArray of each instance model
+
+	void Invalidate()
+	{
+		mHandle = 0;
+		mSkinTime = -1;
+		mModels.clear();
+	}
+
+	size_t Bytes() const
+	{
+		return mHeap.size() + mUsed - mHeapUsed;
+	}
+
+	// start a new skinning pass, growing the block to hold all of the last
+	// one if it overflowed
+	void ResetHeap() override
+	{
+		if (!mOverflow.empty())
+		{
+			mHeap.assign(mUsed, 0);
+			mOverflow.clear();
+		}
+		mHeapUsed = 0;
+		mUsed = 0;
+	}
+
+	char* MiniHeapAlloc(const int size) override
+	{
+		const size_t aligned = (static_cast<size_t>(size) + 15) & ~static_cast<size_t>(15);
+
+		mUsed += aligned;
+		if (mHeapUsed + aligned <= mHeap.size())
+		{
+			char* address = &mHeap[mHeapUsed];
+			mHeapUsed += aligned;
+			return address;
+		}
+		// earlier allocations have to stay put, so take a separate block
+		mOverflow.emplace_back(aligned);
+		return mOverflow.back().data();
+	}
+};
+
+static CG2VertCache* g2VertCaches[MAX_G2_MODELS];
+static std::vector<CG2VertCache*> g2VertCachePool;
+
+static void G2_ReleaseVertCache(const int idx)
+{
+	if (g2VertCaches[idx])
+	{
+		g2VertCaches[idx]->Invalidate();
+		g2VertCachePool.push_back(g2VertCaches[idx]);
+		g2VertCaches[idx] = nullptr;
+	}
+}
+
 class Ghoul2InfoArray : public IGhoul2InfoArray
 {
 	std::vector<CGhoul2Info> m_infos_[MAX_G2_MODELS];
@@ -309,6 +389,8 @@ class Ghoul2InfoArray : public IGhoul2InfoArray
 
 	void DeleteLow(const int idx)
 	{
+		G2_ReleaseVertCache(idx);
+
 		for (auto& model : m_infos_[idx])
 		{
 			if (model.mBoneCache)
@@ -1955,7 +2037,9 @@ static int QDECL QsortDistance(const void* a, const void* b)
 	return 1;
 }
 
-static bool G2_NeedRetransform(CGhoul2Info* g2, const int frame_num)
+// skinTime is the time of the pose already in the vert cache: bones that are
+// just playing their animation only count when the time has moved on
+static bool G2_NeedRetransform(CGhoul2Info* g2, const int frame_num, const int skinTime)
 {
 	//see if we need to do another transform
 	size_t i = 0;
@@ -1975,9 +2059,8 @@ static bool G2_NeedRetransform(CGhoul2Info* g2, const int frame_num)
 		}
 		const int newFrame = bone.startFrame + time * bone.anim_speed;
 
-		if (newFrame < bone.endFrame ||
-			bone.flags & BONE_ANIM_OVERRIDE_LOOP ||
-			bone.flags & BONE_NEED_TRANSFORM)
+		if (bone.flags & BONE_NEED_TRANSFORM ||
+			(frame_num != skinTime && (newFrame < bone.endFrame || bone.flags & BONE_ANIM_OVERRIDE_LOOP)))
 		{
 			//ok, we're gonna have to do it. bone is apparently animating.
 			bone.flags &= ~BONE_NEED_TRANSFORM;
@@ -1989,73 +2072,159 @@ static bool G2_NeedRetransform(CGhoul2Info* g2, const int frame_num)
 	return needTrans;
 }
 
-void G2API_CollisionDetectCache(CollisionRecord_t* collRecMap, CGhoul2Info_v& ghoul2, const vec3_t angles, const vec3_t position, int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, IHeapAllocator* G2VertSpace, int traceFlags, int useLod, float fRadius)
+static CG2VertCache* G2_GetVertCache(const int handle)
 {
-	//this will store off the transformed verts for the next trace - this is slower, but for models that do not animate
-	//frequently it is much much faster. -rww
-#if 0 // UNUSED
-	int* test = ghoul2[0].mTransformedVertsArray;
-#endif
-	if (G2_SetupModelPointers(ghoul2))
+	CG2VertCache*& cache = g2VertCaches[handle & G2_INDEX_MASK];
+
+	if (!cache)
 	{
-		vec3_t transRayStart, transRayEnd;
+		if (g2VertCachePool.empty())
+		{
+			cache = new CG2VertCache;
+		}
+		else
+		{
+			cache = g2VertCachePool.back();
+			g2VertCachePool.pop_back();
+		}
+	}
+	if (cache->mHandle != handle)
+	{
+		cache->Invalidate();
+		cache->mHandle = handle;
+	}
 
-		const int tframeNum = G2API_GetTime(frameNumber);
-		// make sure we have transformed the whole skeletons for each model
-		if (G2_NeedRetransform(&ghoul2[0], tframeNum) || !ghoul2[0].mTransformedVertsArray)
+	return cache;
+}
+
+static bool G2_VertCacheMatches(const CG2VertCache* cache, CGhoul2Info_v& ghoul2, const vec3_t scale, const int useLod)
+{
+	if (cache->mSkinTime == -1 || cache->mLod != useLod || !VectorCompare(cache->mScale, scale) ||
+		cache->mModels.size() != static_cast<size_t>(ghoul2.size()))
+	{
+		return false;
+	}
+	for (int i = 0; i < ghoul2.size(); i++)
+	{
+		if (cache->mModels[i].first != ghoul2[i].currentModel)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// keep the caches within r_ghoul2vertcachemb, pooled ones go first, then
+// whoever was traced against longest ago
+static void G2_TrimVertCaches(const CG2VertCache* keep)
+{
+	const size_t budget = r_Ghoul2VertCacheMB->integer > 0 ? static_cast<size_t>(r_Ghoul2VertCacheMB->integer) << 20 : 0;
+	size_t total = 0;
+
+	for (const CG2VertCache* cache : g2VertCachePool)
+	{
+		total += cache->Bytes();
+	}
+	for (const CG2VertCache* cache : g2VertCaches)
+	{
+		if (cache)
 		{
-			//optimization, only create new transform space if we need to, otherwise
-			//store it off!
-			int i = 0;
-			while (i < ghoul2.size())
+			total += cache->Bytes();
+		}
+	}
+
+	while (total > budget && !g2VertCachePool.empty())
+	{
+		total -= g2VertCachePool.back()->Bytes();
+		delete g2VertCachePool.back();
+		g2VertCachePool.pop_back();
+	}
+
+	while (total > budget)
+	{
+		int oldest = -1;
+		for (int i = 0; i < MAX_G2_MODELS; i++)
+		{
+			if (g2VertCaches[i] && g2VertCaches[i] != keep &&
+				(oldest == -1 || g2VertCaches[i]->mLastUsed < g2VertCaches[oldest]->mLastUsed))
 			{
-				CGhoul2Info& g2 = ghoul2[i];
+				oldest = i;
+			}
+		}
+		if (oldest == -1)
+		{
+			break;
+		}
 
-				/*
-				if ((g2.mFlags & GHOUL2_ZONETRANSALLOC) && g2.mTransformedVertsArray)
-				{ //clear it out, yo.
-					Z_Free(g2.mTransformedVertsArray);
-					g2.mTransformedVertsArray = 0;
-				}
-				*/
-				if (!g2.mTransformedVertsArray || !(g2.mFlags & GHOUL2_ZONETRANSALLOC))
+		// don't leave the instance pointing into freed verts
+		CG2VertCache* cache = g2VertCaches[oldest];
+		if (TheGhoul2InfoArray().IsValid(cache->mHandle))
+		{
+			std::vector<CGhoul2Info>& models = TheGhoul2InfoArray().Get(cache->mHandle);
+			for (size_t i = 0; i < models.size() && i < cache->mModels.size(); i++)
+			{
+				if (models[i].mTransformedVertsArray == cache->mModels[i].second)
 				{
-					//reworked so we only alloc once!
-					//if we have a pointer, but not a ghoul2_zonetransalloc flag, then that means
-					//it is a miniheap pointer. Just stomp over it.
-					const int iSize = g2.currentModel->mdxm->numSurfaces * 4;
-					g2.mTransformedVertsArray = static_cast<size_t*>(Z_Malloc(iSize, TAG_GHOUL2, qtrue));
+					models[i].mTransformedVertsArray = nullptr;
 				}
+			}
+		}
 
-				g2.mFlags |= GHOUL2_ZONETRANSALLOC;
+		total -= cache->Bytes();
+		delete cache;
+		g2VertCaches[oldest] = nullptr;
+	}
+}
 
-				i++;
-			}
+/*
+G2API_CollisionDetectCache skins into the instance's own CG2VertCache, so the
+vert space argument is ignored.  It stays in the signature because the
+refexport_t entry is shared with the renderers that still use it.
+*/
+void G2API_CollisionDetectCache(CollisionRecord_t* collRecMap, CGhoul2Info_v& ghoul2, const vec3_t angles, const vec3_t position, int frameNumber, int entNum, vec3_t rayStart, vec3_t rayEnd, vec3_t scale, IHeapAllocator* /*G2VertSpace*/, int traceFlags, int useLod, float fRadius)
+{
+	//this will store off the transformed verts for the next trace - this is slower, but for models that do not animate
+	//frequently it is much much faster. -rww
+	if (G2_SetupModelPointers(ghoul2))
+	{
+		vec3_t transRayStart, transRayEnd;
+
+		const int tframeNum = G2API_GetTime(frameNumber);
+		CG2VertCache* cache = G2_GetVertCache(ghoul2.mItem);
+
+		cache->mLastUsed = tframeNum;
+
+		// make sure we have transformed the whole skeletons for each model
+		if (G2_NeedRetransform(&ghoul2[0], tframeNum, cache->mSkinTime) || !G2_VertCacheMatches(cache, ghoul2, scale, useLod))
+		{
 			G2_ConstructGhoulSkeleton(ghoul2, frameNumber, true, scale);
-			G2VertSpace->ResetHeap();
 
-			// now having done that, time to build the model
+			// skin into this instance's own cache, not the shared vert space
+			cache->ResetHeap();
 #ifdef _G2_GORE
-			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
+			G2_TransformModel(ghoul2, frameNumber, scale, cache, useLod, false);
 #else
-			G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
+			G2_TransformModel(ghoul2, frameNumber, scale, cache, useLod);
 #endif
 
-			//don't need to do this anymore now that I am using a flag for zone alloc.
-			/*
-			i = 0;
-			while (i < ghoul2.size())
+			cache->mSkinTime = tframeNum;
+			cache->mLod = useLod;
+			VectorCopy(scale, cache->mScale);
+			cache->mModels.clear();
+			for (int i = 0; i < ghoul2.size(); i++)
 			{
-				CGhoul2Info &g2 = ghoul2[i];
-				int iSize = g2.currentModel->mdxm->numSurfaces * 4;
-
-				int *zoneMem = (int *)Z_Malloc(iSize, TAG_GHOUL2, qtrue);
-				memcpy(zoneMem, g2.mTransformedVertsArray, iSize);
-				g2.mTransformedVertsArray = zoneMem;
-				g2.mFlags |= GHOUL2_ZONETRANSALLOC;
-				i++;
+				cache->mModels.emplace_back(ghoul2[i].currentModel, ghoul2[i].mTransformedVertsArray);
+			}
+
+			G2_TrimVertCaches(cache);
+		}
+		else
+		{
+			// another trace path may have pointed the models at the shared vert space since
+			for (int i = 0; i < ghoul2.size(); i++)
+			{
+				ghoul2[i].mTransformedVertsArray = cache->mModels[i].second;
 			}
-			*/
 		}
 
 		// pre generate the world matrix - used to transform the incoming ray
@@ -2104,19 +2273,16 @@ void G2API_CollisionDetect(CollisionRecord_t* collRecMap, CGhoul2Info_v& ghoul2,
 		// pre generate the world matrix - used to transform the incoming ray
 		G2_GenerateWorldMatrix(angles, position);
 
+		// translate the ray to model space, so limbs it can't reach are never skinned
+		TransformAndTranslatePoint(rayStart, transRayStart, &worldMatrixInv);
+		TransformAndTranslatePoint(rayEnd, transRayEnd, &worldMatrixInv);
+
 		G2VertSpace->ResetHeap();
 
 		// now having done that, time to build the model
-#ifdef _G2_GORE
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod, false);
-#else
-		G2_TransformModel(ghoul2, frameNumber, scale, G2VertSpace, useLod);
-#endif
+		G2_TransformModelForRay(ghoul2, frameNumber, scale, G2VertSpace, useLod, transRayStart, transRayEnd, fRadius);
 
 		// model is built. Lets check to see if any triangles are actually hit.
-		// first up, translate the ray to model space
-		TransformAndTranslatePoint(rayStart, transRayStart, &worldMatrixInv);
-		TransformAndTranslatePoint(rayEnd, transRayEnd, &worldMatrixInv);
 
 		// now walk each model and check the ray against each poly - sigh, this is SO expensive. I wish there was a better way to do this.
 #ifdef _G2_GORE
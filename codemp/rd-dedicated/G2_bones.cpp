@@ -462,7 +462,7 @@ qboolean G2_Set_Bone_Angles_Index(boneInfo_v& blist, const int index, const floa
 
 	// yes, so set the angles and flags correctly
 	blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-	blist[index].flags |= flags;
+	blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 	blist[index].boneBlendStart = current_time;
 	blist[index].boneBlendTime = blend_time;
 #if DEBUG_PCJ
@@ -490,7 +490,7 @@ qboolean G2_Set_Bone_Angles(const CGhoul2Info* ghlInfo, boneInfo_v& blist, const
 
 		// yes, so set the angles and flags correctly
 		blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-		blist[index].flags |= flags;
+		blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 		blist[index].boneBlendStart = current_time;
 		blist[index].boneBlendTime = blend_time;
 #if DEBUG_PCJ
@@ -509,7 +509,7 @@ qboolean G2_Set_Bone_Angles(const CGhoul2Info* ghlInfo, boneInfo_v& blist, const
 	{
 		// yes, so set the angles and flags correctly
 		blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-		blist[index].flags |= flags;
+		blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 		blist[index].boneBlendStart = current_time;
 		blist[index].boneBlendTime = blend_time;
 #if DEBUG_PCJ
@@ -544,7 +544,7 @@ qboolean G2_Set_Bone_Angles_Matrix_Index(boneInfo_v& blist, const int index, con
 	}
 	// yes, so set the angles and flags correctly
 	blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-	blist[index].flags |= flags;
+	blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 	blist[index].boneBlendStart = current_time;
 	blist[index].boneBlendTime = blend_time;
 
@@ -581,7 +581,7 @@ qboolean G2_Set_Bone_Angles_Matrix(const char* file_name, boneInfo_v& blist, con
 	{
 		// yes, so set the angles and flags correctly
 		blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-		blist[index].flags |= flags;
+		blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 
 		memcpy(&blist[index].matrix, &matrix, sizeof(mdxaBone_t));
 		memcpy(&blist[index].newMatrix, &matrix, sizeof(mdxaBone_t));
@@ -596,7 +596,7 @@ qboolean G2_Set_Bone_Angles_Matrix(const char* file_name, boneInfo_v& blist, con
 	{
 		// yes, so set the angles and flags correctly
 		blist[index].flags &= ~(BONE_ANGLES_TOTAL);
-		blist[index].flags |= flags;
+		blist[index].flags |= flags | BONE_NEED_TRANSFORM; // for the cached trace transform
 
 		memcpy(&blist[index].matrix, &matrix, sizeof(mdxaBone_t));
 		memcpy(&blist[index].newMatrix, &matrix, sizeof(mdxaBone_t));
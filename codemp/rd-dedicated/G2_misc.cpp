@@ -25,6 +25,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/MiniHeap.h"
 #include "server/server.h"
 #include "ghoul2/g2_local.h"
+#include "rd-common/tr_skinning.h"
 
 #include "tr_local.h"
 #ifdef _G2_GORE
@@ -377,116 +378,146 @@ int G2_DecideTraceLod(const CGhoul2Info& ghoul2, const int useLod)
 	return returnLod;
 }
 
-static void R_TransformEachSurface(const mdxmSurface_t* surface, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertsArray, CBoneCache* boneCache)
+// skinned surfaces keep their posed mins and maxs just ahead of the verts
+#define G2_SURFACE_BOUNDS_FLOATS	6
+
+// the model space ray a collision transform is for, surfaces it can't reach
+// don't get skinned
+using g2CullRay_t = struct g2CullRay_s
 {
-	int j, k;
+	vec3_t start;
+	vec3_t end;
+	float margin;
+};
 
-	//
-	// deform the vertexes by the lerped bones
-	//
-	const int* piBoneReferences = reinterpret_cast<int*>((byte*)surface + surface->ofsBoneReferences);
+static float G2_CullMargin(const float fRadius)
+{
+	// radius traces take verts in a square around the ray, so allow for its corners
+	return fabs(fRadius) >= 0.1f ? fabs(fRadius) * 1.5f + 1.0f : 1.0f;
+}
 
-	// alloc some space for the transformed verts to get put in
-	auto TransformedVerts = reinterpret_cast<float*>(G2VertSpace->MiniHeapAlloc(surface->numVerts * 5 * 4));
-	TransformedVertsArray[surface->thisSurfaceIndex] = reinterpret_cast<size_t>(TransformedVerts);
-	if (!TransformedVerts)
+// box up where a surface's verts can be in the current pose: each bone's bind
+// pose box carried through its bone matrix, and the union of those
+static void G2_SurfacePoseBounds(const model_t* currentModel, const mdxmSurface_t* surface, const int surfaceNum, const int lod, const vec3_t scale, CBoneCache* boneCache, vec3_t mins, vec3_t maxs)
+{
+	const mdxmBoneBounds_t* bounds = nullptr;
+
+	if (currentModel->mdxmBoneBounds)
 	{
-		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+		bounds = currentModel->mdxmBoneBounds[lod * currentModel->mdxm->numSurfaces + surfaceNum];
+	}
+	if (!bounds)
+	{
+		VectorSet(mins, -Q3_INFINITE, -Q3_INFINITE, -Q3_INFINITE);
+		VectorSet(maxs, Q3_INFINITE, Q3_INFINITE, Q3_INFINITE);
+		return;
 	}
 
-	// whip through and actually transform each vertex
-	const int numVerts = surface->numVerts;
-	auto v = reinterpret_cast<mdxmVertex_t*>((byte*)surface + surface->ofsVerts);
-	const mdxmVertexTexCoord_t* pTexCoords = reinterpret_cast<mdxmVertexTexCoord_t*>(&v[numVerts]);
+	const int* piBoneReferences = reinterpret_cast<const int*>((byte*)surface + surface->ofsBoneReferences);
 
-	// optimisation issue
-	if (scale[0] != 1.0 || scale[1] != 1.0 || scale[2] != 1.0)
+	ClearBounds(mins, maxs);
+	for (int i = 0; i < surface->numBoneReferences; i++)
 	{
-		for (j = 0; j < numVerts; j++)
+		if (bounds[i].mins[0] > bounds[i].maxs[0])
 		{
-			vec3_t tempVert, tempNormal;
-			//			mdxmWeight_t	*w;
+			continue; // no verts on this bone
+		}
 
-			VectorClear(tempVert);
-			VectorClear(tempNormal);
-			//			w = v->weights;
+		const mdxaBone_t& bone = EvalBoneCache(piBoneReferences[i], boneCache);
 
-			const int iNumWeights = G2_GetVertWeights(v);
+		for (int j = 0; j < 3; j++)
+		{
+			float center = bone.matrix[j][3];
+			float extent = 0.0f;
 
-			float fTotalWeight = 0.0f;
-			for (k = 0; k < iNumWeights; k++)
+			for (int k = 0; k < 3; k++)
 			{
-				const int iBoneIndex = G2_GetVertBoneIndex(v, k);
-				const float fBoneWeight = G2_GetVertBoneWeight(v, k, fTotalWeight, iNumWeights);
-
-				const mdxaBone_t& bone = EvalBoneCache(piBoneReferences[iBoneIndex], boneCache);
-
-				tempVert[0] += fBoneWeight * (DotProduct(bone.matrix[0], v->vertCoords) + bone.matrix[0][3]);
-				tempVert[1] += fBoneWeight * (DotProduct(bone.matrix[1], v->vertCoords) + bone.matrix[1][3]);
-				tempVert[2] += fBoneWeight * (DotProduct(bone.matrix[2], v->vertCoords) + bone.matrix[2][3]);
-
-				tempNormal[0] += fBoneWeight * DotProduct(bone.matrix[0], v->normal);
-				tempNormal[1] += fBoneWeight * DotProduct(bone.matrix[1], v->normal);
-				tempNormal[2] += fBoneWeight * DotProduct(bone.matrix[2], v->normal);
+				center += bone.matrix[j][k] * (bounds[i].mins[k] + bounds[i].maxs[k]) * 0.5f;
+				extent += fabs(bone.matrix[j][k]) * (bounds[i].maxs[k] - bounds[i].mins[k]) * 0.5f;
 			}
-			int pos = j * 5;
+			center *= scale[j];
+			extent *= fabs(scale[j]);
 
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0] * scale[0];
-			TransformedVerts[pos++] = tempVert[1] * scale[1];
-			TransformedVerts[pos++] = tempVert[2] * scale[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos] = pTexCoords[j].texCoords[1];
-
-			v++; // = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
+			if (center - extent < mins[j])
+			{
+				mins[j] = center - extent;
+			}
+			if (center + extent > maxs[j])
+			{
+				maxs[j] = center + extent;
+			}
 		}
 	}
-	else
-	{
-		int pos = 0;
-		for (j = 0; j < numVerts; j++)
-		{
-			vec3_t tempVert, tempNormal;
-			//			const mdxmWeight_t	*w;
+}
 
-			VectorClear(tempVert);
-			VectorClear(tempNormal);
-			//			w = v->weights;
+// does the segment come within margin of the box
+static bool G2_RayReachesBounds(const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, const float margin)
+{
+	float enter = 0.0f;
+	float leave = 1.0f;
 
-			const int iNumWeights = G2_GetVertWeights(v);
+	for (int i = 0; i < 3; i++)
+	{
+		const float lo = mins[i] - margin;
+		const float hi = maxs[i] + margin;
+		const float delta = end[i] - start[i];
 
-			float fTotalWeight = 0.0f;
-			for (k = 0; k < iNumWeights; k++)
+		if (fabs(delta) < 1e-6f)
+		{
+			if (start[i] < lo || start[i] > hi)
 			{
-				const int iBoneIndex = G2_GetVertBoneIndex(v, k);
-				const float fBoneWeight = G2_GetVertBoneWeight(v, k, fTotalWeight, iNumWeights);
-
-				const mdxaBone_t& bone = EvalBoneCache(piBoneReferences[iBoneIndex], boneCache);
+				return false;
+			}
+			continue;
+		}
 
-				tempVert[0] += fBoneWeight * (DotProduct(bone.matrix[0], v->vertCoords) + bone.matrix[0][3]);
-				tempVert[1] += fBoneWeight * (DotProduct(bone.matrix[1], v->vertCoords) + bone.matrix[1][3]);
-				tempVert[2] += fBoneWeight * (DotProduct(bone.matrix[2], v->vertCoords) + bone.matrix[2][3]);
+		float t0 = (lo - start[i]) / delta;
+		float t1 = (hi - start[i]) / delta;
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		enter = t0 > enter ? t0 : enter;
+		leave = t1 < leave ? t1 : leave;
+		if (enter > leave)
+		{
+			return false;
+		}
+	}
+	return true;
+}
 
-				tempNormal[0] += fBoneWeight * DotProduct(bone.matrix[0], v->normal);
-				tempNormal[1] += fBoneWeight * DotProduct(bone.matrix[1], v->normal);
-				tempNormal[2] += fBoneWeight * DotProduct(bone.matrix[2], v->normal);
-			}
+static void R_TransformEachSurface(const mdxmSurface_t* surface, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertsArray, CBoneCache* boneCache, const vec3_t mins, const vec3_t maxs)
+{
+	//
+	// deform the vertexes by the lerped bones
+	//
+	const int* piBoneReferences = reinterpret_cast<int*>((byte*)surface + surface->ofsBoneReferences);
 
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0];
-			TransformedVerts[pos++] = tempVert[1];
-			TransformedVerts[pos++] = tempVert[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[1];
+	// alloc some space for the transformed verts to get put in, behind the bounds
+	auto TransformedVerts = reinterpret_cast<float*>(G2VertSpace->MiniHeapAlloc((G2_SURFACE_BOUNDS_FLOATS + surface->numVerts * 5) * 4));
+	if (!TransformedVerts)
+	{
+		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
+	}
+	VectorCopy(mins, TransformedVerts);
+	VectorCopy(maxs, TransformedVerts + 3);
+	TransformedVerts += G2_SURFACE_BOUNDS_FLOATS;
+	TransformedVertsArray[surface->thisSurfaceIndex] = reinterpret_cast<size_t>(TransformedVerts);
 
-			v++; // = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
-		}
+	// look the surface's bones up once, the kernel goes by bone reference
+	const mdxaBone_t* bones[iMAX_G2_BONEREFS_PER_SURFACE];
+	const int numBones = surface->numBoneReferences < iMAX_G2_BONEREFS_PER_SURFACE ? surface->numBoneReferences : iMAX_G2_BONEREFS_PER_SURFACE;
+	for (int i = 0; i < numBones; i++)
+	{
+		bones[i] = &EvalBoneCache(piBoneReferences[i], boneCache);
 	}
+
+	// whip through and actually transform each vertex
+	R_SkinSurfaceVerts(R_BestSkinKernel(), surface, bones, scale, TransformedVerts);
 }
 
-static void G2_TransformSurfaces(const int surfaceNum, surfaceInfo_v& rootSList, CBoneCache* boneCache, const model_t* currentModel, const int lod, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertArray, const bool secondTimeAround)
+static void G2_TransformSurfaces(const int surfaceNum, surfaceInfo_v& rootSList, CBoneCache* boneCache, const model_t* currentModel, const int lod, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertArray, const bool secondTimeAround, const g2CullRay_t* cull)
 {
 	assert(currentModel);
 	assert(currentModel->mdxm);
@@ -510,7 +541,14 @@ static void G2_TransformSurfaces(const int surfaceNum, surfaceInfo_v& rootSList,
 	// if this surface is not off, add it to the shader render list
 	if (!off_flags)
 	{
-		R_TransformEachSurface(surface, scale, G2VertSpace, TransformedVertArray, boneCache);
+		vec3_t mins, maxs;
+
+		// no need to skin a limb the collision ray can't reach
+		G2_SurfacePoseBounds(currentModel, surface, surfaceNum, lod, scale, boneCache, mins, maxs);
+		if (!cull || G2_RayReachesBounds(cull->start, cull->end, mins, maxs, cull->margin))
+		{
+			R_TransformEachSurface(surface, scale, G2VertSpace, TransformedVertArray, boneCache, mins, maxs);
+		}
 	}
 
 	// if we are turning off all descendants, then stop this recursion now
@@ -523,15 +561,15 @@ static void G2_TransformSurfaces(const int surfaceNum, surfaceInfo_v& rootSList,
 	for (int i = 0; i < surfInfo->numChildren; i++)
 	{
 		G2_TransformSurfaces(surfInfo->childIndexes[i], rootSList, boneCache, currentModel, lod, scale, G2VertSpace,
-			TransformedVertArray, secondTimeAround);
+			TransformedVertArray, secondTimeAround, cull);
 	}
 }
 
 // main calling point for the model transform for collision detection. At this point all of the skeleton has been transformed.
 #ifdef _G2_GORE
-void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, int useLod, const bool ApplyGore)
+static void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, int useLod, const bool ApplyGore, const g2CullRay_t* cull)
 #else
-void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, int useLod)
+static void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, int useLod, const g2CullRay_t* cull)
 #endif
 {
 	int lod;
@@ -625,7 +663,7 @@ void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale,
 		// recursively call the model surface transform
 
 		G2_TransformSurfaces(g.mSurfaceRoot, g.mSlist, g.mBoneCache, g.currentModel, lod, correctScale, G2VertSpace,
-			g.mTransformedVertsArray, false);
+			g.mTransformedVertsArray, false, cull);
 
 #ifdef _G2_GORE
 		if (ApplyGore && firstModelOnly)
@@ -637,6 +675,34 @@ void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale,
 	}
 }
 
+#ifdef _G2_GORE
+void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, const int useLod, const bool ApplyGore)
+{
+	G2_TransformModel(ghoul2, frame_num, scale, G2VertSpace, useLod, ApplyGore, nullptr);
+}
+#else
+void G2_TransformModel(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, const int useLod)
+{
+	G2_TransformModel(ghoul2, frame_num, scale, G2VertSpace, useLod, nullptr);
+}
+#endif
+
+// transform for a single collision test with a model space ray, surfaces it can't reach are left unskinned
+void G2_TransformModelForRay(CGhoul2Info_v& ghoul2, const int frame_num, vec3_t scale, IHeapAllocator* G2VertSpace, const int useLod, const vec3_t rayStart, const vec3_t rayEnd, const float fRadius)
+{
+	g2CullRay_t cull;
+
+	VectorCopy(rayStart, cull.start);
+	VectorCopy(rayEnd, cull.end);
+	cull.margin = G2_CullMargin(fRadius);
+
+#ifdef _G2_GORE
+	G2_TransformModel(ghoul2, frame_num, scale, G2VertSpace, useLod, false, &cull);
+#else
+	G2_TransformModel(ghoul2, frame_num, scale, G2VertSpace, useLod, &cull);
+#endif
+}
+
 // work out how much space a triangle takes
 static float G2_AreaOfTri(const vec3_t A, const vec3_t B, const vec3_t C)
 {
@@ -1378,6 +1444,25 @@ static bool G2_RadiusTracePolys(const mdxmSurface_t* surface,CTraceSurface& TS)
 	return false;
 }
 
+// collision transforms leave the surfaces a ray can't reach unskinned, and the
+// posed bounds ahead of the verts throw out the rest the ray misses
+static bool G2_TraceReachesSurface(const CTraceSurface& TS, const mdxmSurface_t* surface)
+{
+	const float* verts = TS.TransformedVertsArray ? reinterpret_cast<float*>(TS.TransformedVertsArray[surface->thisSurfaceIndex]) : nullptr;
+
+	if (!verts)
+	{
+		return false;
+	}
+	if (!TS.collRecMap)
+	{
+		return true; // gore projects along a direction, there's no segment to test
+	}
+
+	const float* bounds = verts - G2_SURFACE_BOUNDS_FLOATS;
+	return G2_RayReachesBounds(TS.rayStart, TS.rayEnd, bounds, bounds + 3, G2_CullMargin(TS.m_fRadius));
+}
+
 // look at a surface and then do the trace on each poly
 static void G2_TraceSurfaces(CTraceSurface& TS)
 {
@@ -1409,7 +1494,7 @@ static void G2_TraceSurfaces(CTraceSurface& TS)
 	}
 
 	// if this surface is not off, try to hit it
-	if (!off_flags)
+	if (!off_flags && G2_TraceReachesSurface(TS, surface))
 	{
 #ifdef _G2_GORE
 		if (TS.collRecMap)
@@ -2966,6 +2966,59 @@ void G2_ConstructGhoulSkeleton(CGhoul2Info_v& ghoul2, const int frame_num, const
 #endif
 }
 
+// box up the bind pose verts that each bone reference of each surface moves.
+// a vert goes in the box of every bone it's weighted to, so wherever a pose
+// blends it to, it stays inside the union of its bones' posed boxes
+static void R_LoadMDXMBoneBounds(model_t* mod)
+{
+	const mdxmHeader_t* mdxm = mod->mdxm;
+	auto lod = reinterpret_cast<mdxmLOD_t*>((byte*)mdxm + mdxm->ofsLODs);
+
+	mod->mdxmBoneBounds = static_cast<mdxmBoneBounds_t**>(Hunk_Alloc(
+		mdxm->numLODs * mdxm->numSurfaces * sizeof(mdxmBoneBounds_t*), h_low));
+
+	for (int l = 0; l < mdxm->numLODs; l++)
+	{
+		const mdxmLODSurfOffset_t* indexes = reinterpret_cast<mdxmLODSurfOffset_t*>(reinterpret_cast<byte*>(lod) + sizeof(mdxmLOD_t));
+
+		for (int i = 0; i < mdxm->numSurfaces; i++)
+		{
+			const auto surf = reinterpret_cast<const mdxmSurface_t*>((byte*)indexes + indexes->offsets[i]);
+			const int numBoneRefs = surf->numBoneReferences;
+
+			if (numBoneRefs <= 0)
+			{
+				continue;
+			}
+
+			const auto bounds = static_cast<mdxmBoneBounds_t*>(Hunk_Alloc(numBoneRefs * sizeof(mdxmBoneBounds_t), h_low));
+			for (int j = 0; j < numBoneRefs; j++)
+			{
+				ClearBounds(bounds[j].mins, bounds[j].maxs);
+			}
+
+			auto v = reinterpret_cast<const mdxmVertex_t*>((byte*)surf + surf->ofsVerts);
+			for (int j = 0; j < surf->numVerts; j++, v++)
+			{
+				const int iNumWeights = G2_GetVertWeights(v);
+
+				for (int k = 0; k < iNumWeights; k++)
+				{
+					const int iBoneIndex = G2_GetVertBoneIndex(v, k);
+
+					if (iBoneIndex < numBoneRefs)
+					{
+						AddPointToBounds(v->vertCoords, bounds[iBoneIndex].mins, bounds[iBoneIndex].maxs);
+					}
+				}
+			}
+
+			mod->mdxmBoneBounds[l * mdxm->numSurfaces + i] = bounds;
+		}
+		lod = reinterpret_cast<mdxmLOD_t*>(reinterpret_cast<byte*>(lod) + lod->ofsEnd);
+	}
+}
+
 /*
 =================
 R_LoadMDXM - load a Ghoul 2 Mesh file
@@ -3400,6 +3453,7 @@ qboolean R_LoadMDXM(model_t* mod, void* buffer, const char* mod_name, qboolean&
 
 	if (bAlreadyFound)
 	{
+		R_LoadMDXMBoneBounds(mod);
 		return qtrue; // All done. Stop, go no further, do not LittleLong(), do not pass Go...
 	}
 
@@ -3538,6 +3592,8 @@ qboolean R_LoadMDXM(model_t* mod, void* buffer, const char* mod_name, qboolean&
 		// find the next LOD
 		lod = reinterpret_cast<mdxmLOD_t*>(reinterpret_cast<byte*>(lod) + lod->ofsEnd);
 	}
+
+	R_LoadMDXMBoneBounds(mod);
 	return qtrue;
 }
 
@@ -186,6 +186,7 @@ cvar_t* r_noPrecacheGLA;
 
 cvar_t* r_noServerGhoul2;
 cvar_t* r_Ghoul2AnimSmooth = nullptr;
+cvar_t* r_Ghoul2VertCacheMB = nullptr;
 cvar_t* r_Ghoul2UnSqashAfterSmooth = nullptr;
 //cvar_t	*r_Ghoul2UnSqash;
 //cvar_t	*r_Ghoul2TimeBase=0; from single player
@@ -456,6 +457,8 @@ void R_Register()
 #endif
 	r_noServerGhoul2 = ri->Cvar_Get("r_noserverghoul2", "0", CVAR_CHEAT, "");
 	r_Ghoul2AnimSmooth = ri->Cvar_Get("r_ghoul2animsmooth", "0.3", CVAR_NONE, "");
+	r_Ghoul2VertCacheMB = ri->Cvar_Get("r_ghoul2vertcachemb", "16", CVAR_ARCHIVE_ND,
+		"Megabytes of skinned verts kept between ghoul2 collision traces");
 	r_Ghoul2UnSqashAfterSmooth = ri->Cvar_Get("r_ghoul2unsqashaftersmooth", "1", CVAR_NONE, "");
 	broadsword = ri->Cvar_Get("broadsword", "1", CVAR_NONE, "");
 	broadsword_kickbones = ri->Cvar_Get("broadsword_kickbones", "1", CVAR_NONE, "");
@@ -878,6 +878,14 @@ typedef enum {
 	*/
 } modtype_t;
 
+// bind pose box around the verts each bone reference of a ghoul2 surface moves,
+// so collision can throw out surfaces without skinning them
+using mdxmBoneBounds_t = struct mdxmBoneBounds_s
+{
+	vec3_t mins;
+	vec3_t maxs;
+};
+
 typedef struct model_s {
 	char		name[MAX_QPATH];
 	modtype_t	type;
@@ -891,6 +899,7 @@ typedef struct model_s {
 	*/
 	mdxmHeader_t* mdxm;				// only if type == MOD_GL2M which is a GHOUL II Mesh file NOT a GHOUL II animation file
 	mdxaHeader_t* mdxa;				// only if type == MOD_GL2A which is a GHOUL II Animation file
+	mdxmBoneBounds_t** mdxmBoneBounds;	// only if type == MOD_MDXM, [lod * numSurfaces + surface] has a box per bone reference
 	/*
 	Ghoul2 Insert End
 	*/
@@ -1286,6 +1295,7 @@ extern cvar_t* r_noPrecacheGLA;
 #endif
 
 extern cvar_t* r_noServerGhoul2;
+extern cvar_t* r_Ghoul2VertCacheMB;
 /*
 Ghoul2 Insert End
 */
@@ -3,6 +3,7 @@
 #include "qcommon/MiniHeap.h"
 #include "server/server.h"
 #include "ghoul2/g2_local.h"
+#include "rd-common/tr_skinning.h"
 #include "tr_local.h"
 
 #ifdef _G2_GORE
@@ -372,8 +373,6 @@ int G2_DecideTraceLod(const CGhoul2Info& ghoul2, const int useLod)
 
 static void R_TransformEachSurface(const mdxmSurface_t* surface, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertsArray, CBoneCache* boneCache)
 {
-	int				 j, k;
-	mdxmVertex_t* v;
 	float* TransformedVerts;
 
 	//
@@ -389,96 +388,16 @@ static void R_TransformEachSurface(const mdxmSurface_t* surface, vec3_t scale, I
 		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
 	}
 
-	// whip through and actually transform each vertex
-	const int numVerts = surface->numVerts;
-	v = (mdxmVertex_t*)((byte*)surface + surface->ofsVerts);
-	mdxmVertexTexCoord_t* pTexCoords = (mdxmVertexTexCoord_t*)&v[numVerts];
-
-	// optimisation issue
-	if ((scale[0] != 1.0) || (scale[1] != 1.0) || (scale[2] != 1.0))
+	// look the surface's bones up once, the kernel goes by bone reference
+	const mdxaBone_t* bones[iMAX_G2_BONEREFS_PER_SURFACE];
+	const int numBones = surface->numBoneReferences < iMAX_G2_BONEREFS_PER_SURFACE ? surface->numBoneReferences : iMAX_G2_BONEREFS_PER_SURFACE;
+	for (int i = 0; i < numBones; i++)
 	{
-		for (j = 0; j < numVerts; j++)
-		{
-			vec3_t			tempVert, tempNormal;
-			//			mdxmWeight_t	*w;
-
-			VectorClear(tempVert);
-			VectorClear(tempNormal);
-			//			w = v->weights;
-
-			const int iNumWeights = G2_GetVertWeights(v);
-
-			float fTotalWeight = 0.0f;
-			for (k = 0; k < iNumWeights; k++)
-			{
-				int		iBoneIndex = G2_GetVertBoneIndex(v, k);
-				float	fBoneWeight = G2_GetVertBoneWeight(v, k, fTotalWeight, iNumWeights);
-
-				const mdxaBone_t& bone = EvalBoneCache(piBoneReferences[iBoneIndex], boneCache);
-
-				tempVert[0] += fBoneWeight * (DotProduct(bone.matrix[0], v->vertCoords) + bone.matrix[0][3]);
-				tempVert[1] += fBoneWeight * (DotProduct(bone.matrix[1], v->vertCoords) + bone.matrix[1][3]);
-				tempVert[2] += fBoneWeight * (DotProduct(bone.matrix[2], v->vertCoords) + bone.matrix[2][3]);
-
-				tempNormal[0] += fBoneWeight * DotProduct(bone.matrix[0], v->normal);
-				tempNormal[1] += fBoneWeight * DotProduct(bone.matrix[1], v->normal);
-				tempNormal[2] += fBoneWeight * DotProduct(bone.matrix[2], v->normal);
-			}
-			int pos = j * 5;
-
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0] * scale[0];
-			TransformedVerts[pos++] = tempVert[1] * scale[1];
-			TransformedVerts[pos++] = tempVert[2] * scale[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos] = pTexCoords[j].texCoords[1];
-
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
-		}
+		bones[i] = &EvalBoneCache(piBoneReferences[i], boneCache);
 	}
-	else
-	{
-		int pos = 0;
-		for (j = 0; j < numVerts; j++)
-		{
-			vec3_t			tempVert, tempNormal;
-			//			const mdxmWeight_t	*w;
-
-			VectorClear(tempVert);
-			VectorClear(tempNormal);
-			//			w = v->weights;
-
-			const int iNumWeights = G2_GetVertWeights(v);
-
-			float fTotalWeight = 0.0f;
-			for (k = 0; k < iNumWeights; k++)
-			{
-				int		iBoneIndex = G2_GetVertBoneIndex(v, k);
-				float	fBoneWeight = G2_GetVertBoneWeight(v, k, fTotalWeight, iNumWeights);
 
-				const mdxaBone_t& bone = EvalBoneCache(piBoneReferences[iBoneIndex], boneCache);
-
-				tempVert[0] += fBoneWeight * (DotProduct(bone.matrix[0], v->vertCoords) + bone.matrix[0][3]);
-				tempVert[1] += fBoneWeight * (DotProduct(bone.matrix[1], v->vertCoords) + bone.matrix[1][3]);
-				tempVert[2] += fBoneWeight * (DotProduct(bone.matrix[2], v->vertCoords) + bone.matrix[2][3]);
-
-				tempNormal[0] += fBoneWeight * DotProduct(bone.matrix[0], v->normal);
-				tempNormal[1] += fBoneWeight * DotProduct(bone.matrix[1], v->normal);
-				tempNormal[2] += fBoneWeight * DotProduct(bone.matrix[2], v->normal);
-			}
-
-			// copy tranformed verts into temp space
-			TransformedVerts[pos++] = tempVert[0];
-			TransformedVerts[pos++] = tempVert[1];
-			TransformedVerts[pos++] = tempVert[2];
-			// we will need the S & T coors too for hitlocation and hitmaterial stuff
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[0];
-			TransformedVerts[pos++] = pTexCoords[j].texCoords[1];
-
-			v++;// = (mdxmVertex_t *)&v->weights[/*v->numWeights*/surface->maxVertBoneWeights];
-		}
-	}
+	// whip through and actually transform each vertex
+	R_SkinSurfaceVerts(R_BestSkinKernel(), surface, bones, scale, TransformedVerts);
 }
 
 static void G2_TransformSurfaces(const int surfaceNum, surfaceInfo_v& rootSList, CBoneCache* boneCache, const model_t* currentModel, const int lod, vec3_t scale, IHeapAllocator* G2VertSpace, size_t* TransformedVertArray, const bool secondTimeAround)
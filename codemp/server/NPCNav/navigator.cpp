@@ -108,9 +108,6 @@ CNode::CNode(void)
 CNode::~CNode(void)
 {
 	m_edges.clear();
-
-	if (m_ranks)
-		delete[] m_ranks;
 }
 
 /*
@@ -213,8 +210,9 @@ AddRank
 void CNode::AddRank(const int ID, const int rank) const
 {
 	assert(m_ranks);
+	assert(rank >= 0 && rank < NAV_RANK_NONE);
 
-	m_ranks[ID] = rank;
+	m_ranks[ID] = static_cast<navRank_t>(rank);
 }
 
 /*
@@ -344,22 +342,13 @@ void CNode::SetEdgeFlags(const int edgeNum, const int newFlags)
 
 /*
 -------------------------
-InitRanks
+SetRanks
 -------------------------
 */
 
-void CNode::InitRanks(const int size)
+void CNode::SetRanks(navRank_t* ranks)
 {
-	//Clear it if it's already allocated
-	if (m_ranks != nullptr)
-	{
-		delete[] m_ranks;
-		m_ranks = nullptr;
-	}
-
-	m_ranks = new int[size];
-
-	memset(m_ranks, -1, sizeof(int) * size);
+	m_ranks = ranks;
 }
 
 /*
@@ -372,6 +361,9 @@ int CNode::GetRank(const int ID) const
 {
 	assert(m_ranks);
 
+	if (m_ranks[ID] == NAV_RANK_NONE)
+		return NODE_NONE;
+
 	return m_ranks[ID];
 }
 
@@ -381,7 +373,7 @@ Save
 -------------------------
 */
 
-int CNode::Save(const int numNodes, const fileHandle_t file)
+int CNode::Save(const fileHandle_t file)
 {
 	//Write out the header
 	constexpr auto header = NODE_HEADER_ID;
@@ -405,15 +397,89 @@ int CNode::Save(const int numNodes, const fileHandle_t file)
 		FS_Write(&*ei, sizeof(edge_t), file);
 	}
 
-	//Write out the node ranks
-	FS_Write(&numNodes, sizeof numNodes, file);
+	return true;
+}
 
-	for (i = 0; i < numNodes; i++)
+/*
+-------------------------
+BuildNodeGrid
+-------------------------
+*/
+
+void CNavigator::BuildNodeGrid(void)
+{
+	const int numNodes = m_nodes.size();
+	vec3_t mins, maxs;
+
+	m_gridCells.clear();
+	m_gridNodes.resize(numNodes);
+
+	if (numNodes == 0)
+		return;
+
+	ClearBounds(mins, maxs);
+
+	for (int i = 0; i < numNodes; i++)
 	{
-		FS_Write(&m_ranks[i], sizeof(int), file);
+		m_nodes[i]->GetPosition(m_gridNodes[i].position);
+		m_gridNodes[i].nodeID = m_nodes[i]->GetID();
+		AddPointToBounds(m_gridNodes[i].position, mins, maxs);
 	}
 
-	return true;
+	//Grow the cells until the grid is a sane size, sparse maps get big cells
+	m_gridCellSize = NAV_GRID_CELL_SIZE;
+
+	while (true)
+	{
+		int numCells = 1;
+
+		for (int i = 0; i < 3; i++)
+		{
+			m_gridDims[i] = static_cast<int>((maxs[i] - mins[i]) / m_gridCellSize) + 1;
+			numCells *= m_gridDims[i];
+		}
+
+		if (numCells <= NAV_GRID_MAX_CELLS)
+			break;
+
+		m_gridCellSize *= 2;
+	}
+
+	VectorCopy(mins, m_gridOrigin);
+
+	//Counting sort of the nodes by cell
+	const int numCells = m_gridDims[0] * m_gridDims[1] * m_gridDims[2];
+	std::vector<int> nodeCells(numNodes);
+	std::vector<gridNode_t> unsorted(m_gridNodes);
+
+	m_gridCells.assign(numCells + 1, 0);
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		int cell[3];
+
+		for (int j = 0; j < 3; j++)
+		{
+			cell[j] = static_cast<int>((unsorted[i].position[j] - m_gridOrigin[j]) / m_gridCellSize);
+			if (cell[j] >= m_gridDims[j])
+				cell[j] = m_gridDims[j] - 1;
+		}
+
+		nodeCells[i] = (cell[2] * m_gridDims[1] + cell[1]) * m_gridDims[0] + cell[0];
+		m_gridCells[nodeCells[i] + 1]++;
+	}
+
+	for (int c = 0; c < numCells; c++)
+	{
+		m_gridCells[c + 1] += m_gridCells[c];
+	}
+
+	std::vector<int> fill(m_gridCells.begin(), m_gridCells.end() - 1);
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		m_gridNodes[fill[nodeCells[i]]++] = unsorted[i];
+	}
 }
 
 /*
@@ -422,7 +488,7 @@ Load
 -------------------------
 */
 
-int CNode::Load(int numNodes, const fileHandle_t file)
+int CNode::Load(const int numNodes, const fileHandle_t file)
 {
 	unsigned int header;
 	FS_Read(&header, sizeof header, file);
@@ -443,26 +509,20 @@ int CNode::Load(int numNodes, const fileHandle_t file)
 	//Get the edge information
 	FS_Read(&m_numEdges, sizeof m_numEdges, file);
 
+	if (m_numEdges < 0 || m_numEdges > numNodes)
+		return false;
+
 	for (i = 0; i < m_numEdges; i++)
 	{
 		edge_t edge;
 
 		FS_Read(&edge, sizeof(edge_t), file);
 
-		STL_INSERT(m_edges, edge);
-	}
-
-	//Read the node ranks
-	int numRanks;
-
-	FS_Read(&numRanks, sizeof numRanks, file);
-
-	//Allocate the memory
-	InitRanks(numRanks);
+		//Edges index the node list, so a bad one is a bad file
+		if (edge.ID < 0 || edge.ID >= numNodes)
+			return false;
 
-	for (i = 0; i < numRanks; i++)
-	{
-		FS_Read(&m_ranks[i], sizeof(int), file);
+		STL_INSERT(m_edges, edge);
 	}
 
 	return true;
@@ -596,6 +656,24 @@ void CNavigator::Free(void)
 
 	m_nodes.clear();
 	m_edgeLookupMap.clear();
+	m_gridCells.clear();
+	m_gridNodes.clear();
+
+	//Give the rank table's memory back, it can be large
+	std::vector<navRank_t>().swap(m_ranks);
+}
+
+/*
+-------------------------
+AllocateRanks
+-------------------------
+*/
+
+void CNavigator::AllocateRanks(void)
+{
+	const size_t numNodes = m_nodes.size();
+
+	m_ranks.assign(numNodes * numNodes, static_cast<navRank_t>(NAV_RANK_NONE));
 }
 
 /*
@@ -638,13 +716,22 @@ bool CNavigator::Load(const char* filename, const int checksum)
 
 	const int numNodes = GetInt(file);
 
+	if (numNodes < 0 || numNodes > MAX_NAV_NODES)
+	{
+		FS_FCloseFile(file);
+		return false;
+	}
+
 	for (int i = 0; i < numNodes; i++)
 	{
 		CNode* node = CNode::Create();
 
-		if (node->Load(numNodes, file) == false)
+		//Nodes are looked up by ID, so they have to be stored in order
+		if (node->Load(numNodes, file) == false || node->GetID() != i)
 		{
+			delete node;
 			FS_FCloseFile(file);
+			Free();
 			return false;
 		}
 
@@ -658,11 +745,90 @@ bool CNavigator::Load(const char* filename, const int checksum)
 		m_edgeLookupMap.insert(std::pair<int, int>(failedEdges[j].startID, j));
 	}
 
+	//read in the precomputed routes, so the paths don't need calculating again
+	if (LoadRoutes(file) == false)
+	{
+		FS_FCloseFile(file);
+		Free();
+		return false;
+	}
+
 	FS_FCloseFile(file);
 
+	BuildNodeGrid();
+
 	return true;
 }
 
+/*
+-------------------------
+LoadRoutes
+-------------------------
+*/
+
+bool CNavigator::LoadRoutes(const fileHandle_t file)
+{
+	const int numNodes = m_nodes.size();
+
+	if (GetLong(file) != NAV_ROUTE_HEADER_ID)
+		return false;
+
+	if (GetInt(file) != NAV_ROUTE_VERSION)
+		return false;
+
+	if (GetInt(file) != numNodes)
+		return false;
+
+	const auto routeChecksum = static_cast<uint32_t>(GetInt(file));
+
+	AllocateRanks();
+
+	//One read per node straight into the rank table
+	const int rowSize = numNodes * sizeof(navRank_t);
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		navRank_t* row = &m_ranks[static_cast<size_t>(i) * numNodes];
+
+		if (FS_Read(row, rowSize, file) != rowSize)
+			return false;
+
+		for (int j = 0; j < numNodes; j++)
+		{
+			if (row[j] != NAV_RANK_NONE && row[j] >= numNodes)
+				return false;
+		}
+
+		m_nodes[i]->SetRanks(row);
+	}
+
+	return GetRouteChecksum() == routeChecksum;
+}
+
+/*
+-------------------------
+GetRouteChecksum
+-------------------------
+*/
+
+uint32_t CNavigator::GetRouteChecksum(void) const
+{
+	const int numNodes = m_nodes.size();
+
+	if (numNodes == 0)
+		return 0;
+
+	//Checksum each node's row, then the row checksums, so no block gets too big
+	std::vector<uint32_t> rowChecksums(numNodes);
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		rowChecksums[i] = Com_BlockChecksum(&m_ranks[static_cast<size_t>(i) * numNodes], numNodes * sizeof(navRank_t));
+	}
+
+	return Com_BlockChecksum(rowChecksums.data(), numNodes * sizeof(uint32_t));
+}
+
 /*
 -------------------------
 Save
@@ -673,6 +839,12 @@ bool CNavigator::Save(const char* filename, const int checksum)
 {
 	fileHandle_t file;
 
+	const int numNodes = m_nodes.size();
+
+	//Nothing to save until the paths have been calculated
+	if (m_ranks.size() != static_cast<size_t>(numNodes) * numNodes)
+		return false;
+
 	//Attempt to load the file
 	FS_FOpenFileByMode(va("maps/%s.nav", filename), &file, FS_WRITE);
 
@@ -687,8 +859,6 @@ bool CNavigator::Save(const char* filename, const int checksum)
 	//Write out the checksum
 	FS_Write(&checksum, sizeof checksum, file);
 
-	const int numNodes = m_nodes.size();
-
 	//Write out the number of nodes to follow
 	FS_Write(&numNodes, sizeof numNodes, file);
 
@@ -697,12 +867,27 @@ bool CNavigator::Save(const char* filename, const int checksum)
 
 	STL_ITERATE(ni, m_nodes)
 	{
-		(*ni)->Save(numNodes, file);
+		(*ni)->Save(file);
 	}
 
 	//write out failed edges
 	FS_Write(&failedEdges, sizeof failedEdges, file);
 
+	//write out the precomputed routes
+	constexpr auto routeID = NAV_ROUTE_HEADER_ID;
+	constexpr int routeVersion = NAV_ROUTE_VERSION;
+	const uint32_t routeChecksum = GetRouteChecksum();
+
+	FS_Write(&routeID, sizeof routeID, file);
+	FS_Write(&routeVersion, sizeof routeVersion, file);
+	FS_Write(&numNodes, sizeof numNodes, file);
+	FS_Write(&routeChecksum, sizeof routeChecksum, file);
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		FS_Write(&m_ranks[static_cast<size_t>(i) * numNodes], numNodes * sizeof(navRank_t), file);
+	}
+
 	FS_FCloseFile(file);
 
 	return true;
@@ -716,6 +901,11 @@ AddRawPoint
 
 int CNavigator::AddRawPoint(vec3_t point, const int flags, const int radius)
 {
+	if (m_nodes.size() >= MAX_NAV_NODES)
+	{
+		Com_Error(ERR_DROP, "Too many navigation nodes (max %i)\n", MAX_NAV_NODES);
+	}
+
 	CNode* node = CNode::Create(point, flags, radius, m_nodes.size());
 
 	if (node == nullptr)
@@ -823,11 +1013,14 @@ void CNavigator::CalculatePath(CNode* node) const
 {
 	int curRank = 0;
 
-	const auto pathList = new CPriorityQueue();
+	//Scratch space is kept per thread and reused for every node it floods
+	static thread_local CPriorityQueue pathList;
+	static thread_local std::vector<byte> checked;
+
+	pathList.Clear();
 
 	//Init the completion table
-	const auto checked = new byte[m_nodes.size()];
-	memset(checked, 0, m_nodes.size());
+	checked.assign(m_nodes.size(), 0);
 
 	//Mark this node as checked
 	checked[node->GetID()] = true;
@@ -842,16 +1035,16 @@ void CNavigator::CalculatePath(CNode* node) const
 
 		checked[nextNode->GetID()] = true;
 
-		pathList->Push(new CEdge(nextNode->GetID(), nextNode->GetID(), node->GetEdgeCost(i)));
+		pathList.Push(CEdge(nextNode->GetID(), nextNode->GetID(), node->GetEdgeCost(i)));
 	}
 
 	//Now flood fill all the others
-	while (!pathList->Empty())
+	while (!pathList.Empty())
 	{
 		//minDist = Q3_INFINITE;
-		const CEdge* test = pathList->Pop();
+		const CEdge test = pathList.Pop();
 
-		CNode* testNode = m_nodes[(*test).m_first];
+		CNode* testNode = m_nodes[test.m_first];
 		assert(testNode);
 
 		node->AddRank(testNode->GetID(), curRank++);
@@ -865,18 +1058,29 @@ void CNavigator::CalculatePath(CNode* node) const
 			if (checked[addNode->GetID()])
 				continue;
 
-			const int newDist = (*test).m_cost + testNode->GetEdgeCost(i);
-			pathList->Push(new CEdge(addNode->GetID(), (*test).m_second, newDist));
+			const int newDist = test.m_cost + testNode->GetEdgeCost(i);
+			pathList.Push(CEdge(addNode->GetID(), test.m_second, newDist));
 
 			checked[addNode->GetID()] = true;
 		}
-		delete test;
 	}
 
 	node->RemoveFlag(NF_RECALC);
+}
 
-	delete pathList;
-	delete[] checked;
+/*
+-------------------------
+CalculatePathJob
+
+Every flood only writes its own node's ranks, so they can all run at once
+-------------------------
+*/
+
+void CNavigator::CalculatePathJob(const int index, void* data)
+{
+	const CNavigator* nav = static_cast<CNavigator*>(data);
+
+	nav->CalculatePath(nav->m_nodes[index]);
 }
 
 /*
@@ -886,21 +1090,25 @@ CalculatePaths
 */
 void CNavigator::CalculatePaths(const qboolean recalc)
 {
+	PROFILE_SCOPE("NAV_CalculatePaths");
 #if _HARD_CONNECT
 #else
 #endif
 
-	for (const auto& node : m_nodes)
-	{
-		//Allocate the needed memory
-		node->InitRanks(m_nodes.size());
-	}
+	const int numNodes = m_nodes.size();
 
-	for (const auto& node : m_nodes)
+	//Allocate the needed memory
+	AllocateRanks();
+
+	for (int i = 0; i < numNodes; i++)
 	{
-		CalculatePath(node);
+		m_nodes[i]->SetRanks(&m_ranks[static_cast<size_t>(i) * numNodes]);
 	}
 
+	Com_ParallelFor(numNodes, CalculatePathJob, this);
+
+	BuildNodeGrid();
+
 	if (!recalc) //Mike says doesn't need to happen on recalc
 	{
 		GVM_NAV_FindCombatPointWaypoints();
@@ -1023,6 +1231,7 @@ int CNavigator::GetNodeRadius(const int nodeID) const
 
 void CNavigator::CheckBlockedEdges(void)
 {
+	PROFILE_SCOPE("NAV_CheckBlockedEdges");
 	trace_t trace;
 	node_v::iterator ni;
 
@@ -1234,81 +1443,88 @@ CollectNearestNodes
 -------------------------
 */
 
-#define	NODE_COLLECT_MAX	16		//Maximum # of nodes collected at any time
 #define NODE_COLLECT_RADIUS	512		//Default radius to search for nodes in
 #define NODE_COLLECT_RADIUS_SQR		( NODE_COLLECT_RADIUS * NODE_COLLECT_RADIUS )
 
-int CNavigator::CollectNearestNodes(vec3_t origin, const int radius, const int maxCollect, nodeChain_l& nodeChain)
+int CNavigator::CollectNearestNodes(vec3_t origin, const int radius, int maxCollect, nodeChain_l& nodeChain)
 {
-	node_v::iterator ni;
-	int collected = 0;
+	nodeChain.count = 0;
 
-	//Get a distance rating for each node in the system
-	STL_ITERATE(ni, m_nodes)
+	if (maxCollect > NODE_COLLECT_MAX)
+		maxCollect = NODE_COLLECT_MAX;
+
+	if (m_nodes.empty() || maxCollect <= 0)
+		return 0;
+
+	//Nodes added since the grid was built (or no grid yet)
+	if (m_gridNodes.size() != m_nodes.size())
 	{
-		vec3_t position;
-		//If we've got our quota, then stop looking
-		//Get the distance to the node
-		(*ni)->GetPosition(position);
-		const float dist = DistanceSquared(position, origin);
+		BuildNodeGrid();
+	}
 
-		//Must be within our radius range
-		if (dist > static_cast<float>(radius * radius))
-			continue;
+	//Find the cells the search sphere touches, a unit wider for rounding
+	int cellMins[3], cellMaxs[3];
 
-		nodeList_t nChain{};
-		nodeChain_l::iterator nci;
+	for (int i = 0; i < 3; i++)
+	{
+		const float lo = (origin[i] - (radius + 1) - m_gridOrigin[i]) / m_gridCellSize;
+		const float hi = (origin[i] + (radius + 1) - m_gridOrigin[i]) / m_gridCellSize;
 
-		//Always add the first node
-		if (nodeChain.size() == 0)
-		{
-			nChain.nodeID = (*ni)->GetID();
-			nChain.distance = dist;
+		if (hi < 0 || lo >= m_gridDims[i])
+			return 0;
 
-			nodeChain.insert(nodeChain.begin(), nChain);
-			continue;
-		}
+		cellMins[i] = lo <= 0 ? 0 : static_cast<int>(lo);
+		cellMaxs[i] = hi >= m_gridDims[i] - 1 ? m_gridDims[i] - 1 : static_cast<int>(hi);
+	}
 
-		bool added = false;
+	const float radiusSqr = static_cast<float>(radius * radius);
 
-		//Compare it to what we already have
-		STL_ITERATE(nci, nodeChain)
+	for (int z = cellMins[2]; z <= cellMaxs[2]; z++)
+	{
+		for (int y = cellMins[1]; y <= cellMaxs[1]; y++)
 		{
-			//If we're less, than this entry, then insert before it
-			if (dist < (*nci).distance)
+			const int row = (z * m_gridDims[1] + y) * m_gridDims[0];
+			const gridNode_t* gn = &m_gridNodes[m_gridCells[row + cellMins[0]]];
+			const gridNode_t* end = &m_gridNodes[0] + m_gridCells[row + cellMaxs[0] + 1];
+
+			for (; gn < end; gn++)
 			{
-				nChain.nodeID = (*ni)->GetID();
-				nChain.distance = dist;
+				const float dist = DistanceSquared(gn->position, origin);
+
+				//Must be within our radius range
+				if (dist > radiusSqr)
+					continue;
 
-				nodeChain.insert(nci, nChain);
-				collected = nodeChain.size();
-				added = true;
+				//Keep the list ordered the way the old linear scan built it: by
+				//whole distance, then by node number
+				const unsigned int distance = dist;
+				int slot = nodeChain.count;
 
-				//If we've hit our collection limit, throw off the oldest one
-				if (static_cast<int>(nodeChain.size()) > maxCollect)
+				while (slot > 0 && (nodeChain.nodes[slot - 1].distance > distance ||
+					(nodeChain.nodes[slot - 1].distance == distance && nodeChain.nodes[slot - 1].nodeID > gn->nodeID)))
 				{
-					nodeChain.pop_back();
+					slot--;
 				}
 
-				break;
-			}
-		}
+				if (slot >= maxCollect)
+					continue;
 
-		//Otherwise, always pad out the collection if possible so we don't miss anything
-		if (added == false && static_cast<int>(nodeChain.size()) < maxCollect)
-		{
-			nChain.nodeID = (*ni)->GetID();
-			nChain.distance = dist;
+				if (nodeChain.count < maxCollect)
+					nodeChain.count++;
 
-			nodeChain.insert(nodeChain.end(), nChain);
+				memmove(&nodeChain.nodes[slot + 1], &nodeChain.nodes[slot], (nodeChain.count - 1 - slot) * sizeof nodeChain.nodes[0]);
+				nodeChain.nodes[slot].nodeID = gn->nodeID;
+				nodeChain.nodes[slot].distance = distance;
+			}
 		}
 	}
 
-	return collected;
+	return nodeChain.count;
 }
 
 int CNavigator::GetBestPathBetweenEnts(sharedEntity_t* ent, sharedEntity_t* goal, const int flags)
 {
+	PROFILE_SCOPE("NAV_GetBestPathBetweenEnts");
 	//Must have nodes
 	if (m_nodes.size() == 0)
 		return NODE_NONE;
@@ -1515,6 +1731,7 @@ GetNearestWaypoint
 
 int CNavigator::GetNearestNode(sharedEntity_t* ent, const int lastID, const int flags, const int targetID)
 {
+	PROFILE_SCOPE("NAV_GetNearestNode");
 	int bestNode = NODE_NONE;
 	//Must have nodes
 	if (m_nodes.size() == 0)
@@ -2260,6 +2477,7 @@ GetBestNodeAltRoute
 
 int CNavigator::GetBestNodeAltRoute(const int startID, const int endID, int* pathCost, const int rejectID)
 {
+	PROFILE_SCOPE("NAV_GetBestNodeAltRoute");
 	//Must have nodes
 	if (m_nodes.size() == 0)
 		return WAYPOINT_NONE;
@@ -2687,33 +2905,28 @@ int CNavigator::GetProjectedNode(vec3_t origin, const int nodeID) const
 class NodeTotalGreater
 {
 public:
-	bool operator()(CEdge* first, CEdge* second) const
+	bool operator()(const CEdge& first, const CEdge& second) const
 	{
-		return first->m_cost > second->m_cost;
+		return first.m_cost > second.m_cost;
 	}
 };
 
 //////////////////////////////////////////////////////////////////
-// Destructor - Deallocate any remaining pointers in the queue
+// Destructor
 //////////////////////////////////////////////////////////////////
 CPriorityQueue::~CPriorityQueue()
-{
-	while (!Empty())
-	{
-		delete Pop();
-	}
-}
+= default;
 
 //////////////////////////////////////////////////////////////////
 // Standard Iterative Search
 //////////////////////////////////////////////////////////////////
-CEdge* CPriorityQueue::Find(const int npNum) const
+const CEdge* CPriorityQueue::Find(const int npNum) const
 {
 	for (const auto& HeapIter : mHeap)
 	{
-		if (HeapIter->m_first == npNum)
+		if (HeapIter.m_first == npNum)
 		{
-			return HeapIter;
+			return &HeapIter;
 		}
 	}
 	return nullptr;
@@ -2722,9 +2935,9 @@ CEdge* CPriorityQueue::Find(const int npNum) const
 //////////////////////////////////////////////////////////////////
 // Remove Node And Resort
 //////////////////////////////////////////////////////////////////
-CEdge* CPriorityQueue::Pop()
+CEdge CPriorityQueue::Pop()
 {
-	CEdge* edge = mHeap.front();
+	const CEdge edge = mHeap.front();
 
 	//pop_mHeap will move the node at the front to the position N
 	//and then sort the mHeap to make positions 1 through N-1 correct
@@ -2742,7 +2955,7 @@ CEdge* CPriorityQueue::Pop()
 //////////////////////////////////////////////////////////////////
 // Add New Node And Resort
 //////////////////////////////////////////////////////////////////
-void CPriorityQueue::Push(CEdge* theEdge)
+void CPriorityQueue::Push(const CEdge& theEdge)
 {
 	//Pushes the node onto the back of the mHeap
 	mHeap.push_back(theEdge);
@@ -2754,14 +2967,14 @@ void CPriorityQueue::Push(CEdge* theEdge)
 //////////////////////////////////////////////////////////////////
 // Find The Node In Question And Resort mHeap Around It
 //////////////////////////////////////////////////////////////////
-void CPriorityQueue::Update(CEdge* edge)
+void CPriorityQueue::Update(const CEdge& edge)
 {
 	for (auto i = mHeap.begin(); i != mHeap.end(); ++i)
 	{
-		if ((*i)->m_first == edge->m_first)
+		if (i->m_first == edge.m_first)
 		{
-			//Found node - resort from this position in the mHeap
-			//(its total value was changed before this function was called)
+			//Found node - copy in the new total and resort from this position in the mHeap
+			*i = edge;
 			std::push_heap(mHeap.begin(), i + 1, NodeTotalGreater());
 			return;
 		}
@@ -2774,4 +2987,12 @@ void CPriorityQueue::Update(CEdge* edge)
 bool CPriorityQueue::Empty() const
 {
 	return mHeap.empty();
-};
\ No newline at end of file
+};
+
+//////////////////////////////////////////////////////////////////
+// Empty the queue but keep its storage for the next flood
+//////////////////////////////////////////////////////////////////
+void CPriorityQueue::Clear()
+{
+	mHeap.clear();
+}
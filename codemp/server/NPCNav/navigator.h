@@ -45,8 +45,17 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 //Miscellaneous defines
 #define	NODE_NONE		-1
-#define	NAV_HEADER_ID	INT_ID('J','N','V','5')
+#define	NAV_RANK_NONE	0xFFFF
+#define	MAX_NAV_NODES	NAV_RANK_NONE	// ranks have to fit below NAV_RANK_NONE
+#define	NODE_COLLECT_MAX	16		//Maximum # of nodes collected at any time
+#define	NAV_GRID_CELL_SIZE	256		//Starting cell size of the node grid
+#define	NAV_GRID_MAX_CELLS	( 1 << 18 )
+#define	NAV_HEADER_ID	INT_ID('J','N','V','6')
 #define	NODE_HEADER_ID	INT_ID('N','O','D','E')
+#define	NAV_ROUTE_HEADER_ID	INT_ID('R','O','U','T')
+#define	NAV_ROUTE_VERSION	1
+
+using navRank_t = unsigned short;
 
 using EdgeMultimap = std::multimap<int, int>;
 using EdgeMultimapIt = EdgeMultimap::iterator;
@@ -112,14 +121,14 @@ public:
 	void SetEdgeFlags(int edgeNum, int newFlags);
 	int GetRadius(void) const { return m_radius; }
 
-	void InitRanks(int size);
+	void SetRanks(navRank_t* ranks);
 	int GetRank(int ID) const;
 
 	int GetFlags(void) const { return m_flags; }
 	void AddFlag(const int newFlag) { m_flags |= newFlag; }
 	void RemoveFlag(const int oldFlag) { m_flags &= ~oldFlag; }
 
-	int Save(int numNodes, fileHandle_t file);
+	int Save(fileHandle_t file);
 	int Load(int numNodes, fileHandle_t file);
 
 protected:
@@ -130,7 +139,7 @@ protected:
 
 	edge_v m_edges;
 
-	int* m_ranks;
+	navRank_t* m_ranks; // this node's row of CNavigator::m_ranks
 	int m_numEdges;
 };
 
@@ -154,7 +163,18 @@ class CNavigator
 		unsigned int distance;
 	};
 
-	using nodeChain_l = std::list<nodeList_t>;
+	// nearest nodes, closest first; fixed size so a query never allocates
+	struct nodeChain_l
+	{
+		using iterator = nodeList_t*;
+
+		nodeList_t nodes[NODE_COLLECT_MAX];
+		int count = 0;
+
+		iterator begin() { return nodes; }
+		iterator end() { return nodes + count; }
+		size_t size() const { return count; }
+	};
 
 #endif	//__NEWCOLLECT
 
@@ -244,7 +264,13 @@ protected:
 	static int GetEdgeCost(CNode* first, CNode* second);
 	void AddNodeEdges(CNode* node, int addDist, edge_l& edgeList, bool* checkedNodes) const;
 
+	void BuildNodeGrid(void);
+
 	void CalculatePath(CNode* node) const;
+	static void CalculatePathJob(int index, void* data);
+	void AllocateRanks(void);
+	bool LoadRoutes(fileHandle_t file);
+	uint32_t GetRouteChecksum(void) const;
 
 	//rww - made failedEdges private as it doesn't seem to need to be public.
 	//And I'd rather shoot myself than have to devise a way of setting/accessing this
@@ -253,6 +279,23 @@ protected:
 
 	node_v m_nodes;
 	EdgeMultimap m_edgeLookupMap;
+
+	// flood order of every node from every other node, m_nodes.size() squared
+	std::vector<navRank_t> m_ranks;
+
+	// uniform grid over node positions for CollectNearestNodes, nodes sorted
+	// by cell with m_gridCells[c] .. m_gridCells[c+1] indexing cell c's run
+	using gridNode_t = struct gridNode_s
+	{
+		vec3_t position;
+		int nodeID;
+	};
+
+	vec3_t m_gridOrigin;
+	int m_gridCellSize;
+	int m_gridDims[3];
+	std::vector<int> m_gridCells;
+	std::vector<gridNode_t> m_gridNodes;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -269,16 +312,17 @@ public:
 	// Functionality
 	//--------------------------------------------------------------
 public:
-	CEdge* Pop();
-	CEdge* Find(int npNum) const;
-	void Push(CEdge* theEdge);
-	void Update(CEdge* edge);
+	CEdge Pop();
+	const CEdge* Find(int npNum) const;
+	void Push(const CEdge& theEdge);
+	void Update(const CEdge& edge);
 	bool Empty() const;
+	void Clear();
 
 	// DATA
 	//--------------------------------------------------------------
 private:
-	std::vector<CEdge*> mHeap;
+	std::vector<CEdge> mHeap; // edges are kept by value, the storage is reused between floods
 };
 
 extern CNavigator navigator;
@@ -46,7 +46,6 @@ using svEntity_t = struct svEntity_s
 	int clusternums[MAX_ENT_CLUSTERS];
 	int lastCluster; // if all the clusters don't fit in clusternums
 	int areanum, areanum2;
-	int snapshotCounter; // used to prevent double adding from portal views
 };
 
 using serverState_t = enum
@@ -65,7 +64,6 @@ using server_t = struct server_s
 	int serverId; // changes each server start
 	int restartedServerId; // serverId before a map_restart
 	int checksumFeed; //
-	int snapshotCounter; // incremented for each snapshot built
 	int timeResidual; // <= 1000 / sv_frame->value
 	int nextFrameTime; // when time > nextFrameTime, process world
 	char* configstrings[MAX_CONFIGSTRINGS];
@@ -111,6 +109,7 @@ using clientSnapshot_t = struct clientSnapshot_s
 	int first_entity; // into the circular sv_packet_entities[]
 	// the entities MUST be in increasing state number
 	// order, otherwise the delta compression will fail
+	unsigned entityGeneration; // snapshot pass the entity states were copied in
 	int messageSent; // time the message was transmitted
 	int messageAcked; // time the message was acked
 	int messageSize; // used to rate drop packets
@@ -138,6 +137,9 @@ using demoInfo_t = struct
 	qboolean demowaiting; // don't record until a non-delta message is sent
 	int minDeltaFrame; // the first non-delta frame stored in the demo.  cannot delta against frames older than this
 	fileHandle_t demofile;
+	qboolean archive; // .dmz with keyframes instead of a plain .dm
+	int nextKeyframeTime;
+	qboolean keyframePending; // demowaiting was set to get a keyframe snapshot
 	qboolean isBot;
 	int botReliableAcknowledge;
 	// for bots, need to maintain a separate reliableAcknowledge to record server messages into the demo file
@@ -276,6 +278,10 @@ extern cvar_t* sv_minPing;
 extern cvar_t* sv_maxPing;
 extern cvar_t* sv_gametype;
 extern cvar_t* sv_pure;
+extern cvar_t* sv_mapPreload;
+extern cvar_t* sv_demoWriter;
+extern cvar_t* sv_demoArchive;
+extern cvar_t* sv_demoKeyframeInterval;
 extern cvar_t* sv_floodProtect;
 extern cvar_t* sv_lanForceRate;
 extern cvar_t* sv_needpass;
@@ -285,6 +291,9 @@ extern cvar_t* sv_autoDemoBots;
 extern cvar_t* sv_autoDemoMaxMaps;
 extern cvar_t* sv_legacyFixes;
 extern cvar_t* sv_banFile;
+extern cvar_t* sv_parallelSnapshots;
+extern cvar_t* sv_broadphase;
+extern cvar_t* sv_parallelTraces;
 
 extern serverBan_t serverBans[SERVER_MAXBANS];
 extern int serverBansCount;
@@ -347,6 +356,19 @@ void SV_ChallengeShutdown();
 int SV_CreateChallenge(netadr_t from);
 qboolean SV_VerifyChallenge(int receivedChallenge, netadr_t from);
 
+//
+// sv_demowriter.cpp
+//
+void SV_ShutdownDemoWriter(void);
+void SV_OpenDemoFile(fileHandle_t f, qboolean archive, int keyframeMsec);
+qboolean SV_QueueDemoMessage(fileHandle_t f, int sequence, const void* data, int len, qboolean canDrop);
+qboolean SV_QueueDemoKeyframe(fileHandle_t f, int serverTime, int sequence, const void* data, int len,
+	qboolean canDrop);
+void SV_CloseDemoFile(fileHandle_t f);
+void SV_DemoWriterFrame(void);
+void SV_FlushDemoWriter(void);
+void SV_DemoWriterStats_f(void);
+
 //
 // sv_client.c
 //
@@ -438,6 +460,10 @@ clip_handle_t SV_clip_handleForEntity(const sharedEntity_t* ent);
 
 void SV_SectorList_f(void);
 
+void SV_MarkPVSEntities(const byte* pvs, byte* entityBits);
+// sets the bits of all entities linked into clusters set in the pvs,
+// plus those with too many clusters to be indexed
+
 int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int* entity_list, int maxcount);
 // fills in a table of entity numbers with entities that have bounding boxes
 // that intersect the given area.  It is possible for a non-axial bmodel
@@ -453,6 +479,9 @@ void SV_Trace(trace_t* results, const vec3_t start, const vec3_t mins, const vec
 	int pass_entity_num, int contentmask, int capsule, int traceFlags, int useLod);
 // mins and maxs are relative
 
+void SV_TraceBatch(const traceRequest_t* requests, trace_t* results, int count);
+// runs count independent traces, results[i] answers requests[i]
+
 // if the entire move stays in a solid volume, trace.allsolid will be set,
 // trace.startsolid will be set, and trace.fraction will be 0
 
@@ -616,6 +616,7 @@ SV_BotFrame
 */
 void SV_BotFrame(const int time)
 {
+	PROFILE_SCOPE("SV_BotFrame");
 	if (!bot_enable)
 		return;
 	//NOTE: maybe the game is already shutdown
@@ -1630,26 +1630,76 @@ static void SV_KillServer_f(void)
 	SV_Shutdown("killserver");
 }
 
+// defined in sv_client.cpp
+extern void SV_CreateClientGameStateMessage(client_t* client, msg_t* msg);
+
+/*
+==================
+SV_WriteDemoGamestate
+
+Writes the gamestate as of now, which is how a demo starts.  In an archive
+it's a keyframe, and the message after it must be a non-delta snapshot.
+Returns qfalse if canDrop was set and the writer had no room for it.
+==================
+*/
+static qboolean SV_WriteDemoGamestate(client_t* cl, const qboolean canDrop)
+{
+	byte bufData[MAX_MSGLEN];
+	msg_t msg;
+
+	MSG_Init(&msg, bufData, sizeof bufData);
+
+	// NOTE, MRE: all server->client messages now acknowledge
+	const int tmp = cl->reliableSent;
+	SV_CreateClientGameStateMessage(cl, &msg);
+	cl->reliableSent = tmp;
+
+	// finished writing the client packet
+	MSG_WriteByte(&msg, svc_EOF);
+
+	if (cl->demo.archive)
+	{
+		// whether it made it or not, the next one is an interval away
+		cl->demo.nextKeyframeTime = sv.time + Q_max(1, sv_demoKeyframeInterval->integer) * 1000;
+		return SV_QueueDemoKeyframe(cl->demo.demofile, sv.time, cl->netchan.outgoingSequence - 1, msg.data,
+			msg.cursize, canDrop);
+	}
+
+	return SV_QueueDemoMessage(cl->demo.demofile, cl->netchan.outgoingSequence - 1, msg.data, msg.cursize,
+		canDrop);
+}
+
 void SV_WriteDemoMessage(client_t* cl, msg_t* msg, const int headerBytes)
 {
-	int swlen;
-
-	// write the packet sequence
-	int len = cl->netchan.outgoingSequence;
-	swlen = LittleLong len;
-	FS_Write(&swlen, 4, cl->demo.demofile);
-
-	// skip the packet sequencing information
-	len = msg->cursize - headerBytes;
-	swlen = LittleLong len;
-	FS_Write(&swlen, 4, cl->demo.demofile);
-	FS_Write(msg->data + headerBytes, len, cl->demo.demofile);
+	if (cl->demo.keyframePending)
+	{
+		// demowaiting made this a non-delta snapshot, so playback can start
+		// here.  A keyframe the writer has no room for is skipped rather than
+		// holding up the frame, the snapshot still goes in as a plain message.
+		SV_WriteDemoGamestate(cl, qtrue);
+		cl->demo.keyframePending = qfalse;
+	}
+
+	// skip the packet sequencing information.  If this one is dropped after
+	// its keyframe made it, demowaiting keeps anything but the next non-delta
+	// snapshot out of the demo, so the keyframe is still a valid start.
+	if (!SV_QueueDemoMessage(cl->demo.demofile, cl->netchan.outgoingSequence, msg->data + headerBytes,
+		msg->cursize - headerBytes, qtrue))
+	{
+		// the writer fell behind and the message is gone, later deltas would
+		// refer to it so pick up again at the next non-delta snapshot
+		cl->demo.demowaiting = qtrue;
+	}
+	else if (cl->demo.archive && sv.time >= cl->demo.nextKeyframeTime)
+	{
+		// the next snapshot goes out non-delta and becomes a keyframe
+		cl->demo.demowaiting = qtrue;
+		cl->demo.keyframePending = qtrue;
+	}
 }
 
 void SV_StopRecordDemo(client_t* cl)
 {
-	int len;
-
 	if (!cl->demo.demorecording)
 	{
 		Com_Printf("Client %d is not recording a demo.\n", cl - svs.clients);
@@ -1657,10 +1707,8 @@ void SV_StopRecordDemo(client_t* cl)
 	}
 
 	// finish up
-	len = -1;
-	FS_Write(&len, 4, cl->demo.demofile);
-	FS_Write(&len, 4, cl->demo.demofile);
-	FS_FCloseFile(cl->demo.demofile);
+	SV_QueueDemoMessage(cl->demo.demofile, -1, nullptr, -1, qfalse);
+	SV_CloseDemoFile(cl->demo.demofile);
 	cl->demo.demofile = 0;
 	cl->demo.demorecording = qfalse;
 	Com_Printf("Stopped demo for client %d.\n", cl - svs.clients);
@@ -1736,15 +1784,9 @@ void SV_DemoFilename(char* buf, const int bufSize)
 	Com_sprintf(buf, bufSize, "demo%s", timeStr);
 }
 
-// defined in sv_client.cpp
-extern void SV_CreateClientGameStateMessage(client_t* client, msg_t* msg);
-
 void SV_RecordDemo(client_t* cl, char* demoName)
 {
 	char name[MAX_OSPATH];
-	byte bufData[MAX_MSGLEN];
-	msg_t msg;
-	int len;
 
 	if (cl->demo.demorecording)
 	{
@@ -1760,7 +1802,9 @@ void SV_RecordDemo(client_t* cl, char* demoName)
 
 	// open the demo file
 	Q_strncpyz(cl->demo.demoName, demoName, sizeof cl->demo.demoName);
-	Com_sprintf(name, sizeof name, "demos/%s.dm_%d", cl->demo.demoName, PROTOCOL_VERSION);
+	cl->demo.archive = sv_demoArchive->integer ? qtrue : qfalse;
+	Com_sprintf(name, sizeof name, "demos/%s.%s_%d", cl->demo.demoName, cl->demo.archive ? "dmz" : "dm",
+		PROTOCOL_VERSION);
 	Com_Printf("recording to %s.\n", name);
 	cl->demo.demofile = FS_FOpenFileWrite(name);
 	if (!cl->demo.demofile)
@@ -1768,7 +1812,9 @@ void SV_RecordDemo(client_t* cl, char* demoName)
 		Com_Printf("ERROR: couldn't open.\n");
 		return;
 	}
+	SV_OpenDemoFile(cl->demo.demofile, cl->demo.archive, Q_max(1, sv_demoKeyframeInterval->integer) * 1000);
 	cl->demo.demorecording = qtrue;
+	cl->demo.keyframePending = qfalse;
 
 	// don't start saving messages until a non-delta compressed message is received
 	cl->demo.demowaiting = qtrue;
@@ -1776,24 +1822,8 @@ void SV_RecordDemo(client_t* cl, char* demoName)
 	cl->demo.isBot = cl->netchan.remoteAddress.type == NA_BOT ? qtrue : qfalse;
 	cl->demo.botReliableAcknowledge = cl->reliableSent;
 
-	// write out the gamestate message
-	MSG_Init(&msg, bufData, sizeof bufData);
-
-	// NOTE, MRE: all server->client messages now acknowledge
-	const int tmp = cl->reliableSent;
-	SV_CreateClientGameStateMessage(cl, &msg);
-	cl->reliableSent = tmp;
-
-	// finished writing the client packet
-	MSG_WriteByte(&msg, svc_EOF);
-
-	// write it to the demo file
-	len = LittleLong cl->netchan.outgoingSequence - 1;
-	FS_Write(&len, 4, cl->demo.demofile);
-
-	len = LittleLong msg.cursize;
-	FS_Write(&len, 4, cl->demo.demofile);
-	FS_Write(msg.data, msg.cursize, cl->demo.demofile);
+	// write out the gamestate message, a demo can't do without it
+	SV_WriteDemoGamestate(cl, qfalse);
 
 	// the rest of the demo file will be copied from net messages
 }
@@ -1941,6 +1971,9 @@ void SV_BeginAutoRecordDemos()
 		}
 		if (sv_autoDemoMaxMaps->integer > 0 && sv.demosPruned == qfalse)
 		{
+			// nothing may still be writing into the folders about to go
+			SV_FlushDemoWriter();
+
 			char autorecordDirList[500 * MAX_OSPATH];
 			const int autorecordDirListCount = SV_FindLeafFolders("demos/autorecord", autorecordDirList, 500,
 				MAX_OSPATH);
@@ -2057,14 +2090,16 @@ static void SV_Record_f(void)
 	{
 		const char* s = Cmd_Argv(1);
 		Q_strncpyz(demoName, s, sizeof demoName);
-		Com_sprintf(name, sizeof name, "demos/%s.dm_%d", demoName, PROTOCOL_VERSION);
+		Com_sprintf(name, sizeof name, "demos/%s.%s_%d", demoName, sv_demoArchive->integer ? "dmz" : "dm",
+			PROTOCOL_VERSION);
 	}
 	else
 	{
 		// timestamp the file
 		SV_DemoFilename(demoName, sizeof demoName);
 
-		Com_sprintf(name, sizeof name, "demos/%s.dm_%d", demoName, PROTOCOL_VERSION);
+		Com_sprintf(name, sizeof name, "demos/%s.%s_%d", demoName, sv_demoArchive->integer ? "dmz" : "dm",
+			PROTOCOL_VERSION);
 
 		if (FS_FileExists(name))
 		{
@@ -2131,6 +2166,7 @@ void SV_AddOperatorCommands(void)
 	Cmd_AddCommand("weapontoggle", SV_WeaponToggle_f, "Toggle g_weaponDisable bits");
 	Cmd_AddCommand("svrecord", SV_Record_f, "Record a server-side demo");
 	Cmd_AddCommand("svstoprecord", SV_StopRecord_f, "Stop recording a server-side demo");
+	Cmd_AddCommand("svdemostats", SV_DemoWriterStats_f, "Show server-side demo writer statistics");
 	Cmd_AddCommand("sv_rehashbans", SV_RehashBans_f, "Reloads banlist from file");
 	Cmd_AddCommand("sv_listbans", SV_ListBans_f, "Lists bans");
 	Cmd_AddCommand("sv_banaddr", SV_BanAddr_f, "Bans a user");
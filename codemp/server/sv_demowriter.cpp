@@ -0,0 +1,669 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2016, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// sv_demowriter.cpp -- server-side demo messages are appended to their files
+// by a writer thread, so a slow disk stalls the writer instead of the frame.
+// The main thread is the only producer and the writer the only consumer of a
+// fixed size ring, neither takes a lock to move data through it.  The writer
+// stages each file's messages and writes them in large blocks, compressed
+// ones for demo archives.  Files are opened and closed on the main thread only.
+// With sv_demoWriter 0 the main thread drains the ring itself.
+
+#include "server.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr int DEMO_QUEUE_SIZE = 8 * 1024 * 1024; // power of 2
+constexpr int DEMO_QUEUE_MASK = DEMO_QUEUE_SIZE - 1;
+constexpr int DEMO_FLUSH_SIZE = 64 * 1024; // staged bytes that trigger a write
+constexpr int DEMO_FLUSH_MSEC = 500; // staged data older than this is written once the queue is empty
+
+using demoRecordType_t = enum
+{
+	DEMO_PAD, // the rest of the ring is unused, continue at the start
+	DEMO_FLUSH_ALL, // write everything staged
+	DEMO_OPEN, // start a .dm file
+	DEMO_OPEN_ARCHIVE, // start a .dmz file, time is the keyframe spacing
+	DEMO_MESSAGE, // sequence, length and data of one message
+	DEMO_KEYFRAME, // a gamestate message the next message's snapshot can be played from
+	DEMO_CLOSE // finish the file, the main thread closes it once the writer is past this
+};
+
+using demoRecord_t = struct demoRecord_s
+{
+	int file;
+	int type;
+	int len; // bytes that follow, rounded up to the record alignment in the ring
+	int time;
+};
+
+using demoClosing_t = struct demoClosing_s
+{
+	fileHandle_t file;
+	uint64_t pos; // closed once the writer has read past this
+};
+
+// writer side state of an open file
+using demoFile_t = struct demoFile_s
+{
+	qboolean archive;
+	int offset; // archive bytes written so far
+	std::vector<byte> staged;
+	std::chrono::steady_clock::time_point stagedSince;
+	std::vector<demoKeyframe_t> keyframes;
+};
+
+using demoWriter_t = struct demoWriter_s
+{
+	byte* ring;
+	std::atomic<uint64_t> head; // bytes queued, only the main thread moves it
+	std::atomic<uint64_t> tail; // bytes consumed, only the writer moves it
+	std::atomic<bool> quit;
+
+	bool threaded;
+	std::thread thread;
+	std::mutex lock; // only guards the writer going to sleep
+	std::condition_variable wake;
+
+	// main thread
+	demoClosing_t closing[MAX_FILE_HANDLES];
+	int numClosing;
+	int messages;
+	int dropped;
+	int waits; // times the main thread had to wait for room
+	uint64_t peakDepth;
+	int failedWritesReported;
+
+	// writer thread
+	demoFile_t files[MAX_FILE_HANDLES];
+	std::atomic<uint64_t> bytesStaged;
+	std::atomic<uint64_t> bytesWritten;
+	std::atomic<int> writes;
+	std::atomic<int> keyframes;
+	std::atomic<int> slowestWriteMsec;
+	std::atomic<int> failedWrites; // the writer can't print, the main thread reports these
+};
+
+static demoWriter_t* demoWriter = nullptr;
+
+static int SV_DemoRecordSize(const int len)
+{
+	return static_cast<int>(sizeof(demoRecord_t)) + ((len + 7) & ~7);
+}
+
+/*
+==================
+SV_DemoWrite
+
+Writer thread, times a write of one demo file.  Nothing here may print, a
+failure is only counted.
+==================
+*/
+static void SV_DemoWrite(demoWriter_t* w, const fileHandle_t file, const int type, const byte* data, const int len)
+{
+	demoFile_t& df = w->files[file];
+
+	const auto start = std::chrono::steady_clock::now();
+	int written;
+	if (df.archive)
+	{
+		written = Demo_WriteArchiveBlock(file, type, data, len);
+		df.offset += written;
+	}
+	else
+	{
+		written = FS_WriteQuiet(data, len, file);
+	}
+	if (len > 0 && !written)
+	{
+		w->failedWrites++;
+	}
+	const int msec = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - start).count());
+
+	w->bytesWritten += written;
+	w->writes++;
+	if (msec > w->slowestWriteMsec)
+	{
+		w->slowestWriteMsec = msec;
+	}
+}
+
+static void SV_DemoWriteStaged(demoWriter_t* w, const fileHandle_t file)
+{
+	std::vector<byte>& staged = w->files[file].staged;
+
+	if (staged.empty())
+	{
+		return;
+	}
+
+	SV_DemoWrite(w, file, DEMO_BLOCK_MESSAGES, staged.data(), static_cast<int>(staged.size()));
+	staged.clear();
+}
+
+/*
+==================
+SV_DemoConsume
+
+Writer thread, or the main thread without one
+==================
+*/
+static void SV_DemoConsume(demoWriter_t* w, const demoRecord_t* rec)
+{
+	const auto data = reinterpret_cast<const byte*>(rec + 1);
+
+	if (rec->type == DEMO_FLUSH_ALL)
+	{
+		for (int i = 0; i < MAX_FILE_HANDLES; i++)
+		{
+			SV_DemoWriteStaged(w, i);
+		}
+		return;
+	}
+
+	demoFile_t& df = w->files[rec->file];
+
+	switch (rec->type)
+	{
+	case DEMO_OPEN:
+	case DEMO_OPEN_ARCHIVE:
+		df.archive = rec->type == DEMO_OPEN_ARCHIVE ? qtrue : qfalse;
+		df.offset = 0;
+		df.staged.clear();
+		df.keyframes.clear();
+		if (df.archive)
+		{
+			df.offset = Demo_WriteArchiveHeader(rec->file, rec->time);
+			if (!df.offset)
+			{
+				w->failedWrites++;
+			}
+		}
+		break;
+
+	case DEMO_MESSAGE:
+		if (df.staged.empty())
+		{
+			df.stagedSince = std::chrono::steady_clock::now();
+		}
+		df.staged.insert(df.staged.end(), data, data + rec->len);
+		w->bytesStaged += rec->len;
+		if (df.staged.size() >= DEMO_FLUSH_SIZE)
+		{
+			SV_DemoWriteStaged(w, rec->file);
+		}
+		break;
+
+	case DEMO_KEYFRAME:
+	{
+		// a keyframe starts a new block so seeking never inflates what came before
+		SV_DemoWriteStaged(w, rec->file);
+
+		int sequence;
+		Com_Memcpy(&sequence, data, 4);
+
+		demoKeyframe_t keyframe;
+		keyframe.serverTime = rec->time;
+		keyframe.sequence = LittleLong(sequence) + 1;
+		keyframe.offset = df.offset;
+		df.keyframes.push_back(keyframe);
+
+		w->bytesStaged += rec->len;
+		w->keyframes++;
+		SV_DemoWrite(w, rec->file, DEMO_BLOCK_GAMESTATE, data, rec->len);
+		break;
+	}
+
+	case DEMO_CLOSE:
+		SV_DemoWriteStaged(w, rec->file);
+		if (df.archive)
+		{
+			if (!Demo_WriteArchiveIndex(rec->file, df.keyframes.data(), static_cast<int>(df.keyframes.size()),
+				df.offset))
+			{
+				w->failedWrites++;
+			}
+		}
+		df.keyframes.clear();
+		df.keyframes.shrink_to_fit();
+		df.staged.shrink_to_fit();
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+==================
+SV_DemoDrain
+
+Consumes everything queued so far
+==================
+*/
+static void SV_DemoDrain(demoWriter_t* w)
+{
+	uint64_t tail = w->tail.load(std::memory_order_relaxed);
+	const uint64_t head = w->head.load(std::memory_order_acquire);
+
+	while (tail != head)
+	{
+		const auto rec = reinterpret_cast<const demoRecord_t*>(w->ring + (tail & DEMO_QUEUE_MASK));
+
+		if (rec->type == DEMO_PAD)
+		{
+			tail += DEMO_QUEUE_SIZE - (tail & DEMO_QUEUE_MASK);
+		}
+		else
+		{
+			SV_DemoConsume(w, rec);
+			tail += SV_DemoRecordSize(rec->len);
+		}
+
+		// let the main thread reuse the space and close files as early as possible
+		w->tail.store(tail, std::memory_order_release);
+	}
+}
+
+// write out whatever has been sitting for a while
+static void SV_DemoFlushIdle(demoWriter_t* w)
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < MAX_FILE_HANDLES; i++)
+	{
+		if (!w->files[i].staged.empty()
+			&& now - w->files[i].stagedSince >= std::chrono::milliseconds(DEMO_FLUSH_MSEC))
+		{
+			SV_DemoWriteStaged(w, i);
+		}
+	}
+}
+
+static void SV_DemoWriterLoop(demoWriter_t* w)
+{
+	while (true)
+	{
+		const uint64_t tail = w->tail.load(std::memory_order_relaxed);
+
+		if (tail != w->head.load(std::memory_order_acquire))
+		{
+			SV_DemoDrain(w);
+			continue;
+		}
+
+		SV_DemoFlushIdle(w);
+
+		if (w->quit)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lk(w->lock);
+		w->wake.wait_for(lk, std::chrono::milliseconds(100), [&]
+		{
+			return w->quit || w->head.load(std::memory_order_acquire) != tail;
+		});
+	}
+}
+
+/*
+==================
+SV_DemoReserve
+
+Room for a record of len bytes at the head of the ring, NULL if there is none
+and canDrop is set.  SV_DemoCommit publishes it.
+==================
+*/
+static demoRecord_t* SV_DemoReserve(demoWriter_t* w, const int len, const qboolean canDrop, uint64_t* newHead)
+{
+	uint64_t head = w->head.load(std::memory_order_relaxed);
+	const int size = SV_DemoRecordSize(len);
+	const int untilEnd = DEMO_QUEUE_SIZE - static_cast<int>(head & DEMO_QUEUE_MASK);
+	const int needed = size > untilEnd ? untilEnd + size : size;
+
+	// without a writer thread everything queued is consumed right away
+	if (DEMO_QUEUE_SIZE - (head - w->tail.load(std::memory_order_acquire)) < static_cast<uint64_t>(needed))
+	{
+		if (canDrop)
+		{
+			w->dropped++;
+			return nullptr;
+		}
+
+		w->waits++;
+		do
+		{
+			w->wake.notify_one();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		} while (DEMO_QUEUE_SIZE - (head - w->tail.load(std::memory_order_acquire)) < static_cast<uint64_t>(needed));
+	}
+
+	if (size > untilEnd)
+	{
+		reinterpret_cast<demoRecord_t*>(w->ring + (head & DEMO_QUEUE_MASK))->type = DEMO_PAD;
+		head += untilEnd;
+	}
+
+	*newHead = head + size;
+	return reinterpret_cast<demoRecord_t*>(w->ring + (head & DEMO_QUEUE_MASK));
+}
+
+static void SV_DemoCommit(demoWriter_t* w, const uint64_t newHead)
+{
+	w->head.store(newHead, std::memory_order_release);
+
+	const uint64_t depth = newHead - w->tail.load(std::memory_order_relaxed);
+	if (depth > w->peakDepth)
+	{
+		w->peakDepth = depth;
+	}
+
+	if (w->threaded)
+	{
+		w->wake.notify_one();
+	}
+	else
+	{
+		SV_DemoDrain(w);
+	}
+}
+
+/*
+==================
+SV_DemoQueue
+
+Queues a record carrying one demo message: sequence, length and data.  A
+negative len queues just the two words, which is how a demo ends.
+==================
+*/
+static qboolean SV_DemoQueue(const fileHandle_t f, const int type, const int time, const int sequence,
+	const void* data, int len, const qboolean canDrop)
+{
+	const int swSequence = LittleLong(sequence);
+	const int swLen = LittleLong(len);
+
+	if (len < 0)
+	{
+		len = 0;
+	}
+
+	uint64_t newHead;
+	demoRecord_t* rec = SV_DemoReserve(demoWriter, 8 + len, canDrop, &newHead);
+	if (!rec)
+	{
+		return qfalse;
+	}
+
+	rec->file = f;
+	rec->type = type;
+	rec->len = 8 + len;
+	rec->time = time;
+	const auto out = reinterpret_cast<byte*>(rec + 1);
+	Com_Memcpy(out, &swSequence, 4);
+	Com_Memcpy(out + 4, &swLen, 4);
+	if (len)
+	{
+		Com_Memcpy(out + 8, data, len);
+	}
+
+	demoWriter->messages++;
+	SV_DemoCommit(demoWriter, newHead);
+	return qtrue;
+}
+
+// a record without data
+static uint64_t SV_DemoQueueMarker(const fileHandle_t f, const int type, const int time)
+{
+	uint64_t newHead;
+	demoRecord_t* rec = SV_DemoReserve(demoWriter, 0, qfalse, &newHead);
+
+	rec->file = f;
+	rec->type = type;
+	rec->len = 0;
+	rec->time = time;
+	SV_DemoCommit(demoWriter, newHead);
+
+	return newHead;
+}
+
+/*
+==================
+SV_InitDemoWriter
+
+Started with the first demo, sv_demoWriter 0 drains the queue on the main thread
+==================
+*/
+static void SV_InitDemoWriter(void)
+{
+	if (demoWriter)
+	{
+		return;
+	}
+
+	demoWriter = new demoWriter_t;
+	demoWriter->ring = static_cast<byte*>(Z_Malloc(DEMO_QUEUE_SIZE, TAG_GENERAL, qfalse));
+	demoWriter->head = 0;
+	demoWriter->tail = 0;
+	demoWriter->quit = false;
+	demoWriter->threaded = sv_demoWriter->integer != 0;
+	demoWriter->numClosing = 0;
+	demoWriter->messages = 0;
+	demoWriter->dropped = 0;
+	demoWriter->waits = 0;
+	demoWriter->peakDepth = 0;
+	demoWriter->bytesStaged = 0;
+	demoWriter->bytesWritten = 0;
+	demoWriter->writes = 0;
+	demoWriter->keyframes = 0;
+	demoWriter->slowestWriteMsec = 0;
+	demoWriter->failedWrites = 0;
+	demoWriter->failedWritesReported = 0;
+
+	if (demoWriter->threaded)
+	{
+		demoWriter->thread = std::thread(SV_DemoWriterLoop, demoWriter);
+	}
+}
+
+/*
+==================
+SV_OpenDemoFile
+
+f was just opened for writing.  An archive gets keyframes every keyframeMsec
+or so, written with SV_QueueDemoKeyframe.
+==================
+*/
+void SV_OpenDemoFile(const fileHandle_t f, const qboolean archive, const int keyframeMsec)
+{
+	SV_InitDemoWriter();
+	SV_DemoQueueMarker(f, archive ? DEMO_OPEN_ARCHIVE : DEMO_OPEN, keyframeMsec);
+}
+
+/*
+==================
+SV_QueueDemoMessage
+
+Appends a demo message (sequence, length, data) to f.  A negative len writes
+just the two words, which is how a demo ends.  Returns qfalse if the writer is
+so far behind that the message was dropped, which only happens with canDrop.
+==================
+*/
+qboolean SV_QueueDemoMessage(const fileHandle_t f, const int sequence, const void* data, const int len,
+	const qboolean canDrop)
+{
+	return SV_DemoQueue(f, DEMO_MESSAGE, 0, sequence, data, len, canDrop);
+}
+
+/*
+==================
+SV_QueueDemoKeyframe
+
+A gamestate message as of serverTime.  The next message queued for f has to
+be a non-delta snapshot, playing the archive from here starts with the pair.
+Returns qfalse if it was dropped, like SV_QueueDemoMessage.
+==================
+*/
+qboolean SV_QueueDemoKeyframe(const fileHandle_t f, const int serverTime, const int sequence, const void* data,
+	const int len, const qboolean canDrop)
+{
+	return SV_DemoQueue(f, DEMO_KEYFRAME, serverTime, sequence, data, len, canDrop);
+}
+
+/*
+==================
+SV_CloseDemoFile
+
+The file is closed once everything queued for it has been written
+==================
+*/
+void SV_CloseDemoFile(const fileHandle_t f)
+{
+	demoWriter->closing[demoWriter->numClosing].file = f;
+	demoWriter->closing[demoWriter->numClosing].pos = SV_DemoQueueMarker(f, DEMO_CLOSE, 0);
+	demoWriter->numClosing++;
+
+	SV_DemoWriterFrame();
+}
+
+/*
+==================
+SV_DemoWriterFrame
+
+Closes the files the writer is done with and reports its failed writes
+==================
+*/
+void SV_DemoWriterFrame(void)
+{
+	if (!demoWriter)
+	{
+		return;
+	}
+
+	if (!demoWriter->threaded)
+	{
+		SV_DemoFlushIdle(demoWriter);
+	}
+
+	const int failedWrites = demoWriter->failedWrites.load(std::memory_order_relaxed);
+	if (failedWrites != demoWriter->failedWritesReported)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: %i server-side demo writes failed, see svdemostats\n",
+			failedWrites - demoWriter->failedWritesReported);
+		demoWriter->failedWritesReported = failedWrites;
+	}
+
+	const uint64_t tail = demoWriter->tail.load(std::memory_order_acquire);
+	for (int i = 0; i < demoWriter->numClosing;)
+	{
+		if (tail >= demoWriter->closing[i].pos)
+		{
+			FS_FCloseFile(demoWriter->closing[i].file);
+			demoWriter->numClosing--;
+			demoWriter->closing[i] = demoWriter->closing[demoWriter->numClosing];
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/*
+==================
+SV_FlushDemoWriter
+
+Waits until everything queued is on disk and the finished files are closed.
+The writer doesn't touch the filesystem again until more is queued.
+==================
+*/
+void SV_FlushDemoWriter(void)
+{
+	if (!demoWriter)
+	{
+		return;
+	}
+
+	const uint64_t pos = SV_DemoQueueMarker(0, DEMO_FLUSH_ALL, 0);
+
+	while (demoWriter->tail.load(std::memory_order_acquire) != pos)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	SV_DemoWriterFrame();
+}
+
+/*
+==================
+SV_ShutdownDemoWriter
+==================
+*/
+void SV_ShutdownDemoWriter(void)
+{
+	if (!demoWriter)
+	{
+		return;
+	}
+
+	SV_FlushDemoWriter();
+
+	if (demoWriter->threaded)
+	{
+		demoWriter->quit = true;
+		demoWriter->wake.notify_one();
+		demoWriter->thread.join();
+	}
+
+	Z_Free(demoWriter->ring);
+	delete demoWriter;
+	demoWriter = nullptr;
+}
+
+/*
+==================
+SV_DemoWriterStats_f
+==================
+*/
+void SV_DemoWriterStats_f(void)
+{
+	if (!demoWriter)
+	{
+		Com_Printf("No server-side demo has been recorded yet.\n");
+		return;
+	}
+
+	const uint64_t depth = demoWriter->head.load() - demoWriter->tail.load();
+
+	Com_Printf("queue: %i KB of %i KB in use, peak %i KB%s\n",
+		static_cast<int>(depth / 1024), DEMO_QUEUE_SIZE / 1024, static_cast<int>(demoWriter->peakDepth / 1024),
+		demoWriter->threaded ? "" : " (drained on the main thread)");
+	Com_Printf("%i messages queued, %i dropped, %i waits for room, %i keyframes\n",
+		demoWriter->messages, demoWriter->dropped, demoWriter->waits, demoWriter->keyframes.load());
+	Com_Printf("%i KB of messages written as %i KB in %i writes, %i failed, slowest write %i msec\n",
+		static_cast<int>(demoWriter->bytesStaged / 1024), static_cast<int>(demoWriter->bytesWritten / 1024),
+		demoWriter->writes.load(), demoWriter->failedWrites.load(), demoWriter->slowestWriteMsec.load());
+}
@@ -133,6 +133,7 @@ void GVM_ClientThink(const int clientNum, usercmd_t* ucmd)
 
 void GVM_RunFrame(const int levelTime)
 {
+	PROFILE_SCOPE("GVM_RunFrame");
 	if (gvm->isLegacy)
 	{
 		VM_Call(gvm, GAME_RUN_FRAME, levelTime);
@@ -1449,6 +1450,7 @@ static int SV_BotLibDefine(char* string)
 
 static int SV_BotLibStartFrame(const float time)
 {
+	PROFILE_SCOPE("BotLibStartFrame");
 	return botlib_export->BotLibStartFrame(time);
 }
 
@@ -1459,6 +1461,7 @@ static int SV_BotLibLoadMap(const char* mapname)
 
 static int SV_BotLibUpdateEntity(const int ent, void* bue)
 {
+	PROFILE_SCOPE("BotLibUpdateEntity");
 	return botlib_export->BotLibUpdateEntity(ent, static_cast<bot_entitystate_t*>(bue));
 }
 
@@ -1835,6 +1838,7 @@ static void SV_G2API_CollisionDetect(CollisionRecord_t* collRecMap, void* ghoul2
 	vec3_t rayEnd, vec3_t scale, const int traceFlags, const int useLod,
 	const float fRadius)
 {
+	PROFILE_SCOPE("G2_CollisionDetect");
 	re->G2API_CollisionDetect(collRecMap, *static_cast<CGhoul2Info_v*>(ghoul2), angles, position, frameNumber, entNum,
 		rayStart, rayEnd, scale, G2VertSpaceServer, traceFlags, useLod, fRadius);
 }
@@ -1844,6 +1848,7 @@ static void SV_G2API_CollisionDetectCache(CollisionRecord_t* collRecMap, void* g
 	vec3_t rayStart, vec3_t rayEnd, vec3_t scale, const int traceFlags,
 	const int useLod, const float fRadius)
 {
+	PROFILE_SCOPE("G2_CollisionDetect");
 	re->G2API_CollisionDetectCache(collRecMap, *static_cast<CGhoul2Info_v*>(ghoul2), angles, position, frameNumber,
 		entNum, rayStart, rayEnd, scale, G2VertSpaceServer, traceFlags, useLod, fRadius);
 }
@@ -2635,11 +2640,11 @@ intptr_t SV_GameSystemCalls(intptr_t* args)
 		return botlib_export->PC_SourceFileAndLine(args[1], static_cast<char*>(VMA(2)), static_cast<int*>(VMA(3)));
 
 	case BOTLIB_START_FRAME:
-		return botlib_export->BotLibStartFrame(VMF(1));
+		return SV_BotLibStartFrame(VMF(1));
 	case BOTLIB_LOAD_MAP:
 		return botlib_export->BotLibLoadMap(static_cast<const char*>(VMA(1)));
 	case BOTLIB_UPDATENTITY:
-		return botlib_export->BotLibUpdateEntity(args[1], static_cast<bot_entitystate_s*>(VMA(2)));
+		return SV_BotLibUpdateEntity(args[1], VMA(2));
 	case BOTLIB_TEST:
 		return botlib_export->Test(args[1], static_cast<char*>(VMA(2)), static_cast<float*>(VMA(3)),
 			static_cast<float*>(VMA(4)));
@@ -3170,20 +3175,20 @@ intptr_t SV_GameSystemCalls(intptr_t* args)
 		return 0;
 
 	case G_G2_COLLISIONDETECT:
-		re->G2API_CollisionDetect(static_cast<CollisionRecord_t*>(VMA(1)), *reinterpret_cast<CGhoul2Info_v*>(args[2]),
+		SV_G2API_CollisionDetect(static_cast<CollisionRecord_t*>(VMA(1)), reinterpret_cast<void*>(args[2]),
 			static_cast<const float*>(VMA(3)), static_cast<const float*>(VMA(4)), args[5],
 			args[6],
 			static_cast<float*>(VMA(7)), static_cast<float*>(VMA(8)), static_cast<float*>(VMA(9)),
-			G2VertSpaceServer, args[10], args[11], VMF(12));
+			args[10], args[11], VMF(12));
 		return 0;
 
 	case G_G2_COLLISIONDETECTCACHE:
-		re->G2API_CollisionDetectCache(static_cast<CollisionRecord_t*>(VMA(1)), *reinterpret_cast<CGhoul2Info_v*>(args[2]),
+		SV_G2API_CollisionDetectCache(static_cast<CollisionRecord_t*>(VMA(1)), reinterpret_cast<void*>(args[2]),
 			static_cast<const float*>(VMA(3)), static_cast<const float*>(VMA(4)), args[5],
 			args[6],
 			static_cast<float*>(VMA(7)), static_cast<float*>(VMA(8)),
 			static_cast<float*>(VMA(9)),
-			G2VertSpaceServer, args[10], args[11], VMF(12));
+			args[10], args[11], VMF(12));
 		return 0;
 
 	case G_G2_SETROOTSURFACE:
@@ -3358,6 +3363,10 @@ intptr_t SV_GameSystemCalls(intptr_t* args)
 		SV_BotCalculatePaths(args[1]);
 		return 0;
 
+	case G_TRACEBATCH:
+		SV_TraceBatch(static_cast<const traceRequest_t*>(VMA(1)), static_cast<trace_t*>(VMA(2)), args[3]);
+		return 0;
+
 	case G_GET_ENTITY_TOKEN:
 		return SV_GetEntityToken(static_cast<char*>(VMA(1)), args[2]);
 
@@ -3420,6 +3429,7 @@ void SV_BindGame(void)
 		gi.EntitiesInBox = SV_AreaEntities;
 		gi.EntityContact = SV_EntityContact;
 		gi.Trace = SV_Trace;
+		gi.TraceBatch = SV_TraceBatch;
 		gi.GetConfigstring = SV_GetConfigstring;
 		gi.GetEntityToken = SV_GetEntityToken;
 		gi.GetServerinfo = SV_GetServerinfo;
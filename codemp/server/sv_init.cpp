@@ -480,6 +480,48 @@ void SV_SendMapChange(void)
 	}
 }
 
+/*
+================
+SV_PreloadMapFiles
+
+Files the server opens for every map, the collision map first since
+CM_LoadMap wants it soonest.  Queued as soon as the filesystem restarts, so
+the rest of the clearing runs while they decode.
+================
+*/
+static void SV_PreloadMapFiles(const char* mapname)
+{
+	FS_PreloadFile(va("maps/%s.bsp", mapname));
+	FS_PreloadFile(va("maps/%s.nav", mapname));
+	FS_PreloadFile(va("botroutes/%s.wnt", mapname));
+	FS_PreloadFile(va("botroutes/%s.wnr", mapname));
+	FS_StartPreload();
+}
+
+/*
+================
+SV_PreloadModelFiles
+
+Ghoul2 models the game registered while starting up.  The ones it first
+instances during the settling frames, bots, NPCs and vehicles mostly, find
+them decoded.  One the model cache still holds from an earlier map is decoded
+for nothing and dropped by FS_FinishPreload.
+================
+*/
+static void SV_PreloadModelFiles(void)
+{
+	for (int i = 1; i < MAX_MODELS; i++)
+	{
+		const char* name = sv.configstrings[CS_MODELS + i];
+
+		if (name && name[0] && !Q_stricmp(COM_GetExtension(name), "glm"))
+		{
+			FS_PreloadFile(name);
+		}
+	}
+	FS_StartPreload();
+}
+
 extern void SV_SendClientGameState(client_t* client);
 /*
 ================
@@ -497,6 +539,7 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 	qboolean isBot;
 	char systemInfo[16384];
 	const char* p;
+	const int loadStart = Sys_Milliseconds();
 
 	SV_StopAutoRecordDemos();
 
@@ -569,6 +612,21 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 	// clear pak references
 	FS_ClearPakReferences(0);
 
+	// get a new checksum feed and restart the file system; sv is wiped below,
+	// so the feed is kept aside until then
+	srand(Com_Milliseconds());
+	const int checksumFeed = rand() << 16 ^ rand() ^ Com_Milliseconds();
+	const int fsStart = Sys_Milliseconds();
+	SV_FlushDemoWriter();
+	FS_Restart(checksumFeed);
+
+	// the collision map and friends decode while the rest is cleared
+	if (sv_mapPreload->integer)
+	{
+		SV_PreloadMapFiles(server);
+	}
+	const int fsTime = Sys_Milliseconds();
+
 	/*
 	Ghoul2 Insert Start
 	*/
@@ -609,6 +667,7 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 	{
 		sv.configstrings[i] = CopyString("");
 	}
+	sv.checksumFeed = checksumFeed;
 
 	//rww - RAGDOLL_BEGIN
 	re->G2API_SetTime(sv.time, 0);
@@ -617,12 +676,9 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 	// make sure we are not paused
 	Cvar_Set("cl_paused", "0");
 
-	// get a new checksum feed and restart the file system
-	srand(Com_Milliseconds());
-	sv.checksumFeed = rand() << 16 ^ rand() ^ Com_Milliseconds();
-	FS_Restart(sv.checksumFeed);
-
+	const int clearTime = Sys_Milliseconds();
 	CM_LoadMap(va("maps/%s.bsp", server), qfalse, &checksum);
+	const int cmTime = Sys_Milliseconds();
 
 	SV_SendMapChange();
 
@@ -649,6 +705,12 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 
 	// load and spawn all other entities
 	SV_InitGameProgs();
+	const int gameTime = Sys_Milliseconds();
+
+	if (sv_mapPreload->integer)
+	{
+		SV_PreloadModelFiles();
+	}
 
 	// don't allow a map_restart if game is modified
 	sv_gametype->modified = qfalse;
@@ -732,6 +794,12 @@ void SV_SpawnServer(char* server, const qboolean killBots, const ForceReload_e e
 	re->G2API_SetTime(sv.time, 0);
 	//rww - RAGDOLL_END
 
+	const int settleTime = Sys_Milliseconds();
+	FS_FinishPreload(qtrue);
+	Com_Printf("Map load took %i msec: %i clearing, %i filesystem, %i collision map, %i game init, %i settling\n",
+		settleTime - loadStart, clearTime - loadStart - (fsTime - fsStart), fsTime - fsStart, cmTime - clearTime,
+		gameTime - cmTime, settleTime - gameTime);
+
 	if (sv_pure->integer)
 	{
 		// the server sends these to the clients so they will only
@@ -1022,6 +1090,15 @@ void SV_Init(void)
 	Cvar_Get("sv_cheats", "1", CVAR_SYSTEMINFO | CVAR_ROM, "Allow cheats on server if set to 1");
 	sv_serverid = Cvar_Get("sv_serverid", "0", CVAR_SYSTEMINFO | CVAR_ROM);
 	sv_pure = Cvar_Get("sv_pure", "0", CVAR_SYSTEMINFO, "Pure server");
+	sv_mapPreload = Cvar_Get("sv_mapPreload", "1", CVAR_ARCHIVE_ND,
+		"Decode the new map's collision map, navigation, bot route and ghoul2 model files on the job threads while it loads");
+	sv_demoWriter = Cvar_Get("sv_demoWriter", "1", CVAR_ARCHIVE_ND,
+		"Write server-side demos on a separate thread");
+	sv_demoArchive = Cvar_Get("sv_demoArchive", "0", CVAR_ARCHIVE_ND,
+		"Record server-side demos as compressed .dmz archives that can be played from any keyframe");
+	sv_demoKeyframeInterval = Cvar_Get("sv_demoKeyframeInterval", "10", CVAR_ARCHIVE_ND,
+		"Seconds between keyframes in server-side demo archives, each one costs the recorded client full "
+		"non-delta snapshots until it acknowledges one");
 	Cvar_Get("sv_paks", "", CVAR_SYSTEMINFO | CVAR_ROM);
 	Cvar_Get("sv_pakNames", "", CVAR_SYSTEMINFO | CVAR_ROM);
 	Cvar_Get("sv_referencedPaks", "", CVAR_SYSTEMINFO | CVAR_ROM);
@@ -1066,6 +1143,15 @@ void SV_Init(void)
 
 	sv_banFile = Cvar_Get("sv_banFile", "serverbans.dat", CVAR_ARCHIVE, "File to use to store bans and exceptions");
 
+	sv_parallelSnapshots = Cvar_Get("sv_parallelSnapshots", "0", CVAR_ARCHIVE_ND,
+		"Build and encode client snapshots on the job workers (see com_jobThreads)");
+
+	sv_broadphase = Cvar_Get("sv_broadphase", "0", CVAR_ARCHIVE_ND,
+		"Entity broadphase for traces and area queries (0 = sector tree, 1 = AABB tree, which can pick a different entity on exact ties)");
+
+	sv_parallelTraces = Cvar_Get("sv_parallelTraces", "0", CVAR_ARCHIVE_ND,
+		"Run the game's batched traces on the job workers (see com_jobThreads)");
+
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
 
@@ -1144,6 +1230,19 @@ void SV_Shutdown(char* finalmsg)
 	SV_MasterShutdown();
 	SV_ChallengeShutdown();
 	SV_ShutdownGameProgs();
+
+	// finish the demos still recording, an archive needs its index
+	if (svs.clients)
+	{
+		for (int i = 0; i < sv_maxclients->integer; i++)
+		{
+			if (svs.clients[i].demo.demorecording)
+			{
+				SV_StopRecordDemo(&svs.clients[i]);
+			}
+		}
+	}
+	SV_ShutdownDemoWriter();
 	svs.gameStarted = qfalse;
 	/*
 	Ghoul2 Insert Start
@@ -59,6 +59,10 @@ cvar_t* sv_minPing;
 cvar_t* sv_maxPing;
 cvar_t* sv_gametype;
 cvar_t* sv_pure;
+cvar_t* sv_mapPreload;
+cvar_t* sv_demoWriter;
+cvar_t* sv_demoArchive;
+cvar_t* sv_demoKeyframeInterval;
 cvar_t* sv_floodProtect;
 cvar_t* sv_lanForceRate; // dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
 cvar_t* sv_needpass;
@@ -68,6 +72,9 @@ cvar_t* sv_autoDemoBots;
 cvar_t* sv_autoDemoMaxMaps;
 cvar_t* sv_legacyFixes;
 cvar_t* sv_banFile;
+cvar_t* sv_parallelSnapshots; // build and encode client snapshots on the job workers
+cvar_t* sv_broadphase; // 0 = sector tree, 1 = AABB tree for entity traces and area queries
+cvar_t* sv_parallelTraces; // run batched game traces on the job workers
 
 serverBan_t serverBans[SERVER_MAXBANS];
 int serverBansCount = 0;
@@ -1254,6 +1261,7 @@ happen before SV_Frame is called
 */
 void SV_Frame(const int msec)
 {
+	PROFILE_SCOPE("SV_Frame");
 	int startTime;
 
 	// the menu kills the server with this cvar
@@ -1368,6 +1376,7 @@ void SV_Frame(const int msec)
 
 	// send messages back to the clients
 	SV_SendClientMessages();
+	SV_DemoWriterFrame();
 
 	SV_CheckCvars();
 
@@ -24,6 +24,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server.h"
 #include "qcommon/cm_public.h"
 
+#include <atomic>
+
 /*
 =============================================================================
 
@@ -46,6 +48,134 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Entity delta cache
+
+Every snapshot built in the same pass copies the same entity states, so two
+clients sending entity e from the baseline, or from frames stored in the same
+earlier pass, produce identical delta bits.  Each distinct delta is encoded
+once per pass and bit-copied into every message that needs it.
+
+=============================================================================
+*/
+
+#define	ENTITY_DELTA_SLOTS			4			// distinct from-passes cached per entity
+#define	ENTITY_DELTA_ARENA_SIZE		0x80000
+#define	MAX_ENTITY_DELTA_BYTES		2048
+
+#define	BASELINE_GENERATION			0			// entityGeneration 0 is never handed out
+
+using entityDeltaSlot_t = struct entityDeltaSlot_s
+{
+	// generation << 1, plus 1 once bits are ready to be copied
+	std::atomic<unsigned> tag;
+	unsigned fromGeneration;
+	int numBits;
+	int offset; // into entityDeltaArena
+};
+
+static entityDeltaSlot_t entityDeltaSlots[MAX_GENTITIES][ENTITY_DELTA_SLOTS];
+static byte entityDeltaArena[ENTITY_DELTA_ARENA_SIZE];
+static std::atomic<int> entityDeltaArenaUsed;
+
+static unsigned sv_snapshotGeneration;
+
+/*
+=============
+SV_NewSnapshotGeneration
+
+Starts a snapshot pass.  The game must not run again until every snapshot of
+the pass has been stored, and cached deltas from earlier passes go stale.
+=============
+*/
+static void SV_NewSnapshotGeneration(void)
+{
+	if (++sv_snapshotGeneration >= 0x7FFFFFFF)
+	{
+		// tags are generation << 1, start over before that wraps
+		for (auto& entitySlots : entityDeltaSlots)
+		{
+			for (auto& slot : entitySlots)
+			{
+				slot.tag = 0;
+			}
+		}
+		sv_snapshotGeneration = 1;
+	}
+	entityDeltaArenaUsed = 0;
+}
+
+/*
+=============
+SV_WriteCachedDeltaEntity
+
+MSG_WriteDeltaEntity for states stored in the current pass, going through
+the delta cache.  Safe to call from the snapshot jobs.
+=============
+*/
+static void SV_WriteCachedDeltaEntity(msg_t* msg, entityState_t* from, const unsigned fromGeneration,
+	entityState_t* to, const qboolean force)
+{
+	entityDeltaSlot_t* slots = entityDeltaSlots[to->number];
+	const unsigned busy = sv_snapshotGeneration << 1;
+	const unsigned ready = busy | 1;
+	int i;
+
+	for (i = 0; i < ENTITY_DELTA_SLOTS; i++)
+	{
+		if (slots[i].tag.load(std::memory_order_acquire) == ready && slots[i].fromGeneration == fromGeneration)
+		{
+			MSG_WriteEncodedBits(msg, entityDeltaArena + slots[i].offset, slots[i].numBits);
+			return;
+		}
+	}
+
+	// claim a slot left over from an earlier pass
+	entityDeltaSlot_t* slot = nullptr;
+	for (i = 0; i < ENTITY_DELTA_SLOTS; i++)
+	{
+		unsigned tag = slots[i].tag.load(std::memory_order_relaxed);
+		if (tag >> 1 != sv_snapshotGeneration && slots[i].tag.compare_exchange_strong(tag, busy))
+		{
+			slot = &slots[i];
+			break;
+		}
+	}
+
+	if (!slot)
+	{
+		// every slot taken this pass, or another client is encoding it right now
+		MSG_WriteDeltaEntity(msg, from, to, force);
+		return;
+	}
+
+	byte scratchBuf[MAX_ENTITY_DELTA_BYTES];
+	msg_t scratch;
+
+	MSG_Init(&scratch, scratchBuf, sizeof scratchBuf);
+	scratch.allowoverflow = qtrue;
+	MSG_WriteDeltaEntity(&scratch, from, to, force);
+
+	const int numBytes = (scratch.bit + 7) >> 3;
+	const int offset = scratch.overflowed ? ENTITY_DELTA_ARENA_SIZE : entityDeltaArenaUsed.fetch_add(numBytes);
+	if (offset + numBytes > ENTITY_DELTA_ARENA_SIZE)
+	{
+		// leave the slot claimed so nobody else tries for the rest of the pass
+		MSG_WriteDeltaEntity(msg, from, to, force);
+		return;
+	}
+
+	Com_Memcpy(entityDeltaArena + offset, scratchBuf, numBytes);
+	slot->fromGeneration = fromGeneration;
+	slot->numBits = scratch.bit;
+	slot->offset = offset;
+	slot->tag.store(ready, std::memory_order_release);
+
+	MSG_WriteEncodedBits(msg, scratchBuf, scratch.bit);
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -99,7 +229,14 @@ static void SV_EmitPacketEntities(clientSnapshot_t* from, clientSnapshot_t* to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			if (from->entityGeneration != BASELINE_GENERATION && to->entityGeneration == sv_snapshotGeneration)
+			{
+				SV_WriteCachedDeltaEntity(msg, oldent, from->entityGeneration, newent, qfalse);
+			}
+			else
+			{
+				MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			}
 			oldindex++;
 			newindex++;
 			continue;
@@ -108,7 +245,14 @@ static void SV_EmitPacketEntities(clientSnapshot_t* from, clientSnapshot_t* to,
 		if (newnum < oldnum)
 		{
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
+			if (to->entityGeneration == sv_snapshotGeneration)
+			{
+				SV_WriteCachedDeltaEntity(msg, &sv.svEntities[newnum].baseline, BASELINE_GENERATION, newent, qtrue);
+			}
+			else
+			{
+				MSG_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
+			}
 			newindex++;
 			continue;
 		}
@@ -126,17 +270,18 @@ static void SV_EmitPacketEntities(clientSnapshot_t* from, clientSnapshot_t* to,
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SelectSnapshotDelta
+
+Picks the frame the current snapshot will be delta compressed against.
+Must run after the entities of every snapshot built this frame have been
+stored, so the rolled off check sees the final svs.nextSnapshotEntities.
 ==================
 */
-static void SV_WriteSnapshotToClient(client_t* client, msg_t* msg)
+static void SV_SelectSnapshotDelta(client_t* client, clientSnapshot_t** deltaFrame, int* deltaNum)
 {
 	clientSnapshot_t* oldframe;
 	int lastframe;
 
-	// this is the snapshot we are creating
-	clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
-
 	// bots never acknowledge, but it doesn't matter since the only use case is for serverside demos
 	// in which case we can delta against the very last message every time
 	const int deltaMessage = client->deltaMessage;
@@ -199,6 +344,20 @@ static void SV_WriteSnapshotToClient(client_t* client, msg_t* msg)
 		client->demo.demowaiting = qfalse;
 	}
 
+	*deltaFrame = oldframe;
+	*deltaNum = lastframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient(client_t* client, clientSnapshot_t* oldframe, const int lastframe, msg_t* msg)
+{
+	// this is the snapshot we are creating
+	clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	MSG_WriteByte(msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -346,8 +505,12 @@ using snapshotEntityNumbers_t = struct snapshotEntityNumbers_s
 {
 	int numSnapshotEntities;
 	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte added[MAX_GENTITIES / 8]; // used to prevent double adding from portal views
 };
 
+#define ENTITY_BIT_TEST(bits, num)	((bits)[(num) >> 3] & (1 << ((num) & 7)))
+#define ENTITY_BIT_SET(bits, num)	((bits)[(num) >> 3] |= (1 << ((num) & 7)))
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -376,14 +539,14 @@ static int QDECL SV_QsortEntityNumbers(const void* a, const void* b)
 SV_AddEntToSnapshot
 ===============
 */
-static void SV_AddEntToSnapshot(svEntity_t* svEnt, sharedEntity_t* gEnt, snapshotEntityNumbers_t* eNums)
+static void SV_AddEntToSnapshot(sharedEntity_t* gEnt, snapshotEntityNumbers_t* eNums)
 {
 	// if we have already added this entity to this snapshot, don't add again
-	if (svEnt->snapshotCounter == sv.snapshotCounter)
+	if (ENTITY_BIT_TEST(eNums->added, gEnt->s.number))
 	{
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	ENTITY_BIT_SET(eNums->added, gEnt->s.number);
 
 	// if we are full, silently discard entities
 	if (eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES)
@@ -395,6 +558,37 @@ static void SV_AddEntToSnapshot(svEntity_t* svEnt, sharedEntity_t* gEnt, snapsho
 	eNums->numSnapshotEntities++;
 }
 
+/*
+===============
+SV_MarkBroadcastEntities
+
+Finds the entities that can be sent regardless of the PVS, so that the
+per client pass only has to add the ones in its visible clusters
+===============
+*/
+static byte sv_broadcastEntities[MAX_GENTITIES / 8];
+
+static void SV_MarkBroadcastEntities(void)
+{
+	Com_Memset(sv_broadcastEntities, 0, sizeof sv_broadcastEntities);
+
+	for (int e = 0; e < sv.num_entities; e++)
+	{
+		const sharedEntity_t* ent = SV_GentityNum(e);
+
+		if (!ent->r.linked)
+		{
+			continue;
+		}
+
+		if (ent->r.svFlags & SVF_BROADCAST || ent->s.isPortalEnt
+			|| ent->r.broadcastClients[0] || ent->r.broadcastClients[1])
+		{
+			ENTITY_BIT_SET(sv_broadcastEntities, e);
+		}
+	}
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -424,8 +618,24 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t* fram
 
 	const byte* clientpvs = CM_ClusterPVS(clientcluster);
 
+	// only entities in a visible cluster, or that may be sent anyway, need the full test
+	byte candidates[MAX_GENTITIES / 8];
+	Com_Memcpy(candidates, sv_broadcastEntities, sizeof candidates);
+	SV_MarkPVSEntities(clientpvs, candidates);
+
 	for (int e = 0; e < sv.num_entities; e++)
 	{
+		if (!candidates[e >> 3])
+		{
+			e |= 7;
+			continue;
+		}
+
+		if (!ENTITY_BIT_TEST(candidates, e))
+		{
+			continue;
+		}
+
 		sharedEntity_t* ent = SV_GentityNum(e);
 
 		// never send entities that aren't linked in
@@ -469,14 +679,14 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t* fram
 			}
 		}
 
-		svEntity_t* svEnt = SV_SvEntityForGentity(ent);
-
 		// don't double add an entity through portals
-		if (svEnt->snapshotCounter == sv.snapshotCounter)
+		if (ENTITY_BIT_TEST(eNums->added, e))
 		{
 			continue;
 		}
 
+		svEntity_t* svEnt = SV_SvEntityForGentity(ent);
+
 		// entities can request not to be sent to certain clients (NOTE: always send to ourselves)
 		if (e != frame->ps.clientNum && ent->r.svFlags & SVF_BROADCASTCLIENTS
 			&& !(ent->r.broadcastClients[frame->ps.clientNum / 32] & 1 << frame->ps.clientNum % 32))
@@ -487,14 +697,14 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t* fram
 		if (ent->r.svFlags & SVF_BROADCAST || e == frame->ps.clientNum
 			|| ent->r.broadcastClients[frame->ps.clientNum / 32] & 1 << frame->ps.clientNum % 32)
 		{
-			SV_AddEntToSnapshot(svEnt, ent, eNums);
+			SV_AddEntToSnapshot(ent, eNums);
 			continue;
 		}
 
 		if (ent->s.isPortalEnt)
 		{
 			//rww - portal entities are always sent as well
-			SV_AddEntToSnapshot(svEnt, ent, eNums);
+			SV_AddEntToSnapshot(ent, eNums);
 			continue;
 		}
 
@@ -571,7 +781,7 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t* fram
 		}
 
 		// add it
-		SV_AddEntToSnapshot(svEnt, ent, eNums);
+		SV_AddEntToSnapshot(ent, eNums);
 
 		// if its a portal entity, add everything visible from its camera position
 		if (ent->r.svFlags & SVF_PORTAL)
@@ -592,7 +802,7 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t* fram
 
 /*
 =============
-SV_BuildClientSnapshot
+SV_BuildClientSnapshotEntities
 
 Decides which entities are going to be visible to the client, and
 copies off the playerstate and areabits.
@@ -601,25 +811,24 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, client can be something other than client->gentity
+
+Only touches the client's own frame and entityNumbers, so it can run for
+several clients at once.  The chosen entity states are copied out by
+SV_StoreSnapshotEntities.
 =============
 */
-static void SV_BuildClientSnapshot(client_t* client)
+static void SV_BuildClientSnapshotEntities(client_t* client, snapshotEntityNumbers_t* entityNumbers)
 {
+	PROFILE_SCOPE("SV_BuildClientSnapshot");
 	vec3_t org;
-	snapshotEntityNumbers_t entityNumbers{};
 	int i;
-	sharedEntity_t* ent;
-	entityState_t* state;
-	svEntity_t* svEnt;
-
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
 
 	// this is the frame we are creating
 	clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	Com_Memset(entityNumbers->added, 0, sizeof entityNumbers->added);
 	Com_Memset(frame->areabits, 0, sizeof frame->areabits);
 
 	frame->num_entities = 0;
@@ -663,8 +872,7 @@ static void SV_BuildClientSnapshot(client_t* client)
 	{
 		Com_Error(ERR_DROP, "SV_SvEntityForGentity: bad gEnt");
 	}
-	svEnt = &sv.svEntities[clientNum];
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	ENTITY_BIT_SET(entityNumbers->added, clientNum);
 
 	// find the client's viewpoint
 	VectorCopy(ps->origin, org);
@@ -672,14 +880,14 @@ static void SV_BuildClientSnapshot(client_t* client)
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint(org, frame, &entityNumbers, qfalse);
+	SV_AddEntitiesVisibleFromPoint(org, frame, entityNumbers, qfalse);
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort(entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof entityNumbers.snapshotEntities[0], SV_QsortEntityNumbers);
+	qsort(entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+		sizeof entityNumbers->snapshotEntities[0], SV_QsortEntityNumbers);
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -687,25 +895,64 @@ static void SV_BuildClientSnapshot(client_t* client)
 	{
 		reinterpret_cast<int*>(frame->areabits)[i] = reinterpret_cast<int*>(frame->areabits)[i] ^ -1;
 	}
+}
+
+/*
+=============
+SV_ReserveSnapshotEntities
+
+Claims a run of the circular svs.snapshotEntities for the frame
+=============
+*/
+static void SV_ReserveSnapshotEntities(client_t* client, const snapshotEntityNumbers_t* entityNumbers)
+{
+	clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
-	// copy the entity states out
-	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for (i = 0; i < entityNumbers.numSnapshotEntities; i++)
+	frame->num_entities = entityNumbers->numSnapshotEntities;
+	frame->entityGeneration = sv_snapshotGeneration;
+
+	svs.nextSnapshotEntities += entityNumbers->numSnapshotEntities;
+	// this should never hit, map should always be restarted first in SV_Frame
+	if (svs.nextSnapshotEntities >= 0x7FFFFFFE)
 	{
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
+		Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
+	}
+}
+
+/*
+=============
+SV_StoreSnapshotEntities
+
+Copies the entity states out into the run claimed by SV_ReserveSnapshotEntities
+=============
+*/
+static void SV_StoreSnapshotEntities(client_t* client, const snapshotEntityNumbers_t* entityNumbers)
+{
+	const clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+	for (int i = 0; i < frame->num_entities; i++)
+	{
+		const sharedEntity_t* ent = SV_GentityNum(entityNumbers->snapshotEntities[i]);
+		entityState_t* state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
 		*state = ent->s;
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if (svs.nextSnapshotEntities >= 0x7FFFFFFE)
-		{
-			Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
-		}
-		frame->num_entities++;
 	}
 }
 
+/*
+=============
+SV_BuildClientSnapshot
+=============
+*/
+static void SV_BuildClientSnapshot(client_t* client)
+{
+	snapshotEntityNumbers_t entityNumbers;
+
+	SV_BuildClientSnapshotEntities(client, &entityNumbers);
+	SV_ReserveSnapshotEntities(client, &entityNumbers);
+	SV_StoreSnapshotEntities(client, &entityNumbers);
+}
+
 /*
 ====================
 SV_RateMsec
@@ -841,65 +1088,68 @@ void SV_SendMessageToClient(msg_t* msg, client_t* client)
 
 /*
 =======================
-SV_SendClientSnapshot
-
-Also called by SV_FinalMessage
+SV_SendClientGamedir
 
+rww - if the client hasn't been told the game dir yet then make sure there
+is an svc_setgame sent before the next snap
 =======================
 */
 extern cvar_t* fs_gamedirvar;
 
-void SV_SendClientSnapshot(client_t* client)
+static void SV_SendClientGamedir(client_t* client)
 {
 	byte msg_buf[MAX_MSGLEN];
 	msg_t msg;
+	int i = 0;
 
-	if (!client->sentGamedir)
-	{
-		//rww - if this is the case then make sure there is an svc_setgame sent before this snap
-		int i = 0;
-
-		MSG_Init(&msg, msg_buf, sizeof msg_buf);
+	MSG_Init(&msg, msg_buf, sizeof msg_buf);
 
-		//have to include this for each message.
-		MSG_WriteLong(&msg, client->lastClientCommand);
+	//have to include this for each message.
+	MSG_WriteLong(&msg, client->lastClientCommand);
 
-		MSG_WriteByte(&msg, svc_setgame);
+	MSG_WriteByte(&msg, svc_setgame);
 
-		const char* gamedir = FS_GetCurrentGameDir(true);
+	const char* gamedir = FS_GetCurrentGameDir(true);
 
-		while (gamedir[i])
-		{
-			MSG_WriteByte(&msg, gamedir[i]);
-			i++;
-		}
-		MSG_WriteByte(&msg, 0);
+	while (gamedir[i])
+	{
+		MSG_WriteByte(&msg, gamedir[i]);
+		i++;
+	}
+	MSG_WriteByte(&msg, 0);
 
-		// MW - my attempt to fix illegible server message errors caused by
-		// packet fragmentation of initial snapshot.
-		//rww - reusing this code here
-		while (client->state && client->netchan.unsentFragments)
-		{
-			// send additional message fragments if the last message
-			// was too large to send at once
-			Com_Printf("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
-			SV_Netchan_TransmitNextFragment(&client->netchan);
-		}
+	// MW - my attempt to fix illegible server message errors caused by
+	// packet fragmentation of initial snapshot.
+	//rww - reusing this code here
+	while (client->state && client->netchan.unsentFragments)
+	{
+		// send additional message fragments if the last message
+		// was too large to send at once
+		Com_Printf("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
+		SV_Netchan_TransmitNextFragment(&client->netchan);
+	}
 
-		// record information about the message
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
+	// record information about the message
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
-		// send the datagram
-		SV_Netchan_Transmit(client, &msg); //msg->cursize, msg->data );
+	// send the datagram
+	SV_Netchan_Transmit(client, &msg); //msg->cursize, msg->data );
 
-		client->sentGamedir = qtrue;
-	}
+	client->sentGamedir = qtrue;
+}
 
-	// build the snapshot
-	SV_BuildClientSnapshot(client);
+/*
+=======================
+SV_ShouldSendSnapshot
 
+Starts any pending auto demos and returns qfalse for bots that only need
+their snapshot built, since they query it directly without it being sent
+=======================
+*/
+static qboolean SV_ShouldSendSnapshot(client_t* client)
+{
 	if (sv_autoDemo->integer && !client->demo.demorecording)
 	{
 		if (client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer)
@@ -908,38 +1158,216 @@ void SV_SendClientSnapshot(client_t* client)
 		}
 	}
 
-	// bots need to have their snapshots built, but
-	// they query them directly without needing to be sent
 	if (client->netchan.remoteAddress.type == NA_BOT && !client->demo.demorecording)
 	{
-		return;
+		return qfalse;
 	}
 
-	MSG_Init(&msg, msg_buf, sizeof msg_buf);
-	msg.allowoverflow = qtrue;
+	return qtrue;
+}
+
+/*
+=======================
+SV_WriteClientSnapshotMessage
 
+Writes everything but download data for a snapshot message into msg
+=======================
+*/
+static void SV_WriteClientSnapshotMessage(client_t* client, clientSnapshot_t* oldframe, const int lastframe, msg_t* msg)
+{
 	// NOTE, MRE: all server->client messages now acknowledge
 	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong(&msg, client->lastClientCommand);
+	MSG_WriteLong(msg, client->lastClientCommand);
 
 	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient(client, &msg);
+	SV_UpdateServerCommandsToClient(client, msg);
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient(client, &msg);
+	SV_WriteSnapshotToClient(client, oldframe, lastframe, msg);
+}
+
+/*
+=======================
+SV_FinishClientSnapshot
 
+Adds any download data and sends the message
+=======================
+*/
+static void SV_FinishClientSnapshot(client_t* client, msg_t* msg)
+{
 	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient(client, &msg);
+	SV_WriteDownloadToClient(client, msg);
 
 	// check for overflow
-	if (msg.overflowed)
+	if (msg->overflowed)
 	{
 		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear(&msg);
+		MSG_Clear(msg);
+	}
+
+	SV_SendMessageToClient(msg, client);
+}
+
+/*
+=======================
+SV_BuildAndSendClientSnapshot
+=======================
+*/
+static void SV_BuildAndSendClientSnapshot(client_t* client)
+{
+	byte msg_buf[MAX_MSGLEN];
+	msg_t msg;
+	clientSnapshot_t* oldframe;
+	int lastframe;
+
+	if (!client->sentGamedir)
+	{
+		SV_SendClientGamedir(client);
 	}
 
-	SV_SendMessageToClient(&msg, client);
+	// build the snapshot
+	SV_BuildClientSnapshot(client);
+
+	if (!SV_ShouldSendSnapshot(client))
+	{
+		return;
+	}
+
+	SV_SelectSnapshotDelta(client, &oldframe, &lastframe);
+
+	MSG_Init(&msg, msg_buf, sizeof msg_buf);
+	msg.allowoverflow = qtrue;
+
+	SV_WriteClientSnapshotMessage(client, oldframe, lastframe, &msg);
+
+	SV_FinishClientSnapshot(client, &msg);
+}
+
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalMessage
+
+=======================
+*/
+void SV_SendClientSnapshot(client_t* client)
+{
+	SV_NewSnapshotGeneration();
+	SV_MarkBroadcastEntities();
+	SV_BuildAndSendClientSnapshot(client);
+}
+
+/*
+=============================================================================
+
+Parallel snapshots
+
+With sv_parallelSnapshots set, SV_SendClientMessages splits the work of
+SV_SendClientSnapshot into phases.  Entity culling and message encoding run
+for all clients at once on the job workers; everything that touches shared
+server state, the console, files or the network stays on the main thread.
+
+=============================================================================
+*/
+
+using snapshotJob_t = struct snapshotJob_s
+{
+	client_t* client;
+	snapshotEntityNumbers_t entityNumbers;
+	qboolean send;
+	clientSnapshot_t* oldframe;
+	int lastframe;
+	msg_t msg;
+	byte msgBuf[MAX_MSGLEN];
+};
+
+static snapshotJob_t snapshotJobs[MAX_CLIENTS];
+
+static void SV_BuildSnapshotJob(const int index, void* data)
+{
+	snapshotJob_t* job = &static_cast<snapshotJob_t*>(data)[index];
+
+	SV_BuildClientSnapshotEntities(job->client, &job->entityNumbers);
+}
+
+static void SV_EncodeSnapshotJob(const int index, void* data)
+{
+	PROFILE_SCOPE("SV_EncodeSnapshotJob");
+	snapshotJob_t* job = &static_cast<snapshotJob_t*>(data)[index];
+
+	SV_StoreSnapshotEntities(job->client, &job->entityNumbers);
+
+	if (!job->send)
+	{
+		return;
+	}
+
+	MSG_Init(&job->msg, job->msgBuf, sizeof job->msgBuf);
+	job->msg.allowoverflow = qtrue;
+
+	SV_WriteClientSnapshotMessage(job->client, job->oldframe, job->lastframe, &job->msg);
+}
+
+/*
+=======================
+SV_FixEntityNumbers
+
+Done up front so the culling jobs never have to write to the entities
+=======================
+*/
+static void SV_FixEntityNumbers(void)
+{
+	for (int e = 0; e < sv.num_entities; e++)
+	{
+		sharedEntity_t* ent = SV_GentityNum(e);
+
+		if (ent->r.linked && ent->s.number != e)
+		{
+			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+	}
+}
+
+static void SV_SendClientSnapshotsParallel(const int numJobs)
+{
+	int i;
+	snapshotJob_t* job;
+
+	SV_FixEntityNumbers();
+
+	// cull
+	Com_ParallelFor(numJobs, SV_BuildSnapshotJob, snapshotJobs);
+
+	// claim every run of snapshot entities before any delta is chosen, so
+	// the rolled off check accounts for all of this frame's snapshots
+	for (i = 0, job = snapshotJobs; i < numJobs; i++, job++)
+	{
+		SV_ReserveSnapshotEntities(job->client, &job->entityNumbers);
+		job->send = SV_ShouldSendSnapshot(job->client);
+	}
+
+	for (i = 0, job = snapshotJobs; i < numJobs; i++, job++)
+	{
+		if (job->send)
+		{
+			SV_SelectSnapshotDelta(job->client, &job->oldframe, &job->lastframe);
+		}
+	}
+
+	// copy out the entity states and delta encode
+	Com_ParallelFor(numJobs, SV_EncodeSnapshotJob, snapshotJobs);
+
+	// transmit in client order
+	for (i = 0, job = snapshotJobs; i < numJobs; i++, job++)
+	{
+		if (job->send)
+		{
+			SV_FinishClientSnapshot(job->client, &job->msg);
+		}
+	}
 }
 
 /*
@@ -949,8 +1377,14 @@ SV_SendClientMessages
 */
 void SV_SendClientMessages(void)
 {
+	PROFILE_SCOPE("SV_SendClientMessages");
 	int i;
 	client_t* c;
+	int numJobs = 0;
+	const qboolean parallel = static_cast<qboolean>(sv_parallelSnapshots->integer && Com_NumJobWorkers() > 1);
+
+	SV_NewSnapshotGeneration();
+	SV_MarkBroadcastEntities();
 
 	// send a message to each connected client
 	for (i = 0, c = svs.clients; i < sv_maxclients->integer; i++, c++)
@@ -975,7 +1409,22 @@ void SV_SendClientMessages(void)
 			continue;
 		}
 
+		if (parallel)
+		{
+			if (!c->sentGamedir)
+			{
+				SV_SendClientGamedir(c);
+			}
+			snapshotJobs[numJobs++].client = c;
+			continue;
+		}
+
 		// generate and send a new message
-		SV_SendClientSnapshot(c);
+		SV_BuildAndSendClientSnapshot(c);
 	}
-}
\ No newline at end of file
+
+	if (numJobs)
+	{
+		SV_SendClientSnapshotsParallel(numJobs);
+	}
+}
@@ -27,6 +27,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "ghoul2/ghoul2_shared.h"
 #include "qcommon/cm_public.h"
 
+#include <algorithm>
+
 /*
 ================
 SV_clip_handleForEntity
@@ -56,6 +58,626 @@ clip_handle_t SV_clip_handleForEntity(const sharedEntity_t* ent)
 /*
 ===============================================================================
 
+ENTITY AABB TREE
+
+A second broadphase kept up to date next to the sector tree below: a dynamic
+bounding volume tree with one leaf per linked entity, kept balanced with
+rotations as leaves come and go.  Leaf bounds are padded so an entity moving
+a little doesn't touch the tree at all, and a crowd standing in one spot
+still splits into small boxes instead of piling up in a single sector.
+sv_broadphase picks which of the two traces and area queries use, the
+sector tree stays the default.
+
+The tree hands entities back sorted by number rather than in sector order.
+Clipping against them in a different order can change which entity a trace
+reports when two are hit at exactly the same fraction, so turning it on is a
+(small) gameplay change.  A walk that would go deeper than AABB_STACK_SIZE,
+which the rotations should never allow, falls back to the sector tree.
+
+===============================================================================
+*/
+
+#define	AABB_NULL			-1
+#define	AABB_MAX_NODES		( MAX_GENTITIES * 2 )
+#define	AABB_MARGIN			8.0f	// padding on leaf bounds
+#define	AABB_STACK_SIZE		256		// far deeper than a balanced tree of MAX_GENTITIES gets
+#define	AABB_OVERFLOW		-1		// returned by walks that ran out of stack
+
+using aabbNode_t = struct aabbNode_s
+{
+	vec3_t mins, maxs;
+	int parent; // next free node while on the free list
+	int children[2]; // AABB_NULL for leaves
+	int height; // 0 for leaves, -1 while free
+	int entityNum;
+};
+
+static aabbNode_t sv_aabbNodes[AABB_MAX_NODES];
+static int sv_aabbRoot;
+static int sv_aabbFreeList;
+static int sv_aabbLeafs[MAX_GENTITIES];
+
+/*
+===============
+SV_AABBClear
+===============
+*/
+static void SV_AABBClear(void)
+{
+	for (int i = 0; i < AABB_MAX_NODES; i++)
+	{
+		sv_aabbNodes[i].parent = i + 1 < AABB_MAX_NODES ? i + 1 : AABB_NULL;
+		sv_aabbNodes[i].height = -1;
+	}
+	sv_aabbFreeList = 0;
+	sv_aabbRoot = AABB_NULL;
+
+	for (int& leaf : sv_aabbLeafs)
+	{
+		leaf = AABB_NULL;
+	}
+}
+
+/*
+===============
+SV_AABBAllocNode
+
+Can't run out: there is at most one leaf per entity and one less branch
+===============
+*/
+static int SV_AABBAllocNode(void)
+{
+	const int index = sv_aabbFreeList;
+	aabbNode_t* node = &sv_aabbNodes[index];
+
+	sv_aabbFreeList = node->parent;
+	node->parent = AABB_NULL;
+	node->children[0] = node->children[1] = AABB_NULL;
+	node->height = 0;
+	node->entityNum = ENTITYNUM_NONE;
+
+	return index;
+}
+
+static void SV_AABBFreeNode(const int index)
+{
+	sv_aabbNodes[index].parent = sv_aabbFreeList;
+	sv_aabbNodes[index].height = -1;
+	sv_aabbFreeList = index;
+}
+
+static float SV_AABBArea(const vec3_t mins, const vec3_t maxs)
+{
+	const float dx = maxs[0] - mins[0];
+	const float dy = maxs[1] - mins[1];
+	const float dz = maxs[2] - mins[2];
+
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static void SV_AABBUnion(const aabbNode_t* a, const aabbNode_t* b, vec3_t mins, vec3_t maxs)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i] = a->mins[i] < b->mins[i] ? a->mins[i] : b->mins[i];
+		maxs[i] = a->maxs[i] > b->maxs[i] ? a->maxs[i] : b->maxs[i];
+	}
+}
+
+/*
+===============
+SV_AABBRefit
+
+Recomputes a branch's bounds and height from its children
+===============
+*/
+static void SV_AABBRefit(const int index)
+{
+	aabbNode_t* node = &sv_aabbNodes[index];
+	const aabbNode_t* a = &sv_aabbNodes[node->children[0]];
+	const aabbNode_t* b = &sv_aabbNodes[node->children[1]];
+
+	SV_AABBUnion(a, b, node->mins, node->maxs);
+	node->height = 1 + (a->height > b->height ? a->height : b->height);
+}
+
+/*
+===============
+SV_AABBRotate
+
+Lifts the taller child of index above it, returns the node now in its place
+===============
+*/
+static int SV_AABBRotate(const int index, const int up)
+{
+	aabbNode_t* node = &sv_aabbNodes[index];
+	aabbNode_t* upNode = &sv_aabbNodes[up];
+	const int upSide = node->children[0] == up ? 0 : 1;
+
+	// up takes index's place under its parent
+	upNode->parent = node->parent;
+	node->parent = up;
+
+	if (upNode->parent == AABB_NULL)
+	{
+		sv_aabbRoot = up;
+	}
+	else if (sv_aabbNodes[upNode->parent].children[0] == index)
+	{
+		sv_aabbNodes[upNode->parent].children[0] = up;
+	}
+	else
+	{
+		sv_aabbNodes[upNode->parent].children[1] = up;
+	}
+
+	// up keeps its taller child and gives the shorter one to index
+	const int first = upNode->children[0];
+	const int second = upNode->children[1];
+	const int keep = sv_aabbNodes[first].height > sv_aabbNodes[second].height ? first : second;
+	const int give = keep == first ? second : first;
+
+	upNode->children[0] = index;
+	upNode->children[1] = keep;
+	node->children[upSide] = give;
+	sv_aabbNodes[give].parent = index;
+
+	SV_AABBRefit(index);
+	SV_AABBRefit(up);
+
+	return up;
+}
+
+/*
+===============
+SV_AABBBalance
+===============
+*/
+static int SV_AABBBalance(const int index)
+{
+	const aabbNode_t* node = &sv_aabbNodes[index];
+
+	if (node->height < 2)
+	{
+		return index;
+	}
+
+	const int left = node->children[0];
+	const int right = node->children[1];
+	const int balance = sv_aabbNodes[right].height - sv_aabbNodes[left].height;
+
+	if (balance > 1)
+	{
+		return SV_AABBRotate(index, right);
+	}
+	if (balance < -1)
+	{
+		return SV_AABBRotate(index, left);
+	}
+
+	return index;
+}
+
+/*
+===============
+SV_AABBInsertLeaf
+
+Puts the leaf next to the sibling that grows the tree's surface area least
+===============
+*/
+static void SV_AABBInsertLeaf(const int leaf)
+{
+	if (sv_aabbRoot == AABB_NULL)
+	{
+		sv_aabbRoot = leaf;
+		sv_aabbNodes[leaf].parent = AABB_NULL;
+		return;
+	}
+
+	const aabbNode_t* leafNode = &sv_aabbNodes[leaf];
+	int sibling = sv_aabbRoot;
+	vec3_t mins, maxs;
+
+	while (sv_aabbNodes[sibling].height > 0)
+	{
+		const aabbNode_t* node = &sv_aabbNodes[sibling];
+		const float area = SV_AABBArea(node->mins, node->maxs);
+
+		SV_AABBUnion(node, leafNode, mins, maxs);
+		const float combinedArea = SV_AABBArea(mins, maxs);
+
+		// cost of pairing with this node, and the least extra cost pushing down adds
+		const float cost = 2.0f * combinedArea;
+		const float inheritance = 2.0f * (combinedArea - area);
+		float childCost[2];
+
+		for (int i = 0; i < 2; i++)
+		{
+			const aabbNode_t* child = &sv_aabbNodes[node->children[i]];
+
+			SV_AABBUnion(child, leafNode, mins, maxs);
+			childCost[i] = SV_AABBArea(mins, maxs) + inheritance;
+			if (child->height > 0)
+			{
+				childCost[i] -= SV_AABBArea(child->mins, child->maxs);
+			}
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+		{
+			break;
+		}
+
+		sibling = childCost[0] < childCost[1] ? node->children[0] : node->children[1];
+	}
+
+	// new branch holding the sibling and the leaf
+	const int oldParent = sv_aabbNodes[sibling].parent;
+	const int branch = SV_AABBAllocNode();
+
+	sv_aabbNodes[branch].parent = oldParent;
+	sv_aabbNodes[branch].children[0] = sibling;
+	sv_aabbNodes[branch].children[1] = leaf;
+	sv_aabbNodes[sibling].parent = branch;
+	sv_aabbNodes[leaf].parent = branch;
+
+	if (oldParent == AABB_NULL)
+	{
+		sv_aabbRoot = branch;
+	}
+	else if (sv_aabbNodes[oldParent].children[0] == sibling)
+	{
+		sv_aabbNodes[oldParent].children[0] = branch;
+	}
+	else
+	{
+		sv_aabbNodes[oldParent].children[1] = branch;
+	}
+
+	// walk back up fixing bounds and heights
+	for (int index = branch; index != AABB_NULL; index = sv_aabbNodes[index].parent)
+	{
+		SV_AABBRefit(index);
+		index = SV_AABBBalance(index);
+	}
+}
+
+/*
+===============
+SV_AABBRemoveLeaf
+===============
+*/
+static void SV_AABBRemoveLeaf(const int leaf)
+{
+	if (leaf == sv_aabbRoot)
+	{
+		sv_aabbRoot = AABB_NULL;
+		return;
+	}
+
+	const int parent = sv_aabbNodes[leaf].parent;
+	const int grandParent = sv_aabbNodes[parent].parent;
+	const int sibling = sv_aabbNodes[parent].children[0] == leaf
+		? sv_aabbNodes[parent].children[1]
+		: sv_aabbNodes[parent].children[0];
+
+	SV_AABBFreeNode(parent);
+
+	if (grandParent == AABB_NULL)
+	{
+		sv_aabbRoot = sibling;
+		sv_aabbNodes[sibling].parent = AABB_NULL;
+		return;
+	}
+
+	// the sibling takes the parent's place
+	if (sv_aabbNodes[grandParent].children[0] == parent)
+	{
+		sv_aabbNodes[grandParent].children[0] = sibling;
+	}
+	else
+	{
+		sv_aabbNodes[grandParent].children[1] = sibling;
+	}
+	sv_aabbNodes[sibling].parent = grandParent;
+
+	for (int index = grandParent; index != AABB_NULL; index = sv_aabbNodes[index].parent)
+	{
+		SV_AABBRefit(index);
+		index = SV_AABBBalance(index);
+	}
+}
+
+/*
+===============
+SV_AABBUnlinkEntity
+===============
+*/
+static void SV_AABBUnlinkEntity(const int entityNum)
+{
+	const int leaf = sv_aabbLeafs[entityNum];
+
+	if (leaf == AABB_NULL)
+	{
+		return;
+	}
+
+	SV_AABBRemoveLeaf(leaf);
+	SV_AABBFreeNode(leaf);
+	sv_aabbLeafs[entityNum] = AABB_NULL;
+}
+
+/*
+===============
+SV_AABBLinkEntity
+
+Only moves the leaf if the new bounds have left its padded ones
+===============
+*/
+static void SV_AABBLinkEntity(const int entityNum, const vec3_t absmin, const vec3_t absmax)
+{
+	int leaf = sv_aabbLeafs[entityNum];
+
+	if (leaf != AABB_NULL)
+	{
+		const aabbNode_t* node = &sv_aabbNodes[leaf];
+
+		if (absmin[0] >= node->mins[0] && absmin[1] >= node->mins[1] && absmin[2] >= node->mins[2]
+			&& absmax[0] <= node->maxs[0] && absmax[1] <= node->maxs[1] && absmax[2] <= node->maxs[2])
+		{
+			return;
+		}
+
+		SV_AABBRemoveLeaf(leaf);
+	}
+	else
+	{
+		leaf = SV_AABBAllocNode();
+		sv_aabbLeafs[entityNum] = leaf;
+	}
+
+	aabbNode_t* node = &sv_aabbNodes[leaf];
+
+	for (int i = 0; i < 3; i++)
+	{
+		node->mins[i] = absmin[i] - AABB_MARGIN;
+		node->maxs[i] = absmax[i] + AABB_MARGIN;
+	}
+	node->children[0] = node->children[1] = AABB_NULL;
+	node->height = 0;
+	node->entityNum = entityNum;
+
+	SV_AABBInsertLeaf(leaf);
+}
+
+/*
+===============
+SV_AABBHeight
+===============
+*/
+static int SV_AABBHeight(void)
+{
+	return sv_aabbRoot == AABB_NULL ? 0 : sv_aabbNodes[sv_aabbRoot].height + 1;
+}
+
+/*
+===============
+SV_AABBAreaEntities
+
+Same as the sector walk, but the results come back sorted by entity number
+since the tree's layout depends on the order things were linked in.
+AABB_OVERFLOW if the tree is too deep to walk.
+===============
+*/
+static int SV_AABBAreaEntities(const vec3_t mins, const vec3_t maxs, int* entity_list, const int maxcount)
+{
+	int stack[AABB_STACK_SIZE];
+	int depth = 0;
+	int count = 0;
+
+	if (sv_aabbRoot != AABB_NULL)
+	{
+		stack[depth++] = sv_aabbRoot;
+	}
+
+	while (depth)
+	{
+		const aabbNode_t* node = &sv_aabbNodes[stack[--depth]];
+
+		if (node->mins[0] > maxs[0] || node->mins[1] > maxs[1] || node->mins[2] > maxs[2]
+			|| node->maxs[0] < mins[0] || node->maxs[1] < mins[1] || node->maxs[2] < mins[2])
+		{
+			continue;
+		}
+
+		if (node->height > 0)
+		{
+			if (depth + 2 > AABB_STACK_SIZE)
+			{
+				Com_DPrintf("SV_AABB: tree too deep, using the sectors\n");
+				return AABB_OVERFLOW;
+			}
+			stack[depth++] = node->children[0];
+			stack[depth++] = node->children[1];
+			continue;
+		}
+
+		// the leaf is padded, test the real bounds
+		const sharedEntity_t* gcheck = SV_GentityNum(node->entityNum);
+
+		if (gcheck->r.absmin[0] > maxs[0]
+			|| gcheck->r.absmin[1] > maxs[1]
+			|| gcheck->r.absmin[2] > maxs[2]
+			|| gcheck->r.absmax[0] < mins[0]
+			|| gcheck->r.absmax[1] < mins[1]
+			|| gcheck->r.absmax[2] < mins[2])
+		{
+			continue;
+		}
+
+		if (count == maxcount)
+		{
+			Com_DPrintf("SV_AreaEntities: MAXCOUNT\n");
+			break;
+		}
+
+		entity_list[count++] = node->entityNum;
+	}
+
+	std::sort(entity_list, entity_list + count);
+
+	return count;
+}
+
+/*
+===============
+SV_AABBSweepHits
+
+Whether a box moving along a sweep touches the bounds: the box around the
+whole move has to overlap them, then the path is clipped against the
+bounds grown by the moving box
+===============
+*/
+using aabbSweep_t = struct aabbSweep_s
+{
+	vec3_t start;
+	vec3_t invDelta; // 0 on axes the box doesn't move along
+	vec3_t mins, maxs; // moving box, one unit larger like the box around the move
+	vec3_t boxmins, boxmaxs;
+};
+
+static qboolean SV_AABBSweepBoxHits(const aabbSweep_t* sweep, const vec3_t boundsMin, const vec3_t boundsMax)
+{
+	return static_cast<qboolean>(!(boundsMin[0] > sweep->boxmaxs[0] || boundsMin[1] > sweep->boxmaxs[1]
+		|| boundsMin[2] > sweep->boxmaxs[2] || boundsMax[0] < sweep->boxmins[0] || boundsMax[1] < sweep->boxmins[1]
+		|| boundsMax[2] < sweep->boxmins[2]));
+}
+
+static qboolean SV_AABBSweepHits(const aabbSweep_t* sweep, const vec3_t boundsMin, const vec3_t boundsMax)
+{
+	if (!SV_AABBSweepBoxHits(sweep, boundsMin, boundsMax))
+	{
+		return qfalse;
+	}
+
+	float enter = 0.0f, leave = 1.0f;
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (sweep->invDelta[i] == 0.0f)
+		{
+			continue; // the box test covered it
+		}
+
+		float t0 = (boundsMin[i] - sweep->maxs[i] - sweep->start[i]) * sweep->invDelta[i];
+		float t1 = (boundsMax[i] - sweep->mins[i] - sweep->start[i]) * sweep->invDelta[i];
+
+		if (t0 > t1)
+		{
+			const float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+		if (t0 > enter)
+		{
+			enter = t0;
+		}
+		if (t1 < leave)
+		{
+			leave = t1;
+		}
+		if (enter > leave)
+		{
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+===============
+SV_AABBSweptEntities
+
+Entities whose bounds a moving box touches on its way from start to end,
+sorted by entity number.  Long diagonal traces don't hand the entities that
+are only in the box around the whole move on to the exact clip.
+AABB_OVERFLOW if the tree is too deep to walk.
+===============
+*/
+static int SV_AABBSweptEntities(const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+	int* entity_list, const int maxcount)
+{
+	int stack[AABB_STACK_SIZE];
+	int depth = 0;
+	int count = 0;
+	aabbSweep_t sweep;
+
+	VectorCopy(start, sweep.start);
+	for (int i = 0; i < 3; i++)
+	{
+		const float delta = end[i] - start[i];
+
+		sweep.invDelta[i] = delta == 0.0f ? 0.0f : 1.0f / delta;
+		sweep.mins[i] = mins[i] - 1;
+		sweep.maxs[i] = maxs[i] + 1;
+		sweep.boxmins[i] = (start[i] < end[i] ? start[i] : end[i]) + sweep.mins[i];
+		sweep.boxmaxs[i] = (start[i] > end[i] ? start[i] : end[i]) + sweep.maxs[i];
+	}
+
+	if (sv_aabbRoot != AABB_NULL)
+	{
+		stack[depth++] = sv_aabbRoot;
+	}
+
+	while (depth)
+	{
+		const aabbNode_t* node = &sv_aabbNodes[stack[--depth]];
+
+		// branches only get the box test, clipping the path against every
+		// one costs more than the few extra nodes it would skip
+		if (!SV_AABBSweepBoxHits(&sweep, node->mins, node->maxs))
+		{
+			continue;
+		}
+
+		if (node->height > 0)
+		{
+			if (depth + 2 > AABB_STACK_SIZE)
+			{
+				Com_DPrintf("SV_AABB: tree too deep, using the sectors\n");
+				return AABB_OVERFLOW;
+			}
+			stack[depth++] = node->children[0];
+			stack[depth++] = node->children[1];
+			continue;
+		}
+
+		// anything left here costs a full clip, so test the real path
+		const sharedEntity_t* gcheck = SV_GentityNum(node->entityNum);
+
+		if (!SV_AABBSweepHits(&sweep, gcheck->r.absmin, gcheck->r.absmax))
+		{
+			continue;
+		}
+
+		if (count == maxcount)
+		{
+			Com_DPrintf("SV_AreaEntities: MAXCOUNT\n");
+			break;
+		}
+
+		entity_list[count++] = node->entityNum;
+	}
+
+	std::sort(entity_list, entity_list + count);
+
+	return count;
+}
+
+/*
+===============================================================================
+
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
@@ -98,6 +720,14 @@ void SV_SectorList_f(void)
 		}
 		Com_Printf("sector %i: %i entities\n", i, c);
 	}
+
+	int leafs = 0;
+	for (const int leaf : sv_aabbLeafs)
+	{
+		leafs += leaf != AABB_NULL;
+	}
+	Com_Printf("aabb tree: %i entities, height %i%s\n", leafs, SV_AABBHeight(),
+		sv_broadphase->integer ? " (in use)" : "");
 }
 
 /*
@@ -146,6 +776,166 @@ worldSector_t* SV_CreateworldSector(const int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============================================================================
+
+CLUSTER LISTS
+
+Every entity is also kept in a list for each PVS cluster it was linked into,
+so snapshot building only has to look at entities in clusters the viewer can
+see instead of walking all of them.  Membership follows svEntity_t clusternums
+exactly and is only changed by SV_LinkEntity; entities whose clusters didn't
+fit in clusternums are kept in a separate overflow set.
+
+===============================================================================
+*/
+
+#define	NO_CLUSTER_LINK	-1
+
+static int* sv_clusterHeads; // first link per cluster, hunk allocated per map
+static int sv_numClusterHeads;
+
+// link i is the (i % MAX_ENT_CLUSTERS)th cluster of entity (i / MAX_ENT_CLUSTERS)
+static int sv_clusterLinkNext[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+static int sv_clusterLinkPrev[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+static int sv_clusterLinkCluster[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+static int sv_numEntityClusterLinks[MAX_GENTITIES];
+
+static byte sv_clusterOverflow[MAX_GENTITIES / 8];
+
+/*
+===============
+SV_ClearClusterLists
+===============
+*/
+static void SV_ClearClusterLists(void)
+{
+	sv_numClusterHeads = CM_NumClusters();
+	sv_clusterHeads = static_cast<int*>(Hunk_Alloc(sv_numClusterHeads * sizeof(int), h_high));
+	for (int i = 0; i < sv_numClusterHeads; i++)
+	{
+		sv_clusterHeads[i] = NO_CLUSTER_LINK;
+	}
+
+	Com_Memset(sv_numEntityClusterLinks, 0, sizeof sv_numEntityClusterLinks);
+	Com_Memset(sv_clusterOverflow, 0, sizeof sv_clusterOverflow);
+}
+
+/*
+===============
+SV_UnlinkEntityClusters
+===============
+*/
+static void SV_UnlinkEntityClusters(const int entityNum)
+{
+	const int base = entityNum * MAX_ENT_CLUSTERS;
+
+	for (int i = 0; i < sv_numEntityClusterLinks[entityNum]; i++)
+	{
+		const int link = base + i;
+
+		if (sv_clusterLinkPrev[link] == NO_CLUSTER_LINK)
+		{
+			sv_clusterHeads[sv_clusterLinkCluster[link]] = sv_clusterLinkNext[link];
+		}
+		else
+		{
+			sv_clusterLinkNext[sv_clusterLinkPrev[link]] = sv_clusterLinkNext[link];
+		}
+
+		if (sv_clusterLinkNext[link] != NO_CLUSTER_LINK)
+		{
+			sv_clusterLinkPrev[sv_clusterLinkNext[link]] = sv_clusterLinkPrev[link];
+		}
+	}
+
+	sv_numEntityClusterLinks[entityNum] = 0;
+	sv_clusterOverflow[entityNum >> 3] &= ~(1 << (entityNum & 7));
+}
+
+/*
+===============
+SV_LinkEntityClusters
+===============
+*/
+static void SV_LinkEntityClusters(const int entityNum, const svEntity_t* ent)
+{
+	const int base = entityNum * MAX_ENT_CLUSTERS;
+
+	if (!sv_clusterHeads)
+	{
+		return;
+	}
+
+	SV_UnlinkEntityClusters(entityNum);
+
+	if (ent->lastCluster)
+	{
+		sv_clusterOverflow[entityNum >> 3] |= 1 << (entityNum & 7);
+	}
+
+	for (int i = 0; i < ent->numClusters; i++)
+	{
+		const int cluster = ent->clusternums[i];
+
+		if (cluster < 0 || cluster >= sv_numClusterHeads)
+		{
+			// can't be indexed, always give it the full visibility test
+			sv_clusterOverflow[entityNum >> 3] |= 1 << (entityNum & 7);
+			continue;
+		}
+
+		const int link = base + sv_numEntityClusterLinks[entityNum]++;
+
+		sv_clusterLinkCluster[link] = cluster;
+		sv_clusterLinkPrev[link] = NO_CLUSTER_LINK;
+		sv_clusterLinkNext[link] = sv_clusterHeads[cluster];
+		if (sv_clusterHeads[cluster] != NO_CLUSTER_LINK)
+		{
+			sv_clusterLinkPrev[sv_clusterHeads[cluster]] = link;
+		}
+		sv_clusterHeads[cluster] = link;
+	}
+}
+
+/*
+===============
+SV_MarkPVSEntities
+
+Sets the bit in entityBits of every entity that is linked into a cluster
+visible in pvs, or that has to be checked cluster by cluster
+===============
+*/
+void SV_MarkPVSEntities(const byte* pvs, byte* entityBits)
+{
+	int i;
+
+	for (i = 0; i < MAX_GENTITIES / 8; i++)
+	{
+		entityBits[i] |= sv_clusterOverflow[i];
+	}
+
+	for (i = 0; i < sv_numClusterHeads; i++)
+	{
+		if (!pvs[i >> 3])
+		{
+			i |= 7;
+			continue;
+		}
+
+		if (!(pvs[i >> 3] & 1 << (i & 7)))
+		{
+			continue;
+		}
+
+		for (int link = sv_clusterHeads[i]; link != NO_CLUSTER_LINK; link = sv_clusterLinkNext[link])
+		{
+			const int entityNum = link / MAX_ENT_CLUSTERS;
+			entityBits[entityNum >> 3] |= 1 << (entityNum & 7);
+		}
+	}
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -163,20 +953,19 @@ void SV_ClearWorld(void)
 	const clip_handle_t h = CM_InlineModel(0);
 	CM_ModelBounds(h, mins, maxs);
 	SV_CreateworldSector(0, mins, maxs);
+
+	SV_AABBClear();
+	SV_ClearClusterLists();
 }
 
 /*
 ===============
-SV_UnlinkEntity
+SV_UnlinkWorldSector
 
 ===============
 */
-void SV_UnlinkEntity(sharedEntity_t* g_ent)
+static void SV_UnlinkWorldSector(svEntity_t* ent)
 {
-	svEntity_t* ent = SV_SvEntityForGentity(g_ent);
-
-	g_ent->r.linked = qfalse;
-
 	worldSector_t* ws = ent->worldSector;
 	if (!ws)
 	{
@@ -202,6 +991,23 @@ void SV_UnlinkEntity(sharedEntity_t* g_ent)
 	Com_Printf("WARNING: SV_UnlinkEntity: not found in worldSector\n");
 }
 
+/*
+===============
+SV_UnlinkEntity
+
+===============
+*/
+void SV_UnlinkEntity(sharedEntity_t* g_ent)
+{
+	svEntity_t* ent = SV_SvEntityForGentity(g_ent);
+
+	g_ent->r.linked = qfalse;
+
+	SV_AABBUnlinkEntity(ent - sv.svEntities);
+	SV_UnlinkEntityClusters(ent - sv.svEntities);
+	SV_UnlinkWorldSector(ent);
+}
+
 /*
 ===============
 SV_LinkEntity
@@ -220,7 +1026,9 @@ void SV_LinkEntity(sharedEntity_t* g_ent)
 
 	if (ent->worldSector)
 	{
-		SV_UnlinkEntity(g_ent); // unlink from old position
+		// unlink from old position, the AABB tree leaf only moves if it has to
+		g_ent->r.linked = qfalse;
+		SV_UnlinkWorldSector(ent);
 	}
 
 	// encode the size into the entityState_t for client prediction
@@ -308,6 +1116,8 @@ void SV_LinkEntity(sharedEntity_t* g_ent)
 	// entity is outside the world and can be considered unlinked
 	if (!num_leafs)
 	{
+		SV_AABBUnlinkEntity(ent - sv.svEntities);
+		SV_LinkEntityClusters(ent - sv.svEntities, ent);
 		return;
 	}
 
@@ -357,6 +1167,8 @@ void SV_LinkEntity(sharedEntity_t* g_ent)
 		ent->lastCluster = CM_LeafCluster(lastLeaf);
 	}
 
+	SV_LinkEntityClusters(ent - sv.svEntities, ent);
+
 	g_ent->r.linkcount++;
 
 	// find the first world sector node that the ent's box crosses
@@ -378,6 +1190,8 @@ void SV_LinkEntity(sharedEntity_t* g_ent)
 	ent->nextEntityInWorldSector = node->entities;
 	node->entities = ent;
 
+	SV_AABBLinkEntity(ent - sv.svEntities, g_ent->r.absmin, g_ent->r.absmax);
+
 	g_ent->r.linked = qtrue;
 }
 
@@ -460,6 +1274,15 @@ int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int* entity_list, cons
 {
 	areaParms_t ap{};
 
+	if (sv_broadphase->integer)
+	{
+		const int count = SV_AABBAreaEntities(mins, maxs, entity_list, maxcount);
+		if (count != AABB_OVERFLOW)
+		{
+			return count;
+		}
+	}
+
 	ap.mins = mins;
 	ap.maxs = maxs;
 	ap.list = entity_list;
@@ -557,12 +1380,21 @@ static float VectorDistance(vec3_t p1, vec3_t p2)
 
 static void SV_ClipMoveToEntities(moveclip_t* clip)
 {
-	static int touchlist[MAX_GENTITIES];
+	static thread_local int touchlist[MAX_GENTITIES];
 	int passOwnerNum;
 	trace_t trace, oldTrace = { 0 };
 	int thisOwnerShared = 1;
 
-	const int num = SV_AreaEntities(clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+	int num = AABB_OVERFLOW;
+
+	if (sv_broadphase->integer)
+	{
+		num = SV_AABBSweptEntities(clip->start, clip->end, clip->mins, clip->maxs, touchlist, MAX_GENTITIES);
+	}
+	if (num == AABB_OVERFLOW)
+	{
+		num = SV_AreaEntities(clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+	}
 
 	if (clip->pass_entity_num != ENTITYNUM_NONE)
 	{
@@ -795,12 +1627,14 @@ static void SV_ClipMoveToEntities(moveclip_t* clip)
 				touch->m_pVehicle)
 			{
 				//for vehicles cache the transform data.
+				PROFILE_SCOPE("G2_CollisionDetect");
 				re->G2API_CollisionDetectCache(G2Trace, *static_cast<CGhoul2Info_v*>(touch->ghoul2), vec_out,
 					touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end,
 					touch->modelScale, G2VertSpaceServer, 0, clip->useLod, f_radius);
 			}
 			else
 			{
+				PROFILE_SCOPE("G2_CollisionDetect");
 				re->G2API_CollisionDetect(G2Trace, *static_cast<CGhoul2Info_v*>(touch->ghoul2), vec_out,
 					touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end,
 					touch->modelScale, G2VertSpaceServer, 0, clip->useLod, f_radius);
@@ -868,6 +1702,7 @@ void SV_Trace(trace_t* results, const vec3_t start, const vec3_t mins, const vec
 	/*
 	Ghoul2 Insert End
 	*/
+	PROFILE_SCOPE("SV_Trace");
 	moveclip_t clip;
 
 	if (!mins)
@@ -931,6 +1766,75 @@ void SV_Trace(trace_t* results, const vec3_t start, const vec3_t mins, const vec
 	*results = clip.trace;
 }
 
+/*
+==================
+SV_TraceBatch
+
+Runs a list of independent traces for the game in one call instead of one
+syscall per trace.  Results come back in request order, a batch longer than
+MAX_TRACE_BATCH is cut short.  With
+sv_parallelTraces the plain traces are spread over the job workers; ghoul2
+traces touch shared model state and always run here afterwards.
+==================
+*/
+#define TRACE_BATCH_PARALLEL_MIN	16	// smaller batches aren't worth waking the workers
+
+using traceBatch_t = struct traceBatch_s
+{
+	const traceRequest_t* requests;
+	trace_t* results;
+};
+
+static void SV_TraceRequest(const traceRequest_t* request, trace_t* result)
+{
+	SV_Trace(result, request->start, request->mins, request->maxs, request->end,
+		request->pass_entity_num, request->contentmask, request->capsule, request->traceFlags, request->useLod);
+}
+
+static void SV_TraceBatchJob(const int index, void* data)
+{
+	const traceBatch_t* batch = static_cast<traceBatch_t*>(data);
+
+	if (!(batch->requests[index].traceFlags & G2TRFLAG_DOGHOULTRACE))
+	{
+		SV_TraceRequest(&batch->requests[index], &batch->results[index]);
+	}
+}
+
+void SV_TraceBatch(const traceRequest_t* requests, trace_t* results, int count)
+{
+	if (count < 0)
+	{
+		Com_Error(ERR_DROP, "SV_TraceBatch: bad count %i", count);
+	}
+	if (count > MAX_TRACE_BATCH)
+	{
+		Com_DPrintf(S_COLOR_YELLOW "WARNING: SV_TraceBatch: %i traces, only running %i\n", count, MAX_TRACE_BATCH);
+		count = MAX_TRACE_BATCH;
+	}
+
+	if (sv_parallelTraces->integer && count >= TRACE_BATCH_PARALLEL_MIN && Com_NumJobWorkers() > 1)
+	{
+		traceBatch_t batch = { requests, results };
+
+		Com_ParallelFor(count, SV_TraceBatchJob, &batch);
+
+		for (int i = 0; i < count; i++)
+		{
+			if (requests[i].traceFlags & G2TRFLAG_DOGHOULTRACE)
+			{
+				SV_TraceRequest(&requests[i], &results[i]);
+			}
+		}
+		return;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		SV_TraceRequest(&requests[i], &results[i]);
+	}
+}
+
 /*
 =============
 SV_PointContents
@@ -142,6 +142,7 @@ typedef struct playerInfo_s {
 
 #define DEMO_DIRECTORY "demos"
 #define DEMO_EXTENSION "dm_"
+#define DEMO_ARCHIVE_EXTENSION "dmz_"
 #define MAX_DEMOLIST (MAX_DEMOS * MAX_QPATH)
 
 #define MAX_SCROLLTEXT_SIZE		4096
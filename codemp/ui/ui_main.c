@@ -5066,14 +5066,20 @@ static void UI_LoadDemosInDirectory(loadDemoContext_t* ctx, const char* director
 	if (protocolLegacy == protocol)
 		protocolLegacy = 0;
 
-	Com_sprintf(demoExt, sizeof demoExt, ".%s%d", DEMO_EXTENSION, protocol);
+	// plain and archived demos of this protocol, then plain legacy ones
+	const char* extensions[] = { DEMO_EXTENSION, DEMO_ARCHIVE_EXTENSION, DEMO_EXTENSION };
+	const int protocols[] = { protocol, protocol, protocolLegacy };
 
-	uiInfo.demoCount += trap->FS_GetFileList(directory, demoExt, ctx->demoList, sizeof ctx->demoList);
+	for (int j = 0; j < 3 && uiInfo.demoCount < MAX_DEMOS; j++)
+	{
+		if (protocols[j] <= 0)
+			continue;
 
-	char* demoname = ctx->demoList;
+		Com_sprintf(demoExt, sizeof demoExt, ".%s%d", extensions[j], protocols[j]);
+		uiInfo.demoCount += trap->FS_GetFileList(directory, demoExt, ctx->demoList, sizeof ctx->demoList);
+
+		char* demoname = ctx->demoList;
 
-	for (int j = 0; j < 2; j++)
-	{
 		if (uiInfo.demoCount > MAX_DEMOS)
 			uiInfo.demoCount = MAX_DEMOS;
 
@@ -5088,18 +5094,6 @@ static void UI_LoadDemosInDirectory(loadDemoContext_t* ctx, const char* director
 				demoname);
 			demoname += len + 1;
 		}
-
-		if (!j)
-		{
-			if (protocolLegacy > 0 && uiInfo.demoCount < MAX_DEMOS)
-			{
-				Com_sprintf(demoExt, sizeof demoExt, ".%s%d", DEMO_EXTENSION, protocolLegacy);
-				uiInfo.demoCount += trap->FS_GetFileList(directory, demoExt, ctx->demoList, sizeof ctx->demoList);
-				demoname = ctx->demoList;
-			}
-			else
-				break;
-		}
 	}
 
 	const char* dirListEnd = ctx->directoryList + sizeof ctx->directoryList;
@@ -163,6 +163,9 @@ time_t Sys_FileTime(const char* path);
 
 qboolean Sys_LowPhysicalMemory();
 
+void* Sys_MapFile(const char* path, size_t* length);
+void Sys_UnmapFile(void* data, size_t length);
+
 void Sys_SetProcessorAffinity();
 
 using graphicsApi_t = enum graphicsApi_e
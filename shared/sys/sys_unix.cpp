@@ -27,6 +27,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <libgen.h>
@@ -159,6 +160,46 @@ qboolean Sys_LowPhysicalMemory( void )
 	return qfalse;
 }
 
+/*
+==================
+Sys_MapFile
+
+Maps a whole file read only, NULL if it can't be mapped
+==================
+*/
+void *Sys_MapFile( const char *path, size_t *length )
+{
+	struct stat st;
+	int fd = open( path, O_RDONLY );
+
+	if ( fd == -1 )
+		return NULL;
+
+	if ( fstat( fd, &st ) == -1 || st.st_size <= 0 ) {
+		close( fd );
+		return NULL;
+	}
+
+	void *data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );	// the mapping holds its own reference
+
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*length = st.st_size;
+	return data;
+}
+
+/*
+==================
+Sys_UnmapFile
+==================
+*/
+void Sys_UnmapFile( void *data, size_t length )
+{
+	munmap( data, length );
+}
+
 /*
 ==================
 Sys_Basename
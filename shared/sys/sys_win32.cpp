@@ -253,6 +253,56 @@ qboolean Sys_LowPhysicalMemory()
 	return stat.ullTotalPhys <= MEM_THRESHOLD ? qtrue : qfalse;
 }
 
+/*
+==================
+Sys_MapFile
+
+Maps a whole file read only, NULL if it can't be mapped
+==================
+*/
+void* Sys_MapFile(const char* path, size_t* length)
+{
+	const HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	const HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return nullptr;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);	// the view holds its own reference
+	if (!data)
+	{
+		return nullptr;
+	}
+
+	*length = static_cast<size_t>(size.QuadPart);
+	return data;
+}
+
+/*
+==================
+Sys_UnmapFile
+==================
+*/
+void Sys_UnmapFile(void* data, size_t length)
+{
+	UnmapViewOfFile(data);
+}
+
 /*
 ==============
 Sys_Mkdir
@@ -0,0 +1,128 @@
+// Replays the recording through the delta encoders and decoders and reports
+// the cost per entity, player and command.  Run with an optional pass count:
+//
+//	NetcodeBenchmark [passes]
+
+#include "recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	using benchClock = std::chrono::steady_clock;
+
+	struct benchResult
+	{
+		double encodeNs = 0;
+		double decodeNs = 0;
+		long long bytes = 0;
+		long long items = 0;
+	};
+
+	double Elapsed(const benchClock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(benchClock::now() - start).count();
+	}
+
+	void Report(const char* name, const benchResult& result)
+	{
+		const double items = static_cast<double>(result.items);
+
+		printf("%-14s %10.1f ns/item encode %10.1f ns/item decode %8.2f bytes/item\n", name,
+			result.encodeNs / items, result.decodeNs / items, static_cast<double>(result.bytes) / items);
+	}
+
+	template <typename Write, typename Read>
+	benchResult Run(const int passes, const int itemsPerFrame, Write write, Read read)
+	{
+		std::vector<byte> buffers(static_cast<size_t>(RECORDING_FRAMES) * MAX_MSGLEN);
+		std::vector<msg_t> msgs(RECORDING_FRAMES);
+		benchResult result;
+
+		for (int pass = 0; pass < passes; pass++)
+		{
+			auto start = benchClock::now();
+			for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+			{
+				MSG_Init(&msgs[frame], &buffers[static_cast<size_t>(frame) * MAX_MSGLEN], MAX_MSGLEN);
+				write(&msgs[frame], frame);
+			}
+			result.encodeNs += Elapsed(start);
+
+			start = benchClock::now();
+			for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+			{
+				MSG_BeginReading(&msgs[frame]);
+				read(&msgs[frame], frame);
+			}
+			result.decodeNs += Elapsed(start);
+
+			for (const msg_t& msg : msgs)
+			{
+				result.bytes += msg.cursize;
+			}
+			result.items += static_cast<long long>(RECORDING_FRAMES) * itemsPerFrame;
+		}
+
+		return result;
+	}
+}
+
+int main(const int argc, char** argv)
+{
+	const int passes = argc > 1 ? atoi(argv[1]) : 50;
+	const recording_t& rec = Recording_Get();
+
+	int numEntities = 0;
+	for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+	{
+		for (int i = 0; i < RECORDING_ENTITIES; i++)
+		{
+			numEntities += rec.present[frame][i];
+		}
+	}
+
+	printf("%i frames, %i passes\n", RECORDING_FRAMES, passes);
+
+	{
+		std::vector<entityState_t> states(RECORDING_ENTITIES);
+		std::vector<qboolean> present(RECORDING_ENTITIES);
+
+		auto result = Run(passes, 0, Recording_WriteEntities, [&](msg_t* msg, const int frame)
+		{
+			if (!frame)
+			{
+				std::fill(present.begin(), present.end(), qfalse);
+			}
+			Recording_ReadEntities(msg, states.data(), present.data());
+		});
+		result.items = static_cast<long long>(numEntities) * passes;
+		Report("entityState", result);
+	}
+
+	{
+		std::vector<playerState_t> states(2 * RECORDING_PLAYERS);
+
+		Report("playerState", Run(passes, RECORDING_PLAYERS, Recording_WritePlayers, [&](msg_t* msg, const int frame)
+		{
+			playerState_t* from = &states[(frame + 1) % 2 * RECORDING_PLAYERS];
+			Recording_ReadPlayers(msg, frame ? from : nullptr, &states[frame % 2 * RECORDING_PLAYERS]);
+		}));
+	}
+
+	{
+		std::vector<usercmd_t> cmds(2 * RECORDING_PLAYERS);
+
+		Report("usercmd", Run(passes, RECORDING_PLAYERS, Recording_WriteCmds, [&](msg_t* msg, const int frame)
+		{
+			usercmd_t* from = &cmds[(frame + 1) % 2 * RECORDING_PLAYERS];
+			Recording_ReadCmds(msg, frame ? from : nullptr, &cmds[frame % 2 * RECORDING_PLAYERS]);
+		}));
+	}
+
+	return 0;
+}
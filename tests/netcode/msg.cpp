@@ -0,0 +1,200 @@
+#include "recording.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Golden values pin the wire format: they were produced by the tree walking
+// huffman coder and must not change unless the protocol does.
+
+namespace
+{
+	struct encodedStream
+	{
+		std::uint64_t hash = 14695981039346656037ULL; // FNV-1a over every message
+		int bits = 0;
+	};
+
+	void HashMessage(encodedStream& stream, const msg_t& msg)
+	{
+		for (int i = 0; i < (msg.bit + 7) >> 3; i++)
+		{
+			stream.hash = (stream.hash ^ msg.data[i]) * 1099511628211ULL;
+		}
+		stream.bits += msg.bit;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( netcode )
+
+BOOST_AUTO_TEST_CASE( huffman_bits )
+{
+	static const byte expected[] = {
+		0xcb, 0x18, 0x9f, 0x57, 0xfa, 0x86, 0xf9, 0xde, 0x6d, 0x01,
+		0x26, 0x6f, 0xa7, 0x02, 0xc6, 0xc1, 0x16, 0x57, 0x34,
+	};
+	static const int widths[] = { 1, 3, 8, 5, 16, -7, 32, 2, 12, -16, 7, 24 };
+	static const int values[] = { 1, 5, 'q', 17, 40000, -33, -123456789, 2, 3001, -2000, 99, 0xABCDEF };
+	byte buffer[64];
+	msg_t msg;
+
+	MSG_Init(&msg, buffer, sizeof buffer);
+	for (int i = 0; i < 12; i++)
+	{
+		MSG_WriteBits(&msg, values[i], widths[i]);
+	}
+	BOOST_CHECK_EQUAL(msg.bit, 150);
+	BOOST_CHECK_EQUAL_COLLECTIONS(buffer, buffer + (msg.bit + 7) / 8, expected, expected + sizeof expected);
+
+	MSG_BeginReading(&msg);
+	for (int i = 0; i < 12; i++)
+	{
+		const int width = widths[i] < 0 ? -widths[i] : widths[i];
+		const int mask = width == 32 ? -1 : (1 << width) - 1;
+		BOOST_CHECK_EQUAL(MSG_ReadBits(&msg, widths[i]) & mask, values[i] & mask);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( huffman_overflow )
+{
+	byte buffer[8];
+	msg_t msg;
+
+	// a write that passes the rough size check but doesn't fit leaves the
+	// cursor one past the end, as the tree walk did (247 has the longest code)
+	MSG_Init(&msg, buffer, sizeof buffer);
+	msg.allowoverflow = qtrue;
+	MSG_WriteBits(&msg, 247, 8);
+	MSG_WriteBits(&msg, 247, 8);
+	MSG_WriteBits(&msg, 0, 3);
+	BOOST_CHECK_EQUAL(msg.bit, 25);
+	MSG_WriteBits(&msg, static_cast<int>(0xF7F7F7F7u), 32);
+	BOOST_CHECK(msg.overflowed);
+	BOOST_CHECK_EQUAL(msg.bit, (sizeof buffer << 3) + 1);
+
+	// reading past the end gives zeros and flags the message
+	MSG_Init(&msg, buffer, sizeof buffer);
+	MSG_WriteBits(&msg, 200, 8);
+	MSG_BeginReading(&msg);
+	BOOST_CHECK_EQUAL(MSG_ReadBits(&msg, 8), 200);
+	MSG_ReadBits(&msg, 32);
+	BOOST_CHECK_GT(msg.readcount, msg.cursize);
+}
+
+BOOST_AUTO_TEST_CASE( encoded_bits_copy )
+{
+	// a stream encoded on its own and copied in at an odd bit position must
+	// match writing it in place
+	byte direct[256], copied[256], scratch[256];
+	msg_t directMsg, copiedMsg, scratchMsg;
+
+	MSG_Init(&directMsg, direct, sizeof direct);
+	MSG_Init(&copiedMsg, copied, sizeof copied);
+	MSG_Init(&scratchMsg, scratch, sizeof scratch);
+
+	MSG_WriteBits(&directMsg, 5, 3);
+	MSG_WriteBits(&copiedMsg, 5, 3);
+	for (int i = 0; i < 40; i++)
+	{
+		MSG_WriteBits(&directMsg, i * 7919, 1 + i % 20);
+		MSG_WriteBits(&scratchMsg, i * 7919, 1 + i % 20);
+	}
+	MSG_WriteEncodedBits(&copiedMsg, scratch, scratchMsg.bit);
+	MSG_WriteBits(&directMsg, 1, 1);
+	MSG_WriteBits(&copiedMsg, 1, 1);
+
+	BOOST_CHECK_EQUAL(directMsg.bit, copiedMsg.bit);
+	BOOST_CHECK_EQUAL(directMsg.cursize, copiedMsg.cursize);
+	BOOST_CHECK_EQUAL_COLLECTIONS(direct, direct + (directMsg.bit + 7) / 8, copied, copied + (copiedMsg.bit + 7) / 8);
+}
+
+BOOST_AUTO_TEST_CASE( entity_deltas )
+{
+	const recording_t& rec = Recording_Get();
+	std::vector<byte> buffer(MAX_MSGLEN);
+	std::vector<entityState_t> states(RECORDING_ENTITIES);
+	std::vector<qboolean> present(RECORDING_ENTITIES, qfalse);
+	encodedStream stream;
+	msg_t msg;
+
+	for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+	{
+		MSG_Init(&msg, buffer.data(), static_cast<int>(buffer.size()));
+		Recording_WriteEntities(&msg, frame);
+		BOOST_REQUIRE(!msg.overflowed);
+		HashMessage(stream, msg);
+
+		MSG_BeginReading(&msg);
+		Recording_ReadEntities(&msg, states.data(), present.data());
+		for (int i = 0; i < RECORDING_ENTITIES; i++)
+		{
+			BOOST_REQUIRE_EQUAL(present[i], rec.present[frame][i]);
+			if (present[i])
+			{
+				BOOST_REQUIRE(!memcmp(&states[i], &rec.entities[frame][i], sizeof states[i]));
+			}
+		}
+	}
+
+	BOOST_CHECK_EQUAL(stream.bits, 322605);
+	BOOST_CHECK_EQUAL(stream.hash, 17088343382714431884ULL);
+}
+
+BOOST_AUTO_TEST_CASE( playerstate_deltas )
+{
+	const recording_t& rec = Recording_Get();
+	std::vector<byte> buffer(MAX_MSGLEN);
+	std::vector<playerState_t> from(RECORDING_PLAYERS), to(RECORDING_PLAYERS);
+	encodedStream stream;
+	msg_t msg;
+
+	for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+	{
+		MSG_Init(&msg, buffer.data(), static_cast<int>(buffer.size()));
+		Recording_WritePlayers(&msg, frame);
+		BOOST_REQUIRE(!msg.overflowed);
+		HashMessage(stream, msg);
+
+		MSG_BeginReading(&msg);
+		Recording_ReadPlayers(&msg, frame ? from.data() : nullptr, to.data());
+		for (int i = 0; i < RECORDING_PLAYERS; i++)
+		{
+			BOOST_REQUIRE(!memcmp(&to[i], &rec.players[frame][i], sizeof to[i]));
+		}
+		from.swap(to);
+	}
+
+	BOOST_CHECK_EQUAL(stream.bits, 326673);
+	BOOST_CHECK_EQUAL(stream.hash, 10029123044482393854ULL);
+}
+
+BOOST_AUTO_TEST_CASE( usercmd_deltas )
+{
+	const recording_t& rec = Recording_Get();
+	std::vector<byte> buffer(MAX_MSGLEN);
+	std::vector<usercmd_t> from(RECORDING_PLAYERS), to(RECORDING_PLAYERS);
+	encodedStream stream;
+	msg_t msg;
+
+	for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+	{
+		MSG_Init(&msg, buffer.data(), static_cast<int>(buffer.size()));
+		Recording_WriteCmds(&msg, frame);
+		BOOST_REQUIRE(!msg.overflowed);
+		HashMessage(stream, msg);
+
+		MSG_BeginReading(&msg);
+		Recording_ReadCmds(&msg, frame ? from.data() : nullptr, to.data());
+		for (int i = 0; i < RECORDING_PLAYERS; i++)
+		{
+			BOOST_REQUIRE(!memcmp(&to[i], &rec.cmds[frame][i], sizeof to[i]));
+		}
+		from.swap(to);
+	}
+
+	BOOST_CHECK_EQUAL(stream.bits, 100250);
+	BOOST_CHECK_EQUAL(stream.hash, 1507621995865401012ULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,326 @@
+#include "recording.h"
+
+#include <memory>
+
+namespace
+{
+	constexpr int firstMover = RECORDING_PLAYERS;
+	constexpr int firstItem = 32;
+	constexpr int firstMissile = 64;
+
+	constexpr int frameMsec = 50;
+	constexpr int cmdKey = 0x5EED;
+
+	// plain LCG so the recording doesn't depend on the C library
+	unsigned NextRandom(unsigned& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	// floats the wire format sends as small integers, and ones it doesn't
+	float Units(const int halfUnits)
+	{
+		return static_cast<float>(halfUnits) * 0.5f;
+	}
+
+	void BuildBaseline(entityState_t& es, const int number)
+	{
+		Com_Memset(&es, 0, sizeof es);
+		es.number = number;
+
+		if (number < firstMover)
+		{
+			es.eType = 1; // ET_PLAYER
+			es.clientNum = number;
+			es.modelindex = 255;
+		}
+		else if (number < firstItem)
+		{
+			es.eType = 4; // ET_MOVER
+			es.modelindex = number;
+			es.pos.trType = TR_STATIONARY;
+		}
+		else if (number < firstMissile)
+		{
+			es.eType = 2; // ET_ITEM
+			es.modelindex = number;
+			es.pos.trType = TR_STATIONARY;
+		}
+		else
+		{
+			es.eType = 3; // ET_MISSILE
+			es.pos.trType = TR_LINEAR;
+		}
+		es.groundEntityNum = ENTITYNUM_NONE;
+	}
+
+	void BuildPlayer(recording_t& rec, const int frame, const int client, unsigned& seed)
+	{
+		const playerState_t* prev = frame ? &rec.players[frame - 1][client] : nullptr;
+		playerState_t& ps = rec.players[frame][client];
+
+		if (prev)
+		{
+			ps = *prev;
+		}
+		else
+		{
+			Com_Memset(&ps, 0, sizeof ps);
+			ps.clientNum = client;
+			ps.origin[0] = Units(client * 256);
+			ps.origin[1] = Units(-client * 128);
+			ps.viewheight = 40;
+			ps.stats[0] = 100;
+			ps.ammo[1] = 200;
+			ps.weapon = 3;
+			ps.groundEntityNum = ENTITYNUM_WORLD;
+		}
+
+		ps.commandTime = 1000 + frame * frameMsec;
+
+		// change direction now and then, run in between
+		if (frame % 20 == client % 4)
+		{
+			ps.velocity[0] = static_cast<float>(static_cast<int>(NextRandom(seed) % 640) - 320);
+			ps.velocity[1] = static_cast<float>(static_cast<int>(NextRandom(seed) % 640) - 320);
+			ps.legsAnim = static_cast<int>(NextRandom(seed) % 1000);
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			ps.origin[i] += ps.velocity[i] * 0.05f;
+		}
+		ps.bobCycle = (ps.bobCycle + 7) & 255;
+		ps.viewangles[YAW] = static_cast<float>(NextRandom(seed) % 65536) * (360.0f / 65536);
+		ps.viewangles[PITCH] = static_cast<float>(static_cast<int>(NextRandom(seed) % 2048) - 1024) * (360.0f / 65536);
+
+		// fire and take damage every so often
+		if (NextRandom(seed) % 6 == 0)
+		{
+			ps.torsoAnim = static_cast<int>(NextRandom(seed) % 1000);
+			ps.weaponTime = 400;
+			ps.ammo[1] = ps.ammo[1] > 0 ? ps.ammo[1] - 1 : 200;
+			ps.events[ps.eventSequence & 1] = 23;
+			ps.eventParms[ps.eventSequence & 1] = ps.weapon;
+			ps.eventSequence++;
+		}
+		else if (ps.weaponTime > 0)
+		{
+			ps.weaponTime -= frameMsec;
+		}
+		if (NextRandom(seed) % 25 == 0)
+		{
+			ps.stats[0] = ps.stats[0] > 20 ? ps.stats[0] - 17 : 100;
+		}
+	}
+
+	void BuildEntity(recording_t& rec, const int frame, const int number, unsigned& seed)
+	{
+		entityState_t& es = rec.entities[frame][number];
+		const entityState_t* prev = frame && rec.present[frame - 1][number] ? &rec.entities[frame - 1][number] : nullptr;
+
+		es = prev ? *prev : rec.baselines[number];
+		rec.present[frame][number] = qtrue;
+
+		if (number < firstMover)
+		{
+			// players mirror their playerState, like BG_PlayerStateToEntityState
+			const playerState_t& ps = rec.players[frame][number];
+
+			es.pos.trType = TR_INTERPOLATE;
+			VectorCopy(ps.origin, es.pos.trBase);
+			VectorCopy(ps.velocity, es.pos.trDelta);
+			es.apos.trType = TR_INTERPOLATE;
+			VectorCopy(ps.viewangles, es.apos.trBase);
+			es.legsAnim = ps.legsAnim;
+			es.torsoAnim = ps.torsoAnim;
+			es.weapon = ps.weapon;
+			es.groundEntityNum = ps.groundEntityNum;
+			es.event = ps.eventSequence ? ps.events[(ps.eventSequence - 1) & 1] : 0;
+			es.eventParm = ps.eventSequence ? ps.eventParms[(ps.eventSequence - 1) & 1] : 0;
+		}
+		else if (number < firstItem)
+		{
+			// doors and lifts, mostly idle
+			if (!prev)
+			{
+				es.pos.trBase[0] = Units(number * 100);
+				es.pos.trBase[2] = Units(64);
+			}
+			if (NextRandom(seed) % 40 == 0)
+			{
+				es.pos.trType = es.pos.trType == TR_STATIONARY ? TR_LINEAR_STOP : TR_STATIONARY;
+				es.pos.trTime = 1000 + frame * frameMsec;
+				es.pos.trDuration = 1000;
+				es.pos.trDelta[2] = es.pos.trType == TR_STATIONARY ? 0.0f : 128.0f;
+			}
+		}
+		else if (number < firstMissile)
+		{
+			// items get picked up and respawn
+			if (!prev)
+			{
+				es.origin[0] = es.pos.trBase[0] = Units(number * -96);
+				es.origin[1] = es.pos.trBase[1] = Units(number * 48);
+			}
+			if (NextRandom(seed) % 50 == 0)
+			{
+				es.eFlags ^= 1 << 8; // EF_NODRAW
+			}
+		}
+		else
+		{
+			// missiles live for a while then vanish
+			if ((frame + number) % 40 >= 25)
+			{
+				rec.present[frame][number] = qfalse;
+				return;
+			}
+			if (!prev)
+			{
+				const int shooter = number % RECORDING_PLAYERS;
+
+				VectorCopy(rec.players[frame][shooter].origin, es.pos.trBase);
+				es.pos.trDelta[0] = static_cast<float>(static_cast<int>(NextRandom(seed) % 2000) - 1000);
+				es.pos.trDelta[1] = static_cast<float>(static_cast<int>(NextRandom(seed) % 2000) - 1000);
+				es.pos.trTime = 1000 + frame * frameMsec;
+				es.otherEntityNum = shooter;
+				es.weapon = 3;
+			}
+		}
+	}
+
+	std::unique_ptr<recording_t> BuildRecording()
+	{
+		std::unique_ptr<recording_t> rec(new recording_t);
+		unsigned seed = 12345;
+
+		for (int i = 0; i < RECORDING_ENTITIES; i++)
+		{
+			BuildBaseline(rec->baselines[i], i);
+		}
+
+		for (int frame = 0; frame < RECORDING_FRAMES; frame++)
+		{
+			for (int client = 0; client < RECORDING_PLAYERS; client++)
+			{
+				BuildPlayer(*rec, frame, client, seed);
+
+				usercmd_t& cmd = rec->cmds[frame][client];
+				const playerState_t& ps = rec->players[frame][client];
+
+				Com_Memset(&cmd, 0, sizeof cmd);
+				cmd.serverTime = ps.commandTime + client;
+				cmd.angles[YAW] = ANGLE2SHORT(ps.viewangles[YAW]);
+				cmd.angles[PITCH] = ANGLE2SHORT(ps.viewangles[PITCH]);
+				cmd.buttons = ps.weaponTime == 400 ? BUTTON_ATTACK : 0;
+				cmd.weapon = static_cast<byte>(ps.weapon);
+				cmd.forwardmove = ps.velocity[0] > 0 ? 127 : ps.velocity[0] < 0 ? -127 : 0;
+				cmd.rightmove = ps.velocity[1] > 0 ? 127 : ps.velocity[1] < 0 ? -127 : 0;
+			}
+
+			for (int i = 0; i < RECORDING_ENTITIES; i++)
+			{
+				BuildEntity(*rec, frame, i, seed);
+			}
+		}
+
+		return rec;
+	}
+}
+
+const recording_t& Recording_Get()
+{
+	static const std::unique_ptr<recording_t> recording = BuildRecording();
+	return *recording;
+}
+
+void Recording_WriteEntities(msg_t* msg, const int frame)
+{
+	const recording_t& rec = Recording_Get();
+	auto& baselines = const_cast<entityState_t(&)[RECORDING_ENTITIES]>(rec.baselines);
+	auto& states = const_cast<entityState_t(&)[RECORDING_ENTITIES]>(rec.entities[frame]);
+
+	for (int i = 0; i < RECORDING_ENTITIES; i++)
+	{
+		const qboolean wasPresent = frame ? rec.present[frame - 1][i] : qfalse;
+		entityState_t* old = frame ? const_cast<entityState_t*>(&rec.entities[frame - 1][i]) : nullptr;
+
+		if (rec.present[frame][i])
+		{
+			if (wasPresent)
+			{
+				MSG_WriteDeltaEntity(msg, old, &states[i], qfalse);
+			}
+			else
+			{
+				MSG_WriteDeltaEntity(msg, &baselines[i], &states[i], qtrue);
+			}
+		}
+		else if (wasPresent)
+		{
+			MSG_WriteDeltaEntity(msg, old, nullptr, qtrue);
+		}
+	}
+
+	MSG_WriteBits(msg, MAX_GENTITIES - 1, GENTITYNUM_BITS);
+}
+
+void Recording_ReadEntities(msg_t* msg, entityState_t* states, qboolean* present)
+{
+	const recording_t& rec = Recording_Get();
+
+	while (true)
+	{
+		const int number = MSG_ReadBits(msg, GENTITYNUM_BITS);
+		if (number == MAX_GENTITIES - 1 || number >= RECORDING_ENTITIES || msg->readcount > msg->cursize)
+		{
+			break;
+		}
+
+		entityState_t from = present[number] ? states[number] : rec.baselines[number];
+		MSG_ReadDeltaEntity(msg, &from, &states[number], number);
+		present[number] = static_cast<qboolean>(states[number].number != MAX_GENTITIES - 1);
+	}
+}
+
+void Recording_WritePlayers(msg_t* msg, const int frame)
+{
+	const recording_t& rec = Recording_Get();
+
+	for (int i = 0; i < RECORDING_PLAYERS; i++)
+	{
+		playerState_t* from = frame ? const_cast<playerState_t*>(&rec.players[frame - 1][i]) : nullptr;
+		MSG_WriteDeltaPlayerstate(msg, from, const_cast<playerState_t*>(&rec.players[frame][i]));
+	}
+}
+
+void Recording_ReadPlayers(msg_t* msg, playerState_t* from, playerState_t* to)
+{
+	for (int i = 0; i < RECORDING_PLAYERS; i++)
+	{
+		MSG_ReadDeltaPlayerstate(msg, from ? &from[i] : nullptr, &to[i]);
+	}
+}
+
+void Recording_WriteCmds(msg_t* msg, const int frame)
+{
+	const recording_t& rec = Recording_Get();
+	usercmd_t nullcmd{};
+
+	for (int i = 0; i < RECORDING_PLAYERS; i++)
+	{
+		usercmd_t* from = frame ? const_cast<usercmd_t*>(&rec.cmds[frame - 1][i]) : &nullcmd;
+		MSG_WriteDeltaUsercmdKey(msg, cmdKey ^ i, from, const_cast<usercmd_t*>(&rec.cmds[frame][i]));
+	}
+}
+
+void Recording_ReadCmds(msg_t* msg, usercmd_t* from, usercmd_t* to)
+{
+	usercmd_t nullcmd{};
+
+	for (int i = 0; i < RECORDING_PLAYERS; i++)
+	{
+		MSG_ReadDeltaUsercmdKey(msg, cmdKey ^ i, from ? &from[i] : &nullcmd, &to[i]);
+	}
+}
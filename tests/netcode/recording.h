@@ -0,0 +1,41 @@
+#pragma once
+
+// A deterministic stand-in for a recorded match, used to replay realistic
+// snapshot traffic through the delta encoders: players running, turning and
+// firing, movers sitting still, items being picked up and respawning and
+// missiles coming and going.
+
+#include "qcommon/q_shared.h"
+#include "qcommon/qcommon.h"
+
+#define RECORDING_FRAMES		200
+#define RECORDING_ENTITIES		96		// 0..7 players, then movers, items and missiles
+#define RECORDING_PLAYERS		8
+
+using recording_t = struct recording_s
+{
+	entityState_t baselines[RECORDING_ENTITIES];
+	entityState_t entities[RECORDING_FRAMES][RECORDING_ENTITIES];
+	qboolean present[RECORDING_FRAMES][RECORDING_ENTITIES];
+	playerState_t players[RECORDING_FRAMES][RECORDING_PLAYERS];
+	usercmd_t cmds[RECORDING_FRAMES][RECORDING_PLAYERS];
+};
+
+// built on first use, the same on every platform
+const recording_t& Recording_Get();
+
+// the snapshot entity list for a frame, delta compressed from the previous
+// frame (or the baselines for frame 0) the way SV_EmitPacketEntities does
+void Recording_WriteEntities(msg_t* msg, int frame);
+
+// reads what Recording_WriteEntities wrote on top of the states and present
+// flags decoded for the previous frame
+void Recording_ReadEntities(msg_t* msg, entityState_t* states, qboolean* present);
+
+// every player's state, from the previous frame's (nothing for frame 0)
+void Recording_WritePlayers(msg_t* msg, int frame);
+void Recording_ReadPlayers(msg_t* msg, playerState_t* from, playerState_t* to);
+
+// every player's command, keyed like a client packet
+void Recording_WriteCmds(msg_t* msg, int frame);
+void Recording_ReadCmds(msg_t* msg, usercmd_t* from, usercmd_t* to);
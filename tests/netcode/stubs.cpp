@@ -0,0 +1,57 @@
+// The parts of the engine the message code reaches for, reduced to what a
+// test needs: no filesystem (so no netf overrides), no server and no console.
+
+#include "server/server.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+cvar_t* cl_shownet = nullptr;
+server_t sv;
+
+void QDECL Com_Printf(const char* fmt, ...)
+{
+	va_list argptr;
+
+	va_start(argptr, fmt);
+	vprintf(fmt, argptr);
+	va_end(argptr);
+}
+
+void NORETURN QDECL Com_Error(const int code, const char* fmt, ...)
+{
+	va_list argptr;
+
+	va_start(argptr, fmt);
+	vfprintf(stderr, fmt, argptr);
+	va_end(argptr);
+	fputc('\n', stderr);
+
+	throw code;
+}
+
+long FS_FOpenFileRead(const char* filename, fileHandle_t* file, qboolean uniqueFILE)
+{
+	*file = 0;
+	return -1;
+}
+
+int FS_Read(void* buffer, int len, fileHandle_t f)
+{
+	return 0;
+}
+
+void FS_FCloseFile(fileHandle_t f)
+{
+}
+
+sharedEntity_t* SV_GentityNum(int num)
+{
+	return nullptr;
+}
+
+void* Z_Malloc(const int iSize, memtag_t eTag, const qboolean bZeroit, int iAlign)
+{
+	return calloc(1, iSize);
+}
@@ -0,0 +1,232 @@
+#include "rd-common/tr_skinning.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Every vector kernel the cpu runs has to land where the scalar path does.
+// Set SKIN_TEST_MODEL to a .glm pulled out of the assets (the humanoid player
+// models, say) to run every surface of every LOD of it through them as well.
+
+namespace
+{
+	// plain LCG so the surfaces don't depend on the C library
+	unsigned NextRandom(unsigned& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	float RandomFloat(unsigned& seed, const float lo, const float hi)
+	{
+		return lo + (hi - lo) * static_cast<float>(NextRandom(seed) & 0xFFFF) / 65535.0f;
+	}
+
+	// a surface laid out as the .glm has it: header, verts, tex coords, bone references
+	std::vector<byte> BuildSurface(const int numVerts, const int numBoneRefs, unsigned& seed)
+	{
+		const size_t ofsVerts = sizeof(mdxmSurface_t);
+		const size_t ofsBoneRefs = ofsVerts + numVerts * (sizeof(mdxmVertex_t) + sizeof(mdxmVertexTexCoord_t));
+		std::vector<byte> buffer(ofsBoneRefs + numBoneRefs * sizeof(int));
+
+		auto surface = reinterpret_cast<mdxmSurface_t*>(buffer.data());
+		surface->numVerts = numVerts;
+		surface->ofsVerts = static_cast<int>(ofsVerts);
+		surface->numBoneReferences = numBoneRefs;
+		surface->ofsBoneReferences = static_cast<int>(ofsBoneRefs);
+
+		auto verts = reinterpret_cast<mdxmVertex_t*>(buffer.data() + ofsVerts);
+		auto texCoords = reinterpret_cast<mdxmVertexTexCoord_t*>(&verts[numVerts]);
+		for (int i = 0; i < numVerts; i++)
+		{
+			mdxmVertex_t& v = verts[i];
+			const int numWeights = 1 + static_cast<int>(NextRandom(seed) % iMAX_G2_BONEWEIGHTS_PER_VERT);
+			int remaining = 1023;
+
+			for (int k = 0; k < 3; k++)
+			{
+				v.vertCoords[k] = RandomFloat(seed, -40.0f, 40.0f);
+			}
+			v.uiNmWeightsAndBoneIndexes = static_cast<unsigned>(numWeights - 1) << 30;
+			for (int k = 0; k < numWeights; k++)
+			{
+				v.uiNmWeightsAndBoneIndexes |= NextRandom(seed) % numBoneRefs << iG2_BITS_PER_BONEREF * k;
+				if (k < numWeights - 1)
+				{
+					// the last weight is whatever the others leave
+					const int weight = static_cast<int>(NextRandom(seed) % (remaining + 1));
+					remaining -= weight;
+					v.BoneWeightings[k] = static_cast<byte>(weight & 0xFF);
+					v.uiNmWeightsAndBoneIndexes |= static_cast<unsigned>(weight >> 8) << (20 + 2 * k);
+				}
+			}
+			texCoords[i].texCoords[0] = RandomFloat(seed, 0.0f, 1.0f);
+			texCoords[i].texCoords[1] = RandomFloat(seed, 0.0f, 1.0f);
+		}
+
+		return buffer;
+	}
+
+	// rotation, a little stretch and an offset, like a posed bone with scaling
+	std::vector<mdxaBone_t> BuildBones(const int numBones, unsigned& seed, const bool stretch)
+	{
+		std::vector<mdxaBone_t> bones(numBones);
+
+		for (mdxaBone_t& bone : bones)
+		{
+			const float yaw = RandomFloat(seed, -3.14f, 3.14f);
+			const float pitch = RandomFloat(seed, -1.5f, 1.5f);
+			const float s = stretch ? RandomFloat(seed, 0.8f, 1.25f) : 1.0f;
+			const float cy = cosf(yaw), sy = sinf(yaw), cp = cosf(pitch), sp = sinf(pitch);
+			const float rotation[3][3] = {
+				{ cy * cp, -sy, cy * sp },
+				{ sy * cp, cy, sy * sp },
+				{ -sp, 0.0f, cp },
+			};
+
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					bone.matrix[r][c] = rotation[r][c] * s;
+				}
+				bone.matrix[r][3] = RandomFloat(seed, -64.0f, 64.0f);
+			}
+		}
+
+		return bones;
+	}
+
+	void CheckKernels(const mdxmSurface_t* surface, const std::vector<mdxaBone_t>& bones, const vec3_t scale)
+	{
+		std::vector<const mdxaBone_t*> bonePtrs;
+		for (const mdxaBone_t& bone : bones)
+		{
+			bonePtrs.push_back(&bone);
+		}
+
+		const size_t numFloats = static_cast<size_t>(surface->numVerts) * 5;
+		std::vector<float> expected(numFloats);
+		R_SkinSurfaceVerts(SKIN_SCALAR, surface, bonePtrs.data(), scale, expected.data());
+
+		for (int kernel = SKIN_SCALAR + 1; kernel < SKIN_NUM_KERNELS; kernel++)
+		{
+			if (!R_SkinKernelSupported(static_cast<skinKernel_t>(kernel)))
+			{
+				continue;
+			}
+
+			// the guard float catches a kernel writing past the last vert
+			std::vector<float> skinned(numFloats + 1, 12345.0f);
+			R_SkinSurfaceVerts(static_cast<skinKernel_t>(kernel), surface, bonePtrs.data(), scale, skinned.data());
+
+			for (size_t i = 0; i < numFloats; i++)
+			{
+				if (i % 5 < 3)
+				{
+					// the vector kernels add in another order and may fuse
+					BOOST_REQUIRE_SMALL(skinned[i] - expected[i], 1e-3f * (1.0f + fabsf(expected[i])));
+				}
+				else
+				{
+					BOOST_REQUIRE_EQUAL(skinned[i], expected[i]);
+				}
+			}
+			BOOST_REQUIRE_EQUAL(skinned[numFloats], 12345.0f);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( skinning )
+
+BOOST_AUTO_TEST_CASE( scalar_single_bone )
+{
+	unsigned seed = 99;
+	std::vector<byte> buffer = BuildSurface(1, 1, seed);
+	const auto surface = reinterpret_cast<const mdxmSurface_t*>(buffer.data());
+	const auto v = reinterpret_cast<const mdxmVertex_t*>(buffer.data() + surface->ofsVerts);
+	const auto texCoords = reinterpret_cast<const mdxmVertexTexCoord_t*>(&v[1]);
+	const mdxaBone_t bone = { { { 0, -1, 0, 10 }, { 1, 0, 0, 20 }, { 0, 0, 1, 30 } } };
+	const mdxaBone_t* bones[] = { &bone };
+	const vec3_t scale = { 2.0f, 1.0f, 0.5f };
+	float out[5];
+
+	R_SkinSurfaceVerts(SKIN_SCALAR, surface, bones, scale, out);
+
+	// all the weight is on the one bone, whatever the vert was packed with
+	BOOST_CHECK_SMALL(out[0] - (10.0f - v->vertCoords[1]) * 2.0f, 1e-3f);
+	BOOST_CHECK_SMALL(out[1] - (20.0f + v->vertCoords[0]), 1e-3f);
+	BOOST_CHECK_SMALL(out[2] - (30.0f + v->vertCoords[2]) * 0.5f, 1e-3f);
+	BOOST_CHECK_EQUAL(out[3], texCoords->texCoords[0]);
+	BOOST_CHECK_EQUAL(out[4], texCoords->texCoords[1]);
+}
+
+BOOST_AUTO_TEST_CASE( kernels_match_scalar )
+{
+	static const int vertCounts[] = { 1, 2, 3, 4, 5, 7, 64, 331 };
+	unsigned seed = 12345;
+
+	BOOST_TEST_MESSAGE("best skinning kernel " << R_BestSkinKernel());
+
+	for (const int numVerts : vertCounts)
+	{
+		for (const int numBoneRefs : { 1, 5, iMAX_G2_BONEREFS_PER_SURFACE })
+		{
+			std::vector<byte> buffer = BuildSurface(numVerts, numBoneRefs, seed);
+			const auto surface = reinterpret_cast<const mdxmSurface_t*>(buffer.data());
+			const vec3_t unscaled = { 1.0f, 1.0f, 1.0f };
+			const vec3_t scaled = { 1.25f, 0.9f, 1.1f };
+
+			CheckKernels(surface, BuildBones(numBoneRefs, seed, false), unscaled);
+			CheckKernels(surface, BuildBones(numBoneRefs, seed, true), scaled);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( kernels_match_scalar_on_model )
+{
+	const char* path = getenv("SKIN_TEST_MODEL");
+	if (!path)
+	{
+		BOOST_TEST_MESSAGE("SKIN_TEST_MODEL not set, no model to skin");
+		return;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	BOOST_REQUIRE(file);
+	std::vector<byte> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	BOOST_REQUIRE_GE(buffer.size(), sizeof(mdxmHeader_t));
+
+	const auto mdxm = reinterpret_cast<const mdxmHeader_t*>(buffer.data());
+	BOOST_REQUIRE_EQUAL(mdxm->ident, MDXM_IDENT);
+	BOOST_REQUIRE_EQUAL(mdxm->version, MDXM_VERSION);
+
+	unsigned seed = 777;
+	int numSurfaces = 0;
+	auto lod = reinterpret_cast<const byte*>(mdxm) + mdxm->ofsLODs;
+	for (int l = 0; l < mdxm->numLODs; l++)
+	{
+		const auto indexes = reinterpret_cast<const mdxmLODSurfOffset_t*>(lod + sizeof(mdxmLOD_t));
+
+		for (int i = 0; i < mdxm->numSurfaces; i++)
+		{
+			const auto surface = reinterpret_cast<const mdxmSurface_t*>(reinterpret_cast<const byte*>(indexes) + indexes->offsets[i]);
+			const vec3_t scale = { 1.0f, 1.0f, 1.0f };
+
+			if (!surface->numBoneReferences)
+			{
+				continue;
+			}
+			CheckKernels(surface, BuildBones(surface->numBoneReferences, seed, false), scale);
+			numSurfaces++;
+		}
+		lod += reinterpret_cast<const mdxmLOD_t*>(lod)->ofsEnd;
+	}
+	BOOST_TEST_MESSAGE("skinned " << numSurfaces << " surfaces of " << path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()